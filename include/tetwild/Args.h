@@ -65,6 +65,18 @@ struct Args {
     // Background mesh for the edge length sizing field
     std::string background_mesh = "";
 
+    // Number of threads used by the parallel parts of the pipeline (0 = all hardware threads, 1 = sequential)
+    // Results computed with more than one thread may differ from the sequential ones.
+    int num_threads = 1;
+
+    // Make the parallel mesh operations reproducible, i.e. independent of the thread scheduling
+    // and of the number of threads (as long as it is greater than 1)
+    bool is_deterministic = false;
+
+    // Use a 4-wide bounding volume hierarchy with SIMD box tests for the envelope and distance queries
+    // (the results are the same as with the default binary tree)
+    bool use_wide_bvh = false;
+
     ////////////////////
     // [Experimental] //
     ////////////////////
@@ -99,6 +111,9 @@ struct Args {
 
     bool is_quiet = false;
 
+    // Write a trace of the stages, passes and local operations (Chrome trace event format) to this file
+    std::string trace_file = "";
+
     /////////////////
     // [Callbacks] //
     /////////////////
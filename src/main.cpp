@@ -9,13 +9,13 @@
 #include <tetwild/tetwild.h>
 #include <tetwild/Common.h>
 #include <tetwild/Logger.h>
+#include <tetwild/MeshReader.h>
 #include <tetwild/MeshRefinement.h>
+#include <tetwild/MshWriter.h>
 #include <tetwild/geogram/Utils.h>
-#include <igl/remove_duplicate_vertices.h>
 #include <igl/read_triangle_mesh.h>
 #include <igl/write_triangle_mesh.h>
 #include <igl/writeOBJ.h>
-#include <pymesh/MshSaver.h>
 #include <geogram/mesh/mesh_io.h>
 #include <geogram/basic/command_line.h>
 #include <geogram/basic/command_line_args.h>
@@ -57,7 +57,7 @@ bool endswith_nocase(const std::string &str, const std::string &suffix) {
 }
 
 void saveFinalTetmesh(const std::string &output_volume, const std::string &output_surface,
-    const Eigen::MatrixXd &V, const Eigen::MatrixXi &T, const Eigen::VectorXd &A)
+    const Eigen::MatrixXd &V, const Eigen::MatrixXi &T, const Eigen::VectorXd &A, int num_threads)
 {
     logger().debug("Writing mesh to {}...", output_volume);
     if (endswith_nocase(output_volume, ".mesh")) {
@@ -82,15 +82,7 @@ void saveFinalTetmesh(const std::string &output_volume, const std::string &outpu
         f << "End";
         f.close();
     } else if (endswith_nocase(output_volume, ".msh")) {
-        PyMesh::MshSaver mSaver(output_volume, true);
-        PyMesh::VectorF V_flat(V.size());
-        PyMesh::VectorI T_flat(T.size());
-        Eigen::MatrixXd VV = V.transpose();
-        Eigen::MatrixXi TT = T.transpose();
-        std::copy_n(VV.data(), V.size(), V_flat.data());
-        std::copy_n(TT.data(), T.size(), T_flat.data());
-        mSaver.save_mesh(V_flat, T_flat, 3, mSaver.TET);
-        mSaver.save_elem_scalar_field("min_dihedral_angle", A);
+        writeMsh(output_volume, V, T, A, "min_dihedral_angle", num_threads);
     } else {
         GEO::Mesh M;
         Eigen::MatrixXi F(0, 3);
@@ -140,13 +132,17 @@ int main(int argc, char *argv[]) {
     app.add_option("-l,--ideal-edge-length", args.initial_edge_len_rel, "ideal_edge_length = diag_of_bbox * L / 100. (double, optional, default: 5%)");
     app.add_option("-e,--epsilon", args.eps_rel, "epsilon = diag_of_bbox * EPS / 100. (double, optional, default: 0.1%)");
     app.add_option("--stage", args.stage, "Run pipeline in stage STAGE. (integer, optional, default: 1)");
+    app.add_flag("--deterministic", args.is_deterministic, "Make the parallel mesh operations independent of the thread scheduling. (optional)");
     app.add_option("--filter-energy", args.filter_energy_thres, "Stop mesh improvement when the maximum energy is smaller than ENERGY. (double, optional, default: 10)");
     app.add_option("--max-pass", args.max_num_passes, "Do PASS mesh improvement passes in maximum. (integer, optional, default: 80)");
 
     app.add_flag("--is-laplacian", args.smooth_open_boundary, "Do Laplacian smoothing for the surface of output on the holes of input (optional)");
     app.add_option("--targeted-num-v", args.target_num_vertices, "Output tetmesh that contains TV vertices. (integer, optional, tolerance: 5%)");
     app.add_option("--bg-mesh", args.background_mesh, "Background tetmesh BGMESH in .msh format for applying sizing field. (string, optional)");
+    app.add_flag("--wide-bvh", args.use_wide_bvh, "Use a 4-wide BVH for the envelope queries. (optional)");
+    app.add_option("--num-threads", args.num_threads, "Use NUM threads in the parallel parts of the pipeline, 0 for all hardware threads. (integer, optional, default: 1)");
     app.add_flag("-q,--is-quiet", args.is_quiet, "Mute console output. (optional)");
+    app.add_option("--trace", args.trace_file, "Write a trace of the stages, passes and operations to the given file, in the Chrome trace format (open in chrome://tracing). (string, optional)");
     app.add_option("--log", log_filename, "Log info to given file.");
     app.add_option("--level", log_level, "Log level (0 = most verbose, 6 = off).");
     app.add_flag("--mmgs", args.use_mmgs, "Use mmgs in the *experimental* hybrid pipeline (default: false).");
@@ -212,7 +208,8 @@ int main(int argc, char *argv[]) {
     Eigen::MatrixXd VI, VO;
     Eigen::MatrixXi FI, TO;
     Eigen::VectorXd AO;
-    igl::read_triangle_mesh(input_surface, VI, FI);
+    if (!readTriangleMesh(input_surface, VI, FI, args.num_threads))
+        igl::read_triangle_mesh(input_surface, VI, FI);
     if (VI.rows() == 0) {
         logger().warn("libigl failed to read input mesh: {}, trying with geogram", input_surface);
         GEO::Mesh M;
@@ -223,8 +220,7 @@ int main(int argc, char *argv[]) {
     if (endswith_nocase(input_surface, ".stl")) {
         Eigen::MatrixXd VV;
         Eigen::MatrixXi FF;
-        Eigen::VectorXi SVI, SVJ;
-        igl::remove_duplicate_vertices(VI, FI, 1e-10, VV, SVI, SVJ, FF);
+        weldVertices(VI, FI, 1e-10, VV, FF, args.num_threads);
         VI = VV;
         FI = FF;
     }
@@ -238,7 +234,7 @@ int main(int argc, char *argv[]) {
     }
 
     //save output volume
-    saveFinalTetmesh(output_volume, output_surface, VO, TO, AO);
+    saveFinalTetmesh(output_volume, output_surface, VO, TO, AO, args.num_threads);
 
     spdlog::shutdown();
 
@@ -0,0 +1,96 @@
+// This file is part of TetWild, a software for generating tetrahedral meshes.
+//
+// This Source Code Form is subject to the terms of the Mozilla Public License
+// v. 2.0. If a copy of the MPL was not distributed with this file, You can
+// obtain one at http://mozilla.org/MPL/2.0/.
+//
+
+#include <tetwild/AMIPSKernels.h>
+#include <tetwild/AMIPSKernelsImpl.h>
+#include <tetwild/Logger.h>
+
+namespace tetwild {
+
+#ifdef TETWILD_WITH_SIMD_KERNELS
+namespace amips {
+// defined in AMIPSKernels_avx2.cpp and AMIPSKernels_avx512.cpp, which are compiled with the matching flags
+int comformalAMIPSEnergyBatch_avx2(int begin, int n, const double * const *T, double *result);
+int comformalAMIPSJacobianBatch_avx2(int begin, int n, const double * const *T, double * const *result);
+int comformalAMIPSHessianBatch_avx2(int begin, int n, const double * const *T, double * const *result);
+int comformalAMIPSEnergyBatch_avx512(int begin, int n, const double * const *T, double *result);
+int comformalAMIPSJacobianBatch_avx512(int begin, int n, const double * const *T, double * const *result);
+int comformalAMIPSHessianBatch_avx512(int begin, int n, const double * const *T, double * const *result);
+} // namespace amips
+#endif
+
+namespace {
+
+SimdLevel detectSimdLevel() {
+    SimdLevel level = SimdLevel::SCALAR;
+#if defined(TETWILD_WITH_SIMD_KERNELS) && (defined(__GNUC__) || defined(__clang__))
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        level = SimdLevel::AVX512;
+    } else if (__builtin_cpu_supports("avx2")) {
+        level = SimdLevel::AVX2;
+    }
+#endif
+    logger().debug("AMIPS kernels: {}", getSimdLevelName(level));
+    return level;
+}
+
+} // anonymous namespace
+
+SimdLevel getSimdLevel() {
+    static const SimdLevel level = detectSimdLevel();
+    return level;
+}
+
+const char *getSimdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::AVX512: return "AVX-512";
+        case SimdLevel::AVX2: return "AVX2";
+        default: return "scalar";
+    }
+}
+
+void comformalAMIPSEnergyBatch(const TetCoordBatch &batch, double *energy) {
+    const int n = batch.size();
+    int i = 0;
+#ifdef TETWILD_WITH_SIMD_KERNELS
+    switch (getSimdLevel()) {
+        case SimdLevel::AVX512: i = amips::comformalAMIPSEnergyBatch_avx512(i, n, batch.data(), energy); break;
+        case SimdLevel::AVX2: i = amips::comformalAMIPSEnergyBatch_avx2(i, n, batch.data(), energy); break;
+        default: break;
+    }
+#endif
+    amips::comformalAMIPSEnergyBatch<amips::Vec1d>(i, n, batch.data(), energy);
+}
+
+void comformalAMIPSJacobianBatch(const TetCoordBatch &batch, const std::array<double *, 3> &J) {
+    const int n = batch.size();
+    int i = 0;
+#ifdef TETWILD_WITH_SIMD_KERNELS
+    switch (getSimdLevel()) {
+        case SimdLevel::AVX512: i = amips::comformalAMIPSJacobianBatch_avx512(i, n, batch.data(), J.data()); break;
+        case SimdLevel::AVX2: i = amips::comformalAMIPSJacobianBatch_avx2(i, n, batch.data(), J.data()); break;
+        default: break;
+    }
+#endif
+    amips::comformalAMIPSJacobianBatch<amips::Vec1d>(i, n, batch.data(), J.data());
+}
+
+void comformalAMIPSHessianBatch(const TetCoordBatch &batch, const std::array<double *, 9> &H) {
+    const int n = batch.size();
+    int i = 0;
+#ifdef TETWILD_WITH_SIMD_KERNELS
+    switch (getSimdLevel()) {
+        case SimdLevel::AVX512: i = amips::comformalAMIPSHessianBatch_avx512(i, n, batch.data(), H.data()); break;
+        case SimdLevel::AVX2: i = amips::comformalAMIPSHessianBatch_avx2(i, n, batch.data(), H.data()); break;
+        default: break;
+    }
+#endif
+    amips::comformalAMIPSHessianBatch<amips::Vec1d>(i, n, batch.data(), H.data());
+}
+
+} // namespace tetwild
@@ -0,0 +1,86 @@
+// This file is part of TetWild, a software for generating tetrahedral meshes.
+//
+// This Source Code Form is subject to the terms of the Mozilla Public License
+// v. 2.0. If a copy of the MPL was not distributed with this file, You can
+// obtain one at http://mozilla.org/MPL/2.0/.
+//
+
+#pragma once
+
+#include <array>
+#include <vector>
+
+namespace tetwild {
+
+////////////////////////////////////////////////////////////////////////////////
+
+enum class SimdLevel {
+    SCALAR = 0,
+    AVX2 = 1,
+    AVX512 = 2
+};
+
+///
+/// @brief      { Widest instruction set supported by both the build and the CPU, detected once }
+///
+SimdLevel getSimdLevel();
+
+///
+/// @brief      { Human readable name of a SIMD level }
+///
+const char *getSimdLevelName(SimdLevel level);
+
+///
+/// @brief      { Coordinates of a batch of tets, stored as structure of arrays }
+///
+class TetCoordBatch {
+public:
+    int size() const { return m_size; }
+
+    void resize(int n) {
+        m_size = n;
+        for (int k = 0; k < 12; k++) {
+            m_coords[k].resize(n);
+            m_ptrs[k] = m_coords[k].data();
+        }
+    }
+
+    ///
+    /// @brief      { Sets the k-th coordinate (x0, y0, z0, ..., z3) of the i-th tet }
+    ///
+    void set(int i, int k, double x) { m_coords[k][i] = x; }
+
+    const double * const *data() const { return m_ptrs.data(); }
+
+private:
+    int m_size = 0;
+    std::array<std::vector<double>, 12> m_coords;
+    std::array<const double *, 12> m_ptrs;
+};
+
+///
+/// @brief      { Batched LocalOperations::comformalAMIPSEnergy_new(), using the SIMD level given by getSimdLevel().
+///             All levels give bitwise identical results. }
+///
+/// @param[in]  batch   { Tets to evaluate }
+/// @param[out] energy  { Energy of each tet (size batch.size()) }
+///
+void comformalAMIPSEnergyBatch(const TetCoordBatch &batch, double *energy);
+
+///
+/// @brief      { Batched LocalOperations::comformalAMIPSJacobian_new() }
+///
+/// @param[in]  batch  { Tets to evaluate }
+/// @param[out] J      { J[k][i] is the k-th component of the gradient w.r.t. the first vertex of the i-th tet }
+///
+void comformalAMIPSJacobianBatch(const TetCoordBatch &batch, const std::array<double *, 3> &J);
+
+///
+/// @brief      { Batched LocalOperations::comformalAMIPSHessian_new() }
+///
+/// @param[in]  batch  { Tets to evaluate }
+/// @param[out] H      { H[k][i] is the k-th entry (row major) of the hessian w.r.t. the first vertex of the i-th tet }
+///
+void comformalAMIPSHessianBatch(const TetCoordBatch &batch, const std::array<double *, 9> &H);
+
+} // namespace tetwild
@@ -0,0 +1,334 @@
+// This file is part of TetWild, a software for generating tetrahedral meshes.
+//
+// This Source Code Form is subject to the terms of the Mozilla Public License
+// v. 2.0. If a copy of the MPL was not distributed with this file, You can
+// obtain one at http://mozilla.org/MPL/2.0/.
+//
+
+#pragma once
+
+// Internal header shared by the AMIPS kernel translation units, see AMIPSKernels.h.
+//
+// The kernels below are LocalOperations::comformalAMIPS*_new() with double replaced by a lane type V. The lane
+// types only provide element-wise IEEE operations, and the expressions are kept in the same order, so every lane
+// width gives exactly the same results as the scalar code (the SIMD translation units are compiled with
+// -ffp-contract=off).
+//
+// A lane type V provides:
+//   - static const int width
+//   - static V load(const double *p) and void store(double *p) const
+//   - unary -, and +, -, *, / between two V or between a V and a double
+//   - pow(const V &x, double e)
+
+#include <cmath>
+
+namespace tetwild {
+namespace amips {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Scalar lane type, used for the fallback and for the tail of the SIMD batches
+struct Vec1d {
+    static const int width = 1;
+    double v;
+
+    Vec1d() = default;
+    Vec1d(double x) : v(x) { }
+
+    static Vec1d load(const double *p) { return Vec1d(*p); }
+    void store(double *p) const { *p = v; }
+
+    friend Vec1d operator-(const Vec1d &a) { return Vec1d(-a.v); }
+    friend Vec1d operator+(const Vec1d &a, const Vec1d &b) { return Vec1d(a.v + b.v); }
+    friend Vec1d operator-(const Vec1d &a, const Vec1d &b) { return Vec1d(a.v - b.v); }
+    friend Vec1d operator*(const Vec1d &a, const Vec1d &b) { return Vec1d(a.v * b.v); }
+    friend Vec1d operator/(const Vec1d &a, const Vec1d &b) { return Vec1d(a.v / b.v); }
+    friend Vec1d pow(const Vec1d &x, double e) { return Vec1d(e == 2 ? x.v * x.v : std::pow(x.v, e)); }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+template<typename V>
+inline V comformalAMIPSEnergy(const V *helper_0) {
+    const V helper_1 = helper_0[2];
+    const V helper_2 = helper_0[11];
+    const V helper_3 = helper_0[0];
+    const V helper_4 = helper_0[3];
+    const V helper_5 = helper_0[9];
+    const V helper_6 = 0.577350269189626 * helper_3 - 1.15470053837925 * helper_4 + 0.577350269189626 * helper_5;
+    const V helper_7 = helper_0[1];
+    const V helper_8 = helper_0[4];
+    const V helper_9 = helper_0[7];
+    const V helper_10 = helper_0[10];
+    const V helper_11 = 0.408248290463863 * helper_10 + 0.408248290463863 * helper_7 + 0.408248290463863 * helper_8 -
+                       1.22474487139159 * helper_9;
+    const V helper_12 = 0.577350269189626 * helper_10 + 0.577350269189626 * helper_7 - 1.15470053837925 * helper_8;
+    const V helper_13 = helper_0[6];
+    const V helper_14 = -1.22474487139159 * helper_13 + 0.408248290463863 * helper_3 + 0.408248290463863 * helper_4 +
+                       0.408248290463863 * helper_5;
+    const V helper_15 = helper_0[5];
+    const V helper_16 = helper_0[8];
+    const V helper_17 = 0.408248290463863 * helper_1 + 0.408248290463863 * helper_15 - 1.22474487139159 * helper_16 +
+                       0.408248290463863 * helper_2;
+    const V helper_18 = 0.577350269189626 * helper_1 - 1.15470053837925 * helper_15 + 0.577350269189626 * helper_2;
+    const V helper_19 = 0.5 * helper_13 + 0.5 * helper_4;
+    const V helper_20 = 0.5 * helper_8 + 0.5 * helper_9;
+    const V helper_21 = 0.5 * helper_15 + 0.5 * helper_16;
+    return -(helper_1 * (-1.5 * helper_1 + 0.5 * helper_2 + helper_21) +
+             helper_10 * (-1.5 * helper_10 + helper_20 + 0.5 * helper_7) +
+             helper_13 * (-1.5 * helper_13 + 0.5 * helper_3 + 0.5 * helper_4 + 0.5 * helper_5) +
+             helper_15 * (0.5 * helper_1 - 1.5 * helper_15 + 0.5 * helper_16 + 0.5 * helper_2) +
+             helper_16 * (0.5 * helper_1 + 0.5 * helper_15 - 1.5 * helper_16 + 0.5 * helper_2) +
+             helper_2 * (0.5 * helper_1 - 1.5 * helper_2 + helper_21) +
+             helper_3 * (helper_19 - 1.5 * helper_3 + 0.5 * helper_5) +
+             helper_4 * (0.5 * helper_13 + 0.5 * helper_3 - 1.5 * helper_4 + 0.5 * helper_5) +
+             helper_5 * (helper_19 + 0.5 * helper_3 - 1.5 * helper_5) +
+             helper_7 * (0.5 * helper_10 + helper_20 - 1.5 * helper_7) +
+             helper_8 * (0.5 * helper_10 + 0.5 * helper_7 - 1.5 * helper_8 + 0.5 * helper_9) +
+             helper_9 * (0.5 * helper_10 + 0.5 * helper_7 + 0.5 * helper_8 - 1.5 * helper_9)) *
+           pow(pow((helper_1 - helper_2) * (helper_11 * helper_6 - helper_12 * helper_14) -
+                   (-helper_10 + helper_7) * (-helper_14 * helper_18 + helper_17 * helper_6) +
+                   (helper_3 - helper_5) * (-helper_11 * helper_18 + helper_12 * helper_17), 2), -0.333333333333333);
+}
+
+template<typename V>
+inline void comformalAMIPSJacobian(const V *helper_0, V *result_0) {
+    const V helper_1 = helper_0[1];
+    const V helper_2 = helper_0[10];
+    const V helper_3 = helper_1 - helper_2;
+    const V helper_4 = helper_0[0];
+    const V helper_5 = helper_0[3];
+    const V helper_6 = helper_0[9];
+    const V helper_7 = 0.577350269189626*helper_4 - 1.15470053837925*helper_5 + 0.577350269189626*helper_6;
+    const V helper_8 = helper_0[2];
+    const V helper_9 = 0.408248290463863*helper_8;
+    const V helper_10 = helper_0[5];
+    const V helper_11 = 0.408248290463863*helper_10;
+    const V helper_12 = helper_0[8];
+    const V helper_13 = 1.22474487139159*helper_12;
+    const V helper_14 = helper_0[11];
+    const V helper_15 = 0.408248290463863*helper_14;
+    const V helper_16 = helper_11 - helper_13 + helper_15 + helper_9;
+    const V helper_17 = 0.577350269189626*helper_8;
+    const V helper_18 = 1.15470053837925*helper_10;
+    const V helper_19 = 0.577350269189626*helper_14;
+    const V helper_20 = helper_17 - helper_18 + helper_19;
+    const V helper_21 = helper_0[6];
+    const V helper_22 = -1.22474487139159*helper_21 + 0.408248290463863*helper_4 + 0.408248290463863*helper_5 + 0.408248290463863*helper_6;
+    const V helper_23 = helper_16*helper_7 - helper_20*helper_22;
+    const V helper_24 = -helper_14 + helper_8;
+    const V helper_25 = 0.408248290463863*helper_1;
+    const V helper_26 = helper_0[4];
+    const V helper_27 = 0.408248290463863*helper_26;
+    const V helper_28 = helper_0[7];
+    const V helper_29 = 1.22474487139159*helper_28;
+    const V helper_30 = 0.408248290463863*helper_2;
+    const V helper_31 = helper_25 + helper_27 - helper_29 + helper_30;
+    const V helper_32 = helper_31*helper_7;
+    const V helper_33 = 0.577350269189626*helper_1;
+    const V helper_34 = 1.15470053837925*helper_26;
+    const V helper_35 = 0.577350269189626*helper_2;
+    const V helper_36 = helper_33 - helper_34 + helper_35;
+    const V helper_37 = helper_22*helper_36;
+    const V helper_38 = helper_4 - helper_6;
+    const V helper_39 = helper_23*helper_3 - helper_24*(helper_32 - helper_37) - helper_38*(helper_16*helper_36 - helper_20*helper_31);
+    const V helper_40 = pow(pow(helper_39, 2), -0.333333333333333);
+    const V helper_41 = 0.707106781186548*helper_10 - 0.707106781186548*helper_12;
+    const V helper_42 = 0.707106781186548*helper_26 - 0.707106781186548*helper_28;
+    const V helper_43 = 0.5*helper_21 + 0.5*helper_5;
+    const V helper_44 = 0.5*helper_26 + 0.5*helper_28;
+    const V helper_45 = 0.5*helper_10 + 0.5*helper_12;
+    const V helper_46 = 0.666666666666667*(helper_1*(-1.5*helper_1 + 0.5*helper_2 + helper_44) + helper_10*(-1.5*helper_10 + 0.5*helper_12 + 0.5*helper_14 + 0.5*helper_8) + helper_12*(0.5*helper_10 - 1.5*helper_12 + 0.5*helper_14 + 0.5*helper_8) + helper_14*(-1.5*helper_14 + helper_45 + 0.5*helper_8) + helper_2*(0.5*helper_1 - 1.5*helper_2 + helper_44) + helper_21*(-1.5*helper_21 + 0.5*helper_4 + 0.5*helper_5 + 0.5*helper_6) + helper_26*(0.5*helper_1 + 0.5*helper_2 - 1.5*helper_26 + 0.5*helper_28) + helper_28*(0.5*helper_1 + 0.5*helper_2 + 0.5*helper_26 - 1.5*helper_28) + helper_4*(-1.5*helper_4 + helper_43 + 0.5*helper_6) + helper_5*(0.5*helper_21 + 0.5*helper_4 - 1.5*helper_5 + 0.5*helper_6) + helper_6*(0.5*helper_4 + helper_43 - 1.5*helper_6) + helper_8*(0.5*helper_14 + helper_45 - 1.5*helper_8))/helper_39;
+    const V helper_47 = -0.707106781186548*helper_21 + 0.707106781186548*helper_5;
+    result_0[0] = -helper_40*(1.0*helper_21 - 3.0*helper_4 + helper_46*(helper_41*(-helper_1 + helper_2) - helper_42*(helper_14 - helper_8) - (-helper_17 + helper_18 - helper_19)*(-helper_25 - helper_27 + helper_29 - helper_30) + (-helper_33 + helper_34 - helper_35)*(-helper_11 + helper_13 - helper_15 - helper_9)) + 1.0*helper_5 + 1.0*helper_6);
+    result_0[1] = helper_40*(3.0*helper_1 - 1.0*helper_2 - 1.0*helper_26 - 1.0*helper_28 + helper_46*(helper_23 + helper_24*helper_47 - helper_38*helper_41));
+    result_0[2] = helper_40*(-1.0*helper_10 - 1.0*helper_12 - 1.0*helper_14 + helper_46*(-helper_3*helper_47 - helper_32 + helper_37 + helper_38*helper_42) + 3.0*helper_8);
+}
+
+template<typename V>
+inline void comformalAMIPSHessian(const V *helper_0, V *result_0) {
+    const V helper_1 = helper_0[2];
+    const V helper_2 = helper_0[11];
+    const V helper_3 = helper_1 - helper_2;
+    const V helper_4 = helper_0[0];
+    const V helper_5 = 0.577350269189626*helper_4;
+    const V helper_6 = helper_0[3];
+    const V helper_7 = 1.15470053837925*helper_6;
+    const V helper_8 = helper_0[9];
+    const V helper_9 = 0.577350269189626*helper_8;
+    const V helper_10 = helper_5 - helper_7 + helper_9;
+    const V helper_11 = helper_0[1];
+    const V helper_12 = 0.408248290463863*helper_11;
+    const V helper_13 = helper_0[4];
+    const V helper_14 = 0.408248290463863*helper_13;
+    const V helper_15 = helper_0[7];
+    const V helper_16 = 1.22474487139159*helper_15;
+    const V helper_17 = helper_0[10];
+    const V helper_18 = 0.408248290463863*helper_17;
+    const V helper_19 = helper_12 + helper_14 - helper_16 + helper_18;
+    const V helper_20 = helper_10*helper_19;
+    const V helper_21 = 0.577350269189626*helper_11;
+    const V helper_22 = 1.15470053837925*helper_13;
+    const V helper_23 = 0.577350269189626*helper_17;
+    const V helper_24 = helper_21 - helper_22 + helper_23;
+    const V helper_25 = 0.408248290463863*helper_4;
+    const V helper_26 = 0.408248290463863*helper_6;
+    const V helper_27 = helper_0[6];
+    const V helper_28 = 1.22474487139159*helper_27;
+    const V helper_29 = 0.408248290463863*helper_8;
+    const V helper_30 = helper_25 + helper_26 - helper_28 + helper_29;
+    const V helper_31 = helper_24*helper_30;
+    const V helper_32 = helper_3*(helper_20 - helper_31);
+    const V helper_33 = helper_4 - helper_8;
+    const V helper_34 = 0.408248290463863*helper_1;
+    const V helper_35 = helper_0[5];
+    const V helper_36 = 0.408248290463863*helper_35;
+    const V helper_37 = helper_0[8];
+    const V helper_38 = 1.22474487139159*helper_37;
+    const V helper_39 = 0.408248290463863*helper_2;
+    const V helper_40 = helper_34 + helper_36 - helper_38 + helper_39;
+    const V helper_41 = helper_24*helper_40;
+    const V helper_42 = 0.577350269189626*helper_1;
+    const V helper_43 = 1.15470053837925*helper_35;
+    const V helper_44 = 0.577350269189626*helper_2;
+    const V helper_45 = helper_42 - helper_43 + helper_44;
+    const V helper_46 = helper_19*helper_45;
+    const V helper_47 = helper_41 - helper_46;
+    const V helper_48 = helper_33*helper_47;
+    const V helper_49 = helper_11 - helper_17;
+    const V helper_50 = helper_10*helper_40;
+    const V helper_51 = helper_30*helper_45;
+    const V helper_52 = helper_50 - helper_51;
+    const V helper_53 = helper_49*helper_52;
+    const V helper_54 = helper_32 + helper_48 - helper_53;
+    const V helper_55 = pow(helper_54, 2);
+    const V helper_56 = pow(helper_55, -0.333333333333333);
+    const V helper_57 = 1.0*helper_27 - 3.0*helper_4 + 1.0*helper_6 + 1.0*helper_8;
+    const V helper_58 = 0.707106781186548*helper_13;
+    const V helper_59 = 0.707106781186548*helper_15;
+    const V helper_60 = helper_58 - helper_59;
+    const V helper_61 = helper_3*helper_60;
+    const V helper_62 = 0.707106781186548*helper_35 - 0.707106781186548*helper_37;
+    const V helper_63 = helper_49*helper_62;
+    const V helper_64 = helper_47 + helper_61 - helper_63;
+    const V helper_65 = 1.33333333333333/helper_54;
+    const V helper_66 = 1.0/helper_55;
+    const V helper_67 = 0.5*helper_27 + 0.5*helper_6;
+    const V helper_68 = -1.5*helper_4 + helper_67 + 0.5*helper_8;
+    const V helper_69 = 0.5*helper_4 + helper_67 - 1.5*helper_8;
+    const V helper_70 = -1.5*helper_27 + 0.5*helper_4 + 0.5*helper_6 + 0.5*helper_8;
+    const V helper_71 = 0.5*helper_27 + 0.5*helper_4 - 1.5*helper_6 + 0.5*helper_8;
+    const V helper_72 = 0.5*helper_13 + 0.5*helper_15;
+    const V helper_73 = -1.5*helper_11 + 0.5*helper_17 + helper_72;
+    const V helper_74 = 0.5*helper_11 - 1.5*helper_17 + helper_72;
+    const V helper_75 = 0.5*helper_11 + 0.5*helper_13 - 1.5*helper_15 + 0.5*helper_17;
+    const V helper_76 = 0.5*helper_11 - 1.5*helper_13 + 0.5*helper_15 + 0.5*helper_17;
+    const V helper_77 = 0.5*helper_35 + 0.5*helper_37;
+    const V helper_78 = -1.5*helper_1 + 0.5*helper_2 + helper_77;
+    const V helper_79 = 0.5*helper_1 - 1.5*helper_2 + helper_77;
+    const V helper_80 = 0.5*helper_1 + 0.5*helper_2 + 0.5*helper_35 - 1.5*helper_37;
+    const V helper_81 = 0.5*helper_1 + 0.5*helper_2 - 1.5*helper_35 + 0.5*helper_37;
+    const V helper_82 = helper_1*helper_78 + helper_11*helper_73 + helper_13*helper_76 + helper_15*helper_75 + helper_17*helper_74 + helper_2*helper_79 + helper_27*helper_70 + helper_35*helper_81 + helper_37*helper_80 + helper_4*helper_68 + helper_6*helper_71 + helper_69*helper_8;
+    const V helper_83 = 0.444444444444444*helper_66*helper_82;
+    const V helper_84 = helper_66*helper_82;
+    const V helper_85 = -helper_32 - helper_48 + helper_53;
+    const V helper_86 = 1.0/helper_85;
+    const V helper_87 = helper_86*pow(pow(helper_85, 2), -0.333333333333333);
+    const V helper_88 = 0.707106781186548*helper_6;
+    const V helper_89 = 0.707106781186548*helper_27;
+    const V helper_90 = helper_88 - helper_89;
+    const V helper_91 = 0.666666666666667*helper_10*helper_40 + 0.666666666666667*helper_3*helper_90 - 0.666666666666667*helper_30*helper_45 - 0.666666666666667*helper_33*helper_62;
+    const V helper_92 = -3.0*helper_11 + 1.0*helper_13 + 1.0*helper_15 + 1.0*helper_17;
+    const V helper_93 = -helper_11 + helper_17;
+    const V helper_94 = -helper_1 + helper_2;
+    const V helper_95 = -helper_21 + helper_22 - helper_23;
+    const V helper_96 = -helper_34 - helper_36 + helper_38 - helper_39;
+    const V helper_97 = -helper_42 + helper_43 - helper_44;
+    const V helper_98 = -helper_12 - helper_14 + helper_16 - helper_18;
+    const V helper_99 = -0.666666666666667*helper_60*helper_94 + 0.666666666666667*helper_62*helper_93 + 0.666666666666667*helper_95*helper_96 - 0.666666666666667*helper_97*helper_98;
+    const V helper_100 = helper_3*helper_90;
+    const V helper_101 = helper_33*helper_62;
+    const V helper_102 = helper_100 - helper_101 + helper_52;
+    const V helper_103 = -helper_60*helper_94 + helper_62*helper_93 + helper_95*helper_96 - helper_97*helper_98;
+    const V helper_104 = 0.444444444444444*helper_102*helper_103*helper_82*helper_86 + helper_57*helper_91 - helper_92*helper_99;
+    const V helper_105 = 1.85037170770859e-17*helper_1*helper_78 + 1.85037170770859e-17*helper_11*helper_73 + 1.85037170770859e-17*helper_13*helper_76 + 1.85037170770859e-17*helper_15*helper_75 + 1.85037170770859e-17*helper_17*helper_74 + 1.85037170770859e-17*helper_2*helper_79 + 1.85037170770859e-17*helper_27*helper_70 + 1.85037170770859e-17*helper_35*helper_81 + 1.85037170770859e-17*helper_37*helper_80 + 1.85037170770859e-17*helper_4*helper_68 + 1.85037170770859e-17*helper_6*helper_71 + 1.85037170770859e-17*helper_69*helper_8;
+    const V helper_106 = helper_64*helper_82*helper_86;
+    const V helper_107 = -0.666666666666667*helper_10*helper_19 + 0.666666666666667*helper_24*helper_30 + 0.666666666666667*helper_33*helper_60 - 0.666666666666667*helper_49*helper_90;
+    const V helper_108 = -3.0*helper_1 + 1.0*helper_2 + 1.0*helper_35 + 1.0*helper_37;
+    const V helper_109 = -helper_20 + helper_31 + helper_33*helper_60 - helper_49*helper_90;
+    const V helper_110 = 0.444444444444444*helper_109*helper_82*helper_86;
+    const V helper_111 = helper_103*helper_110 + helper_107*helper_57 - helper_108*helper_99;
+    const V helper_112 = -helper_4 + helper_8;
+    const V helper_113 = -helper_88 + helper_89;
+    const V helper_114 = -helper_5 + helper_7 - helper_9;
+    const V helper_115 = -helper_25 - helper_26 + helper_28 - helper_29;
+    const V helper_116 = helper_82*helper_86*(helper_112*helper_62 + helper_113*helper_94 + helper_114*helper_96 - helper_115*helper_97);
+    const V helper_117 = -helper_100 + helper_101 - helper_50 + helper_51;
+    const V helper_118 = -helper_102*helper_110 + helper_107*helper_92 + helper_108*helper_91;
+    const V helper_119 = helper_82*helper_86*(helper_112*(-helper_58 + helper_59) - helper_113*helper_93 - helper_114*helper_98 + helper_115*helper_95);
+    result_0[0] = helper_56*(helper_57*helper_64*helper_65 - pow(helper_64, 2)*helper_83 + 0.666666666666667*helper_64*helper_84*(-helper_41 + helper_46 - helper_61 + helper_63) + 3.0);
+    result_0[1] = helper_87*(helper_104 - helper_105*helper_35 + helper_106*helper_91);
+    result_0[2] = helper_87*(helper_106*helper_107 + helper_111);
+    result_0[3] = helper_87*(helper_104 + helper_116*helper_99);
+    result_0[4] = helper_56*(-pow(helper_117, 2)*helper_83 + helper_117*helper_65*helper_92 + helper_117*helper_84*helper_91 + 3.0);
+    result_0[5] = helper_87*(-helper_105*helper_6 - helper_107*helper_116 + helper_118);
+    result_0[6] = helper_87*(-helper_105*helper_13 + helper_111 + helper_119*helper_99);
+    result_0[7] = helper_87*(helper_118 - helper_119*helper_91);
+    result_0[8] = helper_56*(-helper_108*helper_109*helper_65 - 1.11111111111111*pow(helper_109, 2)*helper_84 + 3.0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// T[k][i] is the k-th coordinate (x0, y0, z0, ..., z3) of the i-th tet, result[k][i] the k-th output for it.
+// The batch functions process whole lanes of tets from begin on, and return the index of the first tet left over.
+
+template<typename V>
+inline void loadTets(const double * const *T, int i, V *t) {
+    for (int k = 0; k < 12; k++) {
+        t[k] = V::load(T[k] + i);
+    }
+}
+
+template<typename V>
+int comformalAMIPSEnergyBatch(int begin, int n, const double * const *T, double *result) {
+    int i = begin;
+    for (; i + V::width <= n; i += V::width) {
+        V t[12];
+        loadTets(T, i, t);
+        comformalAMIPSEnergy(t).store(result + i);
+    }
+    return i;
+}
+
+template<typename V>
+int comformalAMIPSJacobianBatch(int begin, int n, const double * const *T, double * const *result) {
+    int i = begin;
+    for (; i + V::width <= n; i += V::width) {
+        V t[12];
+        V r[3];
+        loadTets(T, i, t);
+        comformalAMIPSJacobian(t, r);
+        for (int k = 0; k < 3; k++) {
+            r[k].store(result[k] + i);
+        }
+    }
+    return i;
+}
+
+template<typename V>
+int comformalAMIPSHessianBatch(int begin, int n, const double * const *T, double * const *result) {
+    int i = begin;
+    for (; i + V::width <= n; i += V::width) {
+        V t[12];
+        V r[9];
+        loadTets(T, i, t);
+        comformalAMIPSHessian(t, r);
+        for (int k = 0; k < 9; k++) {
+            r[k].store(result[k] + i);
+        }
+    }
+    return i;
+}
+
+} // namespace amips
+} // namespace tetwild
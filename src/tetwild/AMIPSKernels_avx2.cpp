@@ -0,0 +1,68 @@
+// This file is part of TetWild, a software for generating tetrahedral meshes.
+//
+// This Source Code Form is subject to the terms of the Mozilla Public License
+// v. 2.0. If a copy of the MPL was not distributed with this file, You can
+// obtain one at http://mozilla.org/MPL/2.0/.
+//
+
+// Compiled with -mavx2 -ffp-contract=off. Only reached when the CPU supports AVX2 (see getSimdLevel()), so nothing
+// in here may be shared with the other translation units: the lane type has internal linkage and the scalar tail
+// is handled by the caller.
+
+#ifdef TETWILD_WITH_SIMD_KERNELS
+
+#include <tetwild/AMIPSKernelsImpl.h>
+#include <immintrin.h>
+
+namespace tetwild {
+namespace amips {
+
+namespace {
+
+struct Vec4d {
+    static const int width = 4;
+    __m256d v;
+
+    Vec4d() = default;
+    Vec4d(__m256d x) : v(x) { }
+    Vec4d(double x) : v(_mm256_set1_pd(x)) { }
+
+    static Vec4d load(const double *p) { return _mm256_loadu_pd(p); }
+    void store(double *p) const { _mm256_storeu_pd(p, v); }
+
+    friend Vec4d operator-(const Vec4d &a) { return _mm256_xor_pd(a.v, _mm256_set1_pd(-0.0)); }
+    friend Vec4d operator+(const Vec4d &a, const Vec4d &b) { return _mm256_add_pd(a.v, b.v); }
+    friend Vec4d operator-(const Vec4d &a, const Vec4d &b) { return _mm256_sub_pd(a.v, b.v); }
+    friend Vec4d operator*(const Vec4d &a, const Vec4d &b) { return _mm256_mul_pd(a.v, b.v); }
+    friend Vec4d operator/(const Vec4d &a, const Vec4d &b) { return _mm256_div_pd(a.v, b.v); }
+    friend Vec4d pow(const Vec4d &x, double e) {
+        if (e == 2) {
+            return x * x;
+        }
+        alignas(32) double a[4];
+        _mm256_store_pd(a, x.v);
+        for (int k = 0; k < 4; k++) {
+            a[k] = std::pow(a[k], e);
+        }
+        return _mm256_load_pd(a);
+    }
+};
+
+} // anonymous namespace
+
+int comformalAMIPSEnergyBatch_avx2(int begin, int n, const double * const *T, double *result) {
+    return comformalAMIPSEnergyBatch<Vec4d>(begin, n, T, result);
+}
+
+int comformalAMIPSJacobianBatch_avx2(int begin, int n, const double * const *T, double * const *result) {
+    return comformalAMIPSJacobianBatch<Vec4d>(begin, n, T, result);
+}
+
+int comformalAMIPSHessianBatch_avx2(int begin, int n, const double * const *T, double * const *result) {
+    return comformalAMIPSHessianBatch<Vec4d>(begin, n, T, result);
+}
+
+} // namespace amips
+} // namespace tetwild
+
+#endif
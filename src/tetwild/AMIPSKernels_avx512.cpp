@@ -0,0 +1,72 @@
+// This file is part of TetWild, a software for generating tetrahedral meshes.
+//
+// This Source Code Form is subject to the terms of the Mozilla Public License
+// v. 2.0. If a copy of the MPL was not distributed with this file, You can
+// obtain one at http://mozilla.org/MPL/2.0/.
+//
+
+// Compiled with -mavx512f -ffp-contract=off. Only reached when the CPU supports AVX-512F (see getSimdLevel()), so nothing
+// in here may be shared with the other translation units: the lane type has internal linkage and the scalar tail
+// is handled by the caller.
+
+#ifdef TETWILD_WITH_SIMD_KERNELS
+
+#include <tetwild/AMIPSKernelsImpl.h>
+#include <immintrin.h>
+
+namespace tetwild {
+namespace amips {
+
+namespace {
+
+struct Vec8d {
+    static const int width = 8;
+    __m512d v;
+
+    Vec8d() = default;
+    Vec8d(__m512d x) : v(x) { }
+    Vec8d(double x) : v(_mm512_set1_pd(x)) { }
+
+    static Vec8d load(const double *p) { return _mm512_loadu_pd(p); }
+    void store(double *p) const { _mm512_storeu_pd(p, v); }
+
+    friend Vec8d operator-(const Vec8d &a) {
+        // _mm512_xor_pd needs AVX512DQ
+        return _mm512_castsi512_pd(_mm512_xor_si512(_mm512_castpd_si512(a.v),
+                                                    _mm512_set1_epi64((long long) 0x8000000000000000ULL)));
+    }
+    friend Vec8d operator+(const Vec8d &a, const Vec8d &b) { return _mm512_add_pd(a.v, b.v); }
+    friend Vec8d operator-(const Vec8d &a, const Vec8d &b) { return _mm512_sub_pd(a.v, b.v); }
+    friend Vec8d operator*(const Vec8d &a, const Vec8d &b) { return _mm512_mul_pd(a.v, b.v); }
+    friend Vec8d operator/(const Vec8d &a, const Vec8d &b) { return _mm512_div_pd(a.v, b.v); }
+    friend Vec8d pow(const Vec8d &x, double e) {
+        if (e == 2) {
+            return x * x;
+        }
+        alignas(64) double a[8];
+        _mm512_store_pd(a, x.v);
+        for (int k = 0; k < 8; k++) {
+            a[k] = std::pow(a[k], e);
+        }
+        return _mm512_load_pd(a);
+    }
+};
+
+} // anonymous namespace
+
+int comformalAMIPSEnergyBatch_avx512(int begin, int n, const double * const *T, double *result) {
+    return comformalAMIPSEnergyBatch<Vec8d>(begin, n, T, result);
+}
+
+int comformalAMIPSJacobianBatch_avx512(int begin, int n, const double * const *T, double * const *result) {
+    return comformalAMIPSJacobianBatch<Vec8d>(begin, n, T, result);
+}
+
+int comformalAMIPSHessianBatch_avx512(int begin, int n, const double * const *T, double * const *result) {
+    return comformalAMIPSHessianBatch<Vec8d>(begin, n, T, result);
+}
+
+} // namespace amips
+} // namespace tetwild
+
+#endif
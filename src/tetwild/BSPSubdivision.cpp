@@ -13,6 +13,7 @@
 #include <tetwild/MeshConformer.h>
 #include <tetwild/Logger.h>
 #include <tetwild/Args.h>
+#include <tetwild/Parallel.h>
 
 namespace tetwild {
 
@@ -35,6 +36,116 @@ void BSPSubdivision::init() {
 }
 
 void BSPSubdivision::subdivideBSPNodes(const Args &args) {
+    int num_threads = getNumThreads(args.num_threads);
+    //copying a lazy exact object updates the reference counts of the representations it shares, which is not
+    //thread-safe: the planes are constructed here, and the workers only read them and the points by reference
+    div_planes.clear();
+    div_planes.reserve(MC.m_faces.size());
+    for (const auto& f : MC.m_faces)
+        div_planes.emplace_back(MC.m_vertices[f[0]], MC.m_vertices[f[1]], MC.m_vertices[f[2]]);
+    if (num_threads > 1) {
+        //a lazy evaluation also updates the shared representations, so none may happen in the workers' predicates
+        for (auto& p : MC.m_vertices)
+            CGAL::exact(p);
+        for (auto& p : MC.bsp_vertices)
+            CGAL::exact(p);
+        for (auto& pln : div_planes)
+            CGAL::exact(pln);
+    }
+
+    //the nodes of a batch are planned in parallel, then divided one by one in queue order. dividing a node only adds
+    //to its neighbors vertices lying on their edges and halves of their faces, which changes neither the plane they
+    //are divided by nor the sides of their previous vertices: the result is the same as processing the nodes one
+    //by one, whatever the number of threads
+    const int batch_size = num_threads > 1 ? 8192 : 1;
+    std::vector<int> n_ids;
+    std::vector<NodeDivision> divisions;
+    std::vector<int> new_v_ids;
+    size_t progress_current = 0;
+    while (!processing_n_ids.empty()) {
+        n_ids.clear();
+        while (!processing_n_ids.empty() && n_ids.size() < batch_size) {
+            n_ids.push_back(processing_n_ids.front());
+            processing_n_ids.pop();
+        }
+
+        divisions.resize(n_ids.size());
+        parallelFor((int) n_ids.size(), num_threads, [&](int i, int thread_id) {
+            planDivision(n_ids[i], divisions[i]);
+        }, 1);
+
+        new_v_ids.clear();
+        for (int i = 0; i < n_ids.size(); i++) {
+            if (args.user_callback) {
+                args.user_callback(Step::BSP, double(progress_current)
+                                              / double(progress_current + processing_n_ids.size() + n_ids.size() - i));
+            }
+            ++progress_current;
+            divideNode(n_ids[i], divisions[i], new_v_ids);
+        }
+
+        if (num_threads > 1) {
+            //serially, the evaluation releases the handles of the segments and planes the new vertices were built from
+            for (int v_id : new_v_ids)
+                CGAL::exact(MC.bsp_vertices[v_id]);
+        }
+    }
+}
+
+void BSPSubdivision::planDivision(int n_id, NodeDivision& division) {
+    const std::vector<BSPFace> &faces = MC.bsp_faces;
+    const BSPtreeNode &node = MC.bsp_nodes[n_id];
+    const std::vector<Point_3> &div_vertices = MC.m_vertices;
+    const std::vector<std::array<int, 3>> &div_faces = MC.m_faces;
+
+    division.v_sides.clear();
+    division.rm_df_ids.clear();
+    division.df_sides.clear();
+    division.on_df_id = -1;
+    division.is_divide = false;
+
+    std::unordered_set<int> v_ids;
+    for (int i = 0; i < node.faces.size(); i++) {
+        for (int j = 0; j < faces[node.faces[i]].vertices.size(); j++) {
+            v_ids.insert(faces[node.faces[i]].vertices[j]);
+        }
+    }
+
+    ///re-assign divfaces
+    for (auto it = node.div_faces.begin(); it != node.div_faces.end(); it++) {
+        ///map sides for vertices
+        division.v_sides.clear();
+        calVertexSides(div_planes[*it], v_ids, MC.bsp_vertices, division.v_sides);
+        int cnt_pos = 0, cnt_neg = 0;
+        for (auto jt = division.v_sides.begin(); jt != division.v_sides.end(); jt++) {
+            if (jt->second == V_POS)
+                cnt_pos++;
+            if (jt->second == V_NEG)
+                cnt_neg++;
+        }
+        if (cnt_pos == 0 || cnt_neg == 0) { //fixed//but how could it happen??
+            division.rm_df_ids.push_back(*it);
+        } else {
+            division.is_divide = true;
+            division.on_df_id = *it;
+            break;
+        }
+    }
+    if (!division.is_divide)
+        return;
+
+    for (auto it = node.div_faces.begin(); it != node.div_faces.end(); it++) {
+        if (std::find(division.rm_df_ids.begin(), division.rm_df_ids.end(), *it) != division.rm_df_ids.end())
+            continue;
+        if (*it == division.on_df_id) {
+            division.df_sides[*it] = DIVFACE_ON;
+            continue;
+        }
+        division.df_sides[*it] = divfaceSide(div_planes[division.on_df_id], div_faces[*it], div_vertices);
+    }
+}
+
+void BSPSubdivision::divideNode(int old_n_id, NodeDivision& division, std::vector<int>& new_v_ids) {
     std::vector<BSPtreeNode> &nodes = MC.bsp_nodes;
     std::vector<BSPFace> &faces = MC.bsp_faces;
     std::vector<BSPEdge> &edges = MC.bsp_edges;
@@ -42,298 +153,259 @@ void BSPSubdivision::subdivideBSPNodes(const Args &args) {
     const std::vector<Point_3> &div_vertices = MC.m_vertices;
     const std::vector<std::array<int, 3>> &div_faces = MC.m_faces;
 
-    size_t progress_current = 0;
-    size_t progress_total = processing_n_ids.size();
-    while (!processing_n_ids.empty()) {
-        int old_n_id = processing_n_ids.front();
-        processing_n_ids.pop();
+    if (!division.rm_df_ids.empty())
+        nodes[old_n_id].is_leaf = true;
+    if (!division.is_divide)
+        return;
+
+    const Plane_3& pln = div_planes[division.on_df_id];
+    std::unordered_map<int, int>& v_sides = division.v_sides;
+    ///the nodes divided since the planning may have added vertices to this one
+    std::unordered_set<int> v_ids;
+    for (int i = 0; i < nodes[old_n_id].faces.size(); i++) {
+        for (int j = 0; j < faces[nodes[old_n_id].faces[i]].vertices.size(); j++) {
+            if (v_sides.find(faces[nodes[old_n_id].faces[i]].vertices[j]) == v_sides.end())
+                v_ids.insert(faces[nodes[old_n_id].faces[i]].vertices[j]);
+        }
+    }
+    calVertexSides(pln, v_ids, vertices, v_sides);
+    CGAL::exact(pln);
+
+    ///from here, the node would definitely be subdivided
+    BSPtreeNode pos_node, neg_node;
+    BSPFace on_face;
+    nodes.push_back(neg_node);
+    int new_n_id = nodes.size() - 1;
+    std::vector<int> new_n_ids = {old_n_id, new_n_id};
+
+    for (auto it = nodes[old_n_id].div_faces.begin(); it != nodes[old_n_id].div_faces.end(); it++) {
+        auto df_it = division.df_sides.find(*it);
+        if (df_it == division.df_sides.end())
+            continue;
+        int side = df_it->second;
+        if (side == DIVFACE_POS)
+            pos_node.div_faces.insert(*it);
+        else if (side == DIVFACE_NEG)
+            neg_node.div_faces.insert(*it);
+        else if (side == DIVFACE_ON)
+            on_face.div_faces.insert(*it);
+        else if (side == DIVFACE_CROSS) {
+            pos_node.div_faces.insert(*it);
+            neg_node.div_faces.insert(*it);
+        }
+    }
+
+    ///split nodes
+    for (int i = 0; i < nodes[old_n_id].faces.size(); i++) {
+        int old_f_id = nodes[old_n_id].faces[i];
 
-        if (args.user_callback) {
-            args.user_callback(Step::BSP, double(progress_current) / double(progress_total));
+        ///check if need splitting
+        int cnt_pos = 0, cnt_neg = 0, cnt_on = 0;
+        for (int j = 0; j < faces[old_f_id].vertices.size(); j++) {
+            if (v_sides[faces[old_f_id].vertices[j]] == V_POS)
+                cnt_pos++;
+            else if (v_sides[faces[old_f_id].vertices[j]] == V_NEG)
+                cnt_neg++;
+            else
+                cnt_on++;
         }
-        ++progress_current;
-
-        ///re-assign divfaces
-        int cnt_pos=0, cnt_neg=0;
-        Plane_3 pln;
-        std::unordered_set<int> v_ids;
-        std::unordered_map<int, int> v_sides;
-        std::vector<int> rm_df_ids;
-        int on_df_id;
-        bool is_divide=false;
-        for(auto it=nodes[old_n_id].div_faces.begin(); it!=nodes[old_n_id].div_faces.end();it++) {
-            pln = Plane_3(div_vertices[div_faces[*it][0]],
-                          div_vertices[div_faces[*it][1]],
-                          div_vertices[div_faces[*it][2]]);
-            ///map sides for vertices
-            v_ids.clear();
-            for (int i = 0; i < nodes[old_n_id].faces.size(); i++) {
-                for (int j = 0; j < faces[nodes[old_n_id].faces[i]].vertices.size(); j++) {
-                    v_ids.insert(faces[nodes[old_n_id].faces[i]].vertices[j]);
-                }
-            }
-            v_sides.clear();
-            calVertexSides(pln, v_ids, vertices, v_sides);
-            cnt_pos=0;
-            cnt_neg=0;
-            for (auto it = v_sides.begin(); it != v_sides.end(); it++) {
-                if (it->second == V_POS)
-                    cnt_pos++;
-                if (it->second == V_NEG)
-                    cnt_neg++;
-            }
-            if (cnt_pos == 0 || cnt_neg == 0) { //fixed//but how could it happen??
-                nodes[old_n_id].is_leaf = true;
-                rm_df_ids.push_back(*it);
-            }
-            else{
-                is_divide=true;
-                on_df_id=*it;
-                break;
+        if (cnt_pos + cnt_on == faces[old_f_id].vertices.size()) {
+            pos_node.faces.push_back(old_f_id);
+            if (cnt_on == 0) {
+                continue;
             }
         }
-        if(!is_divide)
-            continue;
-        ///from here, the node would definitely be subdivided
-        BSPtreeNode pos_node, neg_node;
-        BSPFace on_face;
-        nodes.push_back(neg_node);
-        int new_n_id = nodes.size() - 1;
-        std::vector<int> new_n_ids = {old_n_id, new_n_id};
-
-        for (auto it = nodes[old_n_id].div_faces.begin(); it != nodes[old_n_id].div_faces.end(); it++) {
-            if(std::find(rm_df_ids.begin(), rm_df_ids.end(), *it)!=rm_df_ids.end())
+        if (cnt_neg + cnt_on == faces[old_f_id].vertices.size()) {
+            neg_node.faces.push_back(old_f_id);
+            if (cnt_on == 0) {
                 continue;
-            if (*it == on_df_id) {
-                on_face.div_faces.insert(*it);
-                continue;
-            }
-
-            int side = divfaceSide(pln, div_faces[*it], div_vertices);
-            if (side == DIVFACE_POS)
-                pos_node.div_faces.insert(*it);
-            else if (side == DIVFACE_NEG)
-                neg_node.div_faces.insert(*it);
-            else if (side == DIVFACE_ON)
-                on_face.div_faces.insert(*it);
-            else if (side == DIVFACE_CROSS) {
-                pos_node.div_faces.insert(*it);
-                neg_node.div_faces.insert(*it);
             }
         }
 
-        ///split nodes
-        for (int i = 0; i < nodes[old_n_id].faces.size(); i++) {
-            int old_f_id = nodes[old_n_id].faces[i];
+        ///splitting...
+        BSPFace pos_face, neg_face;
+        BSPEdge on_edge;
+        int new_f_id = faces.size();
+        std::vector<int> new_f_ids = {old_f_id, new_f_id};
+
+        bool is_connected=false;
+        for (int j = 0; j < faces[old_f_id].edges.size(); j++) {
+            int old_e_id = faces[old_f_id].edges[j];
 
             ///check if need splitting
-            int cnt_pos = 0, cnt_neg = 0, cnt_on = 0;
-            for (int j = 0; j < faces[old_f_id].vertices.size(); j++) {
-                if (v_sides[faces[old_f_id].vertices[j]] == V_POS)
-                    cnt_pos++;
-                else if (v_sides[faces[old_f_id].vertices[j]] == V_NEG)
-                    cnt_neg++;
+            std::vector<int> pos_vs, neg_vs, on_vs;
+            for (int j = 0; j < edges[old_e_id].vertices.size(); j++) {
+                if (v_sides[edges[old_e_id].vertices[j]] == V_POS)
+                    pos_vs.push_back(edges[old_e_id].vertices[j]);
+                else if (v_sides[edges[old_e_id].vertices[j]] == V_NEG)
+                    neg_vs.push_back(edges[old_e_id].vertices[j]);
                 else
-                    cnt_on++;
+                    on_vs.push_back(edges[old_e_id].vertices[j]);
             }
-            if (cnt_pos + cnt_on == faces[old_f_id].vertices.size()) {
-                pos_node.faces.push_back(old_f_id);
-                if (cnt_on == 0) {
-                    continue;
-                }
+            if (on_vs.size() == 2) {
+                if (std::find(on_face.edges.begin(), on_face.edges.end(), old_e_id) == on_face.edges.end())
+                    on_face.edges.push_back(old_e_id);
+                is_connected=true;
             }
-            if (cnt_neg + cnt_on == faces[old_f_id].vertices.size()) {
-                neg_node.faces.push_back(old_f_id);
-                if (cnt_on == 0) {
-                    continue;
-                }
+            if(is_connected)
+                continue;
+            if (pos_vs.size() + on_vs.size() == 2) {
+                pos_face.edges.push_back(old_e_id);
+                if (on_vs.size() > 0 &&
+                    std::find(on_edge.vertices.begin(), on_edge.vertices.end(), on_vs[0]) == on_edge.vertices.end())
+                    on_edge.vertices.push_back(on_vs[0]);
+                continue;
             }
-
-            ///splitting...
-            BSPFace pos_face, neg_face;
-            BSPEdge on_edge;
-            int new_f_id = faces.size();
-            std::vector<int> new_f_ids = {old_f_id, new_f_id};
-
-            bool is_connected=false;
-            for (int j = 0; j < faces[old_f_id].edges.size(); j++) {
-                int old_e_id = faces[old_f_id].edges[j];
-
-                ///check if need splitting
-                std::vector<int> pos_vs, neg_vs, on_vs;
-                for (int j = 0; j < edges[old_e_id].vertices.size(); j++) {
-                    if (v_sides[edges[old_e_id].vertices[j]] == V_POS)
-                        pos_vs.push_back(edges[old_e_id].vertices[j]);
-                    else if (v_sides[edges[old_e_id].vertices[j]] == V_NEG)
-                        neg_vs.push_back(edges[old_e_id].vertices[j]);
-                    else
-                        on_vs.push_back(edges[old_e_id].vertices[j]);
-                }
-                if (on_vs.size() == 2) {
-                    if (std::find(on_face.edges.begin(), on_face.edges.end(), old_e_id) == on_face.edges.end())
-                        on_face.edges.push_back(old_e_id);
-                    is_connected=true;
-                }
-                if(is_connected)
-                    continue;
-                if (pos_vs.size() + on_vs.size() == 2) {
-                    pos_face.edges.push_back(old_e_id);
-                    if (on_vs.size() > 0 &&
-                        std::find(on_edge.vertices.begin(), on_edge.vertices.end(), on_vs[0]) == on_edge.vertices.end())
-                        on_edge.vertices.push_back(on_vs[0]);
-                    continue;
-                }
-                if (neg_vs.size() + on_vs.size() == 2) {
-                    neg_face.edges.push_back(old_e_id);
-                    if (on_vs.size() > 0 &&
-                        std::find(on_edge.vertices.begin(), on_edge.vertices.end(), on_vs[0]) == on_edge.vertices.end())
-                        on_edge.vertices.push_back(on_vs[0]);
-                    continue;
-                }
-
-                ///splitting...
-                BSPEdge pos_edge, neg_edge;
-                edges.push_back(neg_edge);
-                int new_e_id = edges.size() - 1;
-                std::vector<int> new_e_ids = {old_e_id, new_e_id};
-
-                pos_edge.vertices.push_back(pos_vs[0]);
-                neg_edge.vertices.push_back(neg_vs[0]);
-
-                int new_v_id = 0;
-                Segment_3 seg(vertices[edges[old_e_id].vertices[0]], vertices[edges[old_e_id].vertices[1]]);
-                auto result = intersection(seg, pln);
-                if (result) {
-                    const Point_3 *p = boost::get<Point_3>(&*result);
-                    vertices.push_back(*p);
-
-                    new_v_id = vertices.size() - 1;
-                    on_edge.vertices.push_back(new_v_id);
-                    pos_edge.vertices.push_back(new_v_id);
-                    neg_edge.vertices.push_back(new_v_id);
-
-                    v_sides[new_v_id] = V_ON;//fixed
-                } else {
-                    log_and_throw("error cal p!");
-                }
-
-                ///add edges
-                pos_edge.conn_faces = edges[old_e_id].conn_faces;
-                neg_edge.conn_faces = edges[old_e_id].conn_faces;
-                for (auto it = edges[old_e_id].conn_faces.begin(); it != edges[old_e_id].conn_faces.end(); it++) {
-                    if (*it == old_f_id)
-                        continue;
-                    faces[*it].edges.push_back(new_e_id);
-                    faces[*it].vertices.push_back(new_v_id);
-                }
-                edges[new_e_ids[0]] = pos_edge;//if get here, it means that old_edge has been cut into 2
-                edges[new_e_ids[1]] = neg_edge;
-
-                ///add edges for faces
-                pos_face.edges.push_back(new_e_ids[0]);
-                neg_face.edges.push_back(new_e_ids[1]);
-            }//split one face end
-
-            if (pos_face.edges.size() == 0 || neg_face.edges.size() == 0)//connected pos/neg
+            if (neg_vs.size() + on_vs.size() == 2) {
+                neg_face.edges.push_back(old_e_id);
+                if (on_vs.size() > 0 &&
+                    std::find(on_edge.vertices.begin(), on_edge.vertices.end(), on_vs[0]) == on_edge.vertices.end())
+                    on_edge.vertices.push_back(on_vs[0]);
                 continue;
+            }
 
-            ///from now, the face would definitely be subdivided
-            faces.push_back(neg_face);//have to do push_back here!!! Otherwise would producing empty faces!!
-
-            ///clean conn_faces for neg_face's edges//fixed
-            for(int j=0;j<neg_face.edges.size();j++){
-                auto it = std::find(edges[neg_face.edges[j]].conn_faces.begin(), edges[neg_face.edges[j]].conn_faces.end(), old_f_id);
-                if(it!=edges[neg_face.edges[j]].conn_faces.end()) {
-                    edges[neg_face.edges[j]].conn_faces.erase(it);
-                    edges[neg_face.edges[j]].conn_faces.insert(new_f_id);
-                }
+            ///splitting...
+            BSPEdge pos_edge, neg_edge;
+            edges.push_back(neg_edge);
+            int new_e_id = edges.size() - 1;
+            std::vector<int> new_e_ids = {old_e_id, new_e_id};
+
+            pos_edge.vertices.push_back(pos_vs[0]);
+            neg_edge.vertices.push_back(neg_vs[0]);
+
+            int new_v_id = 0;
+            Segment_3 seg(vertices[edges[old_e_id].vertices[0]], vertices[edges[old_e_id].vertices[1]]);
+            auto result = intersection(seg, pln);
+            if (result) {
+                const Point_3 *p = boost::get<Point_3>(&*result);
+                vertices.push_back(*p);
+
+                new_v_id = vertices.size() - 1;
+                on_edge.vertices.push_back(new_v_id);
+                pos_edge.vertices.push_back(new_v_id);
+                neg_edge.vertices.push_back(new_v_id);
+
+                v_sides[new_v_id] = V_ON;//fixed
+                new_v_ids.push_back(new_v_id);
+            } else {
+                log_and_throw("error cal p!");
             }
 
-            ///add on_edge
-            //remove duplicated vertices//fixed
-            on_edge.conn_faces = {new_f_ids[0], new_f_ids[1]};
-            edges.push_back(on_edge);
-            int on_e_id = edges.size() - 1;
-            pos_face.edges.push_back(on_e_id);
-            neg_face.edges.push_back(on_e_id);
-            on_face.edges.push_back(on_e_id);
-
-            ///add faces
-            pos_face.conn_nodes = faces[old_f_id].conn_nodes;
-            neg_face.conn_nodes = faces[old_f_id].conn_nodes;
-            ///cal vertices for faces//fixed
-            getVertices(pos_face);
-            getVertices(neg_face);
-            for (auto it = faces[old_f_id].conn_nodes.begin(); it != faces[old_f_id].conn_nodes.end(); it++) {
-                if (*it == old_n_id)
+            ///add edges
+            pos_edge.conn_faces = edges[old_e_id].conn_faces;
+            neg_edge.conn_faces = edges[old_e_id].conn_faces;
+            for (auto it = edges[old_e_id].conn_faces.begin(); it != edges[old_e_id].conn_faces.end(); it++) {
+                if (*it == old_f_id)
                     continue;
-                nodes[*it].faces.push_back(new_f_id);
+                faces[*it].edges.push_back(new_e_id);
+                faces[*it].vertices.push_back(new_v_id);
             }
-            ///re-assign divfaces for pos_face & neg_face
-            std::unordered_set<int> tmp_df_ids = faces[old_f_id].div_faces;
-            for(auto it=tmp_df_ids.begin(); it!=tmp_df_ids.end();it++) {
-                int side = divfaceSide(pln, div_faces[*it], div_vertices);
-                if (side == DIVFACE_POS)
-                    pos_face.div_faces.insert(*it);
-                else if (side == DIVFACE_NEG)
-                    neg_face.div_faces.insert(*it);
-                else if(side==DIVFACE_CROSS){
-                    pos_face.div_faces.insert(*it);
-                    neg_face.div_faces.insert(*it);
-                }
-            }
-            pos_face.matched_f_id=faces[old_f_id].matched_f_id;
-            neg_face.matched_f_id=faces[old_f_id].matched_f_id;
-
-            faces[new_f_ids[0]] = pos_face;
-            faces[new_f_ids[1]] = neg_face;
+            edges[new_e_ids[0]] = pos_edge;//if get here, it means that old_edge has been cut into 2
+            edges[new_e_ids[1]] = neg_edge;
 
-            for(int j=0;j<new_f_ids.size();j++){//fixed
-                for(auto it=faces[new_f_ids[j]].edges.begin();it!=faces[new_f_ids[j]].edges.end();it++)///fixed
-                    edges[*it].conn_faces.insert(new_f_ids[j]);
-            }
+            ///add edges for faces
+            pos_face.edges.push_back(new_e_ids[0]);
+            neg_face.edges.push_back(new_e_ids[1]);
+        }//split one face end
 
-            ///add faces for nodes
-            pos_node.faces.push_back(new_f_ids[0]);
-            neg_node.faces.push_back(new_f_ids[1]);
-        }//split one node end
+        if (pos_face.edges.size() == 0 || neg_face.edges.size() == 0)//connected pos/neg
+            continue;
 
+        ///from now, the face would definitely be subdivided
+        faces.push_back(neg_face);//have to do push_back here!!! Otherwise would producing empty faces!!
 
-        ///clean conn_nodes for neg_node's faces//fixed //it must be done before adding on_face!! Otherwise, the on_face would be influenced.
-        for(int i=0;i<neg_node.faces.size();i++){
-            auto it = std::find(faces[neg_node.faces[i]].conn_nodes.begin(), faces[neg_node.faces[i]].conn_nodes.end(), old_n_id);
-            if(it!=faces[neg_node.faces[i]].conn_nodes.end()) {
-                faces[neg_node.faces[i]].conn_nodes.erase(it);
-                faces[neg_node.faces[i]].conn_nodes.insert(new_n_id);
+        ///clean conn_faces for neg_face's edges//fixed
+        for(int j=0;j<neg_face.edges.size();j++){
+            auto it = std::find(edges[neg_face.edges[j]].conn_faces.begin(), edges[neg_face.edges[j]].conn_faces.end(), old_f_id);
+            if(it!=edges[neg_face.edges[j]].conn_faces.end()) {
+                edges[neg_face.edges[j]].conn_faces.erase(it);
+                edges[neg_face.edges[j]].conn_faces.insert(new_f_id);
             }
         }
 
-        ///add on_face
-        on_face.conn_nodes = {new_n_ids[0], new_n_ids[1]};
+        ///add on_edge
+        //remove duplicated vertices//fixed
+        on_edge.conn_faces = {new_f_ids[0], new_f_ids[1]};
+        edges.push_back(on_edge);
+        int on_e_id = edges.size() - 1;
+        pos_face.edges.push_back(on_e_id);
+        neg_face.edges.push_back(on_e_id);
+        on_face.edges.push_back(on_e_id);
+
+        ///add faces
+        pos_face.conn_nodes = faces[old_f_id].conn_nodes;
+        neg_face.conn_nodes = faces[old_f_id].conn_nodes;
         ///cal vertices for faces//fixed
-        getVertices(on_face);
-        faces.push_back(on_face);
-        int on_f_id = faces.size() - 1;
-        pos_node.faces.push_back(on_f_id);
-        neg_node.faces.push_back(on_f_id);
-        for(auto it=faces[on_f_id].edges.begin();it!=faces[on_f_id].edges.end();it++)///fixed
-            edges[*it].conn_faces.insert(on_f_id);
-
-        ///add nodes
-        nodes[new_n_ids[0]] = pos_node;
-        nodes[new_n_ids[1]] = neg_node;
-
-        ///check if divface.size==0
-        for (int i = 0; i < new_n_ids.size(); i++) {
-            if (nodes[new_n_ids[i]].div_faces.size() == 0) {
-                nodes[new_n_ids[i]].is_leaf = true;
-            } else {
-                processing_n_ids.push(new_n_ids[i]);
-                ++progress_total;
+        getVertices(pos_face);
+        getVertices(neg_face);
+        for (auto it = faces[old_f_id].conn_nodes.begin(); it != faces[old_f_id].conn_nodes.end(); it++) {
+            if (*it == old_n_id)
+                continue;
+            nodes[*it].faces.push_back(new_f_id);
+        }
+        ///re-assign divfaces for pos_face & neg_face
+        std::unordered_set<int> tmp_df_ids = faces[old_f_id].div_faces;
+        for(auto it=tmp_df_ids.begin(); it!=tmp_df_ids.end();it++) {
+            auto df_it = division.df_sides.find(*it);
+            int side = df_it != division.df_sides.end() ? df_it->second : divfaceSide(pln, div_faces[*it], div_vertices);
+            if (side == DIVFACE_POS)
+                pos_face.div_faces.insert(*it);
+            else if (side == DIVFACE_NEG)
+                neg_face.div_faces.insert(*it);
+            else if(side==DIVFACE_CROSS){
+                pos_face.div_faces.insert(*it);
+                neg_face.div_faces.insert(*it);
             }
         }
+        pos_face.matched_f_id=faces[old_f_id].matched_f_id;
+        neg_face.matched_f_id=faces[old_f_id].matched_f_id;
+
+        faces[new_f_ids[0]] = pos_face;
+        faces[new_f_ids[1]] = neg_face;
+
+        for(int j=0;j<new_f_ids.size();j++){//fixed
+            for(auto it=faces[new_f_ids[j]].edges.begin();it!=faces[new_f_ids[j]].edges.end();it++)///fixed
+                edges[*it].conn_faces.insert(new_f_ids[j]);
+        }
+
+        ///add faces for nodes
+        pos_node.faces.push_back(new_f_ids[0]);
+        neg_node.faces.push_back(new_f_ids[1]);
+    }//split one node end
+
+
+    ///clean conn_nodes for neg_node's faces//fixed //it must be done before adding on_face!! Otherwise, the on_face would be influenced.
+    for(int i=0;i<neg_node.faces.size();i++){
+        auto it = std::find(faces[neg_node.faces[i]].conn_nodes.begin(), faces[neg_node.faces[i]].conn_nodes.end(), old_n_id);
+        if(it!=faces[neg_node.faces[i]].conn_nodes.end()) {
+            faces[neg_node.faces[i]].conn_nodes.erase(it);
+            faces[neg_node.faces[i]].conn_nodes.insert(new_n_id);
+        }
     }
 
+    ///add on_face
+    on_face.conn_nodes = {new_n_ids[0], new_n_ids[1]};
+    ///cal vertices for faces//fixed
+    getVertices(on_face);
+    faces.push_back(on_face);
+    int on_f_id = faces.size() - 1;
+    pos_node.faces.push_back(on_f_id);
+    neg_node.faces.push_back(on_f_id);
+    for(auto it=faces[on_f_id].edges.begin();it!=faces[on_f_id].edges.end();it++)///fixed
+        edges[*it].conn_faces.insert(on_f_id);
+
+    ///add nodes
+    nodes[new_n_ids[0]] = pos_node;
+    nodes[new_n_ids[1]] = neg_node;
+
+    ///check if divface.size==0
+    for (int i = 0; i < new_n_ids.size(); i++) {
+        if (nodes[new_n_ids[i]].div_faces.size() == 0) {
+            nodes[new_n_ids[i]].is_leaf = true;
+        } else {
+            processing_n_ids.push(new_n_ids[i]);
+        }
+    }
 }
 
 void BSPSubdivision::calVertexSides(const Plane_3& pln, const std::unordered_set<int>& v_ids, const std::vector<Point_3>& vs,
@@ -18,6 +18,7 @@
 #include <unordered_set>
 #include <queue>
 #include <array>
+#include <vector>
 
 namespace tetwild {
 
@@ -30,6 +31,37 @@ public:
     std::queue<int> processing_n_ids;
     void subdivideBSPNodes(const Args &args);
 
+    ///
+    /// @brief      { How a node is divided: the first div face crossing it (the node is divided by its plane), the
+    ///             sides of its vertices and of its remaining div faces }
+    ///
+    struct NodeDivision {
+        bool is_divide = false;
+        int on_df_id = -1;
+        std::unordered_map<int, int> v_sides;
+        std::vector<int> rm_df_ids;
+        std::unordered_map<int, int> df_sides;
+    };
+
+    ///
+    /// @brief      { Finds how a node is divided, without modifying the tree. The points and planes are only read
+    ///             through const references, so it is safe to call concurrently once their exact values have been
+    ///             evaluated. }
+    ///
+    void planDivision(int n_id, NodeDivision& division);
+
+    ///plane of each div face, built once before the subdivision
+    std::vector<Plane_3> div_planes;
+
+    ///
+    /// @brief      { Divides a node as planned, pushes the new nodes that still have div faces to processing_n_ids }
+    ///
+    /// @param[in]  old_n_id   { Node to divide }
+    /// @param[in]  division   { Plan of the division (completed with the vertices added since planning) }
+    /// @param[out] new_v_ids  { Appended with the ids of the vertices created }
+    ///
+    void divideNode(int old_n_id, NodeDivision& division, std::vector<int>& new_v_ids);
+
     const int V_POS=0;
     const int V_NEG=1;
     const int V_ON=2;
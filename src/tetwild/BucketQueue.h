@@ -0,0 +1,158 @@
+// This file is part of TetWild, a software for generating tetrahedral meshes.
+//
+// This Source Code Form is subject to the terms of the Mozilla Public License
+// v. 2.0. If a copy of the MPL was not distributed with this file, You can
+// obtain one at http://mozilla.org/MPL/2.0/.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace tetwild {
+
+///
+/// @brief      { Priority queue of the local operations, drop-in replacement of std::priority_queue for elements
+///             with a weight (the squared edge length). The elements are first distributed into buckets of
+///             logarithmically quantized weights, in O(1). Only the elements of the current bucket are kept in a
+///             binary heap ordered by Compare, so the elements are popped in the same order as with
+///             std::priority_queue<Element, std::vector<Element>, Compare>, up to the elements that Compare does not
+///             order (the comparators of the operations break the ties of weights on the vertex ids).
+///
+///             Pushing an element that ranks before the current bucket is allowed (it goes into the heap), so the
+///             queue does not have to be monotone. pushAll() fills the buckets of a whole set of candidates at once,
+///             for the init() of the operations. }
+///
+/// @tparam     Element        { Class with a double member weight }
+/// @tparam     Compare        { Same comparator as for std::priority_queue (true if e1 comes after e2) }
+/// @tparam     LARGEST_FIRST  { Whether Compare pops the largest weights first }
+///
+template<typename Element, typename Compare, bool LARGEST_FIRST>
+class BucketQueue {
+public:
+    static const int SUB_BUCKETS = 16; //per power of two
+    static const int MIN_EXPONENT = -64;
+    static const int NUM_BUCKETS = 128 * SUB_BUCKETS; //weights outside of [2^-65, 2^63) are clamped
+
+    BucketQueue()
+        : m_buckets(NUM_BUCKETS)
+        , m_is_occupied(NUM_BUCKETS / 64, 0)
+    { }
+
+    bool empty() const { return m_size == 0; }
+    size_t size() const { return m_size; }
+
+    ///
+    /// @brief      { Next element, the queue must not be empty }
+    ///
+    const Element& top() const { return m_heap.front(); }
+
+    void push(const Element& ele) {
+        int b_id = bucketIndex(ele.weight);
+        if (b_id <= m_current) {
+            m_heap.push_back(ele);
+            std::push_heap(m_heap.begin(), m_heap.end(), m_cmp);
+        } else
+            bucket(b_id).push_back(ele);
+        m_size++;
+        refill();
+    }
+
+    template<typename... Args>
+    void emplace(Args&&... args) {
+        push(Element(std::forward<Args>(args)...));
+    }
+
+    void pop() {
+        std::pop_heap(m_heap.begin(), m_heap.end(), m_cmp);
+        m_heap.pop_back();
+        m_size--;
+        refill();
+    }
+
+    ///
+    /// @brief      { Pushes a set of elements at once, in linear time }
+    ///
+    void pushAll(std::vector<Element>&& eles) {
+        if (eles.empty())
+            return;
+        //count, allocate once and scatter
+        std::vector<int> b_ids(eles.size());
+        std::vector<size_t> counts(NUM_BUCKETS, 0);
+        for (size_t i = 0; i < eles.size(); i++) {
+            b_ids[i] = bucketIndex(eles[i].weight);
+            counts[b_ids[i]]++;
+        }
+        for (int b_id = m_current + 1; b_id < NUM_BUCKETS; b_id++) {
+            if (counts[b_id] > 0)
+                bucket(b_id).reserve(m_buckets[b_id].size() + counts[b_id]);
+        }
+        size_t old_heap_size = m_heap.size();
+        for (size_t i = 0; i < eles.size(); i++) {
+            if (b_ids[i] <= m_current)
+                m_heap.push_back(std::move(eles[i]));
+            else
+                m_buckets[b_ids[i]].push_back(std::move(eles[i]));
+        }
+        if (m_heap.size() > old_heap_size)
+            std::make_heap(m_heap.begin(), m_heap.end(), m_cmp);
+        m_size += eles.size();
+        eles.clear();
+        refill();
+    }
+
+private:
+    static int bucketIndex(double weight) {
+        int b_id;
+        if (!(weight > 0))
+            b_id = 0;
+        else if (std::isinf(weight))
+            b_id = NUM_BUCKETS - 1;
+        else {
+            int exponent;
+            double mantissa = std::frexp(weight, &exponent); //in [0.5, 1)
+            b_id = (exponent - MIN_EXPONENT) * SUB_BUCKETS + int((2 * mantissa - 1) * SUB_BUCKETS);
+            b_id = std::max(0, std::min(NUM_BUCKETS - 1, b_id));
+        }
+        return LARGEST_FIRST ? NUM_BUCKETS - 1 - b_id : b_id;
+    }
+
+    ///
+    /// @brief      { Bucket b_id, marked as occupied }
+    ///
+    std::vector<Element>& bucket(int b_id) {
+        m_is_occupied[b_id / 64] |= uint64_t(1) << (b_id % 64);
+        return m_buckets[b_id];
+    }
+
+    ///
+    /// @brief      { Moves the next occupied bucket into the heap when the heap is empty }
+    ///
+    void refill() {
+        if (!m_heap.empty() || m_size == 0)
+            return;
+        int w_id = (m_current + 1) / 64;
+        uint64_t word = m_is_occupied[w_id] & (~uint64_t(0) << ((m_current + 1) % 64));
+        while (word == 0)
+            word = m_is_occupied[++w_id];
+        int b_id = w_id * 64 + __builtin_ctzll(word);
+        m_is_occupied[w_id] &= ~(uint64_t(1) << (b_id % 64));
+        m_current = b_id;
+        m_heap.swap(m_buckets[b_id]);
+        m_buckets[b_id].clear();
+        std::make_heap(m_heap.begin(), m_heap.end(), m_cmp);
+    }
+
+    std::vector<std::vector<Element>> m_buckets;
+    std::vector<uint64_t> m_is_occupied;
+    std::vector<Element> m_heap; //elements of the buckets up to m_current
+    Compare m_cmp;
+    int m_current = -1;
+    size_t m_size = 0;
+};
+
+} // namespace tetwild
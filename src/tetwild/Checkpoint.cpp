@@ -0,0 +1,363 @@
+// This file is part of TetWild, a software for generating tetrahedral meshes.
+//
+// This Source Code Form is subject to the terms of the Mozilla Public License
+// v. 2.0. If a copy of the MPL was not distributed with this file, You can
+// obtain one at http://mozilla.org/MPL/2.0/.
+//
+
+#include <tetwild/Checkpoint.h>
+#include <tetwild/Logger.h>
+#include <tetwild/MappedFile.h>
+#include <CGAL/Gmpq.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace tetwild {
+
+namespace checkpoint {
+
+namespace {
+
+typedef std::decay<decltype(CGAL::exact(std::declval<CGAL_FT>()))>::type ExactFT;
+static_assert(std::is_same<ExactFT, CGAL::Gmpq>::value, "the exact number type of the kernel is expected to be Gmpq");
+
+const char MAGIC[8] = {'T', 'W', 'C', 'K', 'P', 'T', '\0', '\0'};
+
+enum Section {
+    POSF = 0, //3 doubles per vertex
+    ADAPTIVE_SCALES, //1 double per vertex
+    VERTEX_FLAGS, //1 byte per vertex
+    TETS, //4 int32 per tet
+    SURFACE_TAGS, //4 int32 per tet
+    EXACT_V_IDS, //1 int32 per exact vertex
+    EXACT_OFFSETS, //1 uint64 per exact vertex, plus one: ranges in EXACT_WORDS
+    EXACT_WORDS, //for each coordinate, numerator then denominator: signed number of words, then the words
+    NUM_SECTIONS
+};
+
+enum VertexFlag : uint8_t {
+    ROUNDED = 1 << 0,
+    ON_SURFACE = 1 << 1,
+    ON_BBOX = 1 << 2,
+    ON_BOUNDARY = 1 << 3
+};
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t num_sections;
+    double bbox_diag;
+    double eps;
+    double eps_2;
+    double sampling_dist;
+    double initial_edge_len;
+    int64_t old_pass;
+    uint64_t num_vertices;
+    uint64_t num_tets;
+    uint64_t num_exact_vertices;
+    uint64_t offsets[NUM_SECTIONS];
+    uint64_t sizes[NUM_SECTIONS];
+    uint64_t checksums[NUM_SECTIONS];
+    uint64_t header_checksum; //of all the previous bytes
+};
+static_assert(sizeof(Header) % 8 == 0, "the sections are aligned on 8 bytes");
+
+///
+/// @brief      { FNV-1a over 64-bit words }
+///
+uint64_t checksum(const char* data, size_t size) {
+    uint64_t h = 0xcbf29ce484222325ULL ^ size;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        h = (h ^ word) * 0x100000001b3ULL;
+    }
+    for (; i < size; i++)
+        h = (h ^ (unsigned char) data[i]) * 0x100000001b3ULL;
+    return h;
+}
+
+void writeInteger(mpz_srcptr z, std::vector<uint64_t>& words) {
+    size_t cnt = mpz_sgn(z) == 0 ? 0 : (mpz_sizeinbase(z, 2) + 63) / 64;
+    words.push_back(mpz_sgn(z) < 0 ? uint64_t(-int64_t(cnt)) : uint64_t(cnt));
+    size_t begin = words.size();
+    words.resize(begin + cnt);
+    if (cnt > 0)
+        mpz_export(words.data() + begin, nullptr, -1, 8, 0, 0, z);
+}
+
+const uint64_t* readInteger(const uint64_t* words, const uint64_t* end, mpz_ptr z) {
+    if (words >= end)
+        log_and_throw("checkpoint: corrupted exact coordinates");
+    int64_t cnt = int64_t(*words++);
+    size_t abs_cnt = size_t(cnt < 0 ? -cnt : cnt);
+    if (abs_cnt > size_t(end - words))
+        log_and_throw("checkpoint: corrupted exact coordinates");
+    mpz_import(z, abs_cnt, -1, 8, 0, 0, words);
+    if (cnt < 0)
+        mpz_neg(z, z);
+    return words + abs_cnt;
+}
+
+class Writer {
+public:
+    Writer(const std::string& path, Header& header)
+        : m_out(path, std::ios::binary), m_header(header)
+    {
+        if (!m_out)
+            log_and_throw("checkpoint: cannot open " + path);
+        //the header is written again at the end, with the offsets and checksums
+        m_out.write(reinterpret_cast<const char*>(&m_header), sizeof(Header));
+        m_offset = sizeof(Header);
+    }
+
+    template<typename T>
+    void writeSection(Section section, const std::vector<T>& data) {
+        static_assert(std::is_trivially_copyable<T>::value, "sections are flat arrays");
+        const char* bytes = reinterpret_cast<const char*>(data.data());
+        size_t size = data.size() * sizeof(T);
+        m_header.offsets[section] = m_offset;
+        m_header.sizes[section] = size;
+        m_header.checksums[section] = checksum(bytes, size);
+        m_out.write(bytes, size);
+        m_offset += size;
+        const char padding[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+        size_t padding_size = (8 - m_offset % 8) % 8;
+        m_out.write(padding, padding_size);
+        m_offset += padding_size;
+    }
+
+    void finish() {
+        m_header.header_checksum = checksum(reinterpret_cast<const char*>(&m_header),
+                                            offsetof(Header, header_checksum));
+        m_out.seekp(0);
+        m_out.write(reinterpret_cast<const char*>(&m_header), sizeof(Header));
+        m_out.close();
+        if (m_out.fail())
+            log_and_throw("checkpoint: write error");
+    }
+
+private:
+    std::ofstream m_out;
+    Header& m_header;
+    uint64_t m_offset;
+};
+
+template<typename T>
+const T* getSection(const MappedFile& file, const Header& header, Section section, size_t num) {
+    if (header.sizes[section] != num * sizeof(T)
+        || header.offsets[section] % 8 != 0
+        || header.offsets[section] > file.size()
+        || header.sizes[section] > file.size() - header.offsets[section])
+        log_and_throw("checkpoint: truncated or corrupted file");
+    const char* bytes = file.data() + header.offsets[section];
+    if (checksum(bytes, header.sizes[section]) != header.checksums[section])
+        log_and_throw("checkpoint: checksum mismatch in section " + std::to_string(int(section)));
+    return reinterpret_cast<const T*>(bytes);
+}
+
+} // anonymous namespace
+
+bool isCheckpoint(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    char magic[sizeof(MAGIC)];
+    if (!in.read(magic, sizeof(MAGIC)))
+        return false;
+    return std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+void save(const std::string& path, const State& state, int old_pass,
+          const std::vector<TetVertex>& tet_vertices, const std::vector<std::array<int, 4>>& tets,
+          const std::vector<std::array<int, 4>>& is_surface_fs,
+          const std::vector<bool>& v_is_removed, const std::vector<bool>& t_is_removed) {
+    Header header;
+    std::memset(&header, 0, sizeof(Header));
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.num_sections = NUM_SECTIONS;
+    header.bbox_diag = state.bbox_diag;
+    header.eps = state.eps;
+    header.eps_2 = state.eps_2;
+    header.sampling_dist = state.sampling_dist;
+    header.initial_edge_len = state.initial_edge_len;
+    header.old_pass = old_pass;
+
+    //relabel
+    std::vector<int> new_v_ids(tet_vertices.size(), -1);
+    int cnt = 0;
+    for (int i = 0; i < tet_vertices.size(); i++) {
+        if (v_is_removed[i])
+            continue;
+        new_v_ids[i] = cnt++;
+    }
+    header.num_vertices = cnt;
+    header.num_tets = std::count(t_is_removed.begin(), t_is_removed.end(), false);
+
+    Writer writer(path, header);
+
+    ///vertices
+    {
+        std::vector<double> posf;
+        std::vector<double> adaptive_scales;
+        std::vector<uint8_t> flags;
+        posf.reserve(header.num_vertices * 3);
+        adaptive_scales.reserve(header.num_vertices);
+        flags.reserve(header.num_vertices);
+        for (int i = 0; i < tet_vertices.size(); i++) {
+            if (v_is_removed[i])
+                continue;
+            const TetVertex& v = tet_vertices[i];
+            for (int j = 0; j < 3; j++)
+                posf.push_back(v.posf[j]);
+            adaptive_scales.push_back(v.adaptive_scale);
+            flags.push_back((v.is_rounded ? ROUNDED : 0) | (v.is_on_surface ? ON_SURFACE : 0)
+                            | (v.is_on_bbox ? ON_BBOX : 0) | (v.is_on_boundary ? ON_BOUNDARY : 0));
+        }
+        writer.writeSection(POSF, posf);
+        writer.writeSection(ADAPTIVE_SCALES, adaptive_scales);
+        writer.writeSection(VERTEX_FLAGS, flags);
+    }
+
+    ///tets
+    {
+        std::vector<std::array<int32_t, 4>> slz_tets;
+        std::vector<std::array<int32_t, 4>> slz_is_surface_fs;
+        slz_tets.reserve(header.num_tets);
+        slz_is_surface_fs.reserve(header.num_tets);
+        for (int i = 0; i < tets.size(); i++) {
+            if (t_is_removed[i])
+                continue;
+            slz_tets.push_back({{new_v_ids[tets[i][0]], new_v_ids[tets[i][1]], new_v_ids[tets[i][2]],
+                                 new_v_ids[tets[i][3]]}});
+            slz_is_surface_fs.push_back({{is_surface_fs[i][0], is_surface_fs[i][1], is_surface_fs[i][2],
+                                          is_surface_fs[i][3]}});
+        }
+        writer.writeSection(TETS, slz_tets);
+        writer.writeSection(SURFACE_TAGS, slz_is_surface_fs);
+    }
+
+    ///exact coordinates of the vertices that are not at their float position
+    {
+        std::vector<int32_t> exact_v_ids;
+        std::vector<uint64_t> exact_offsets(1, 0);
+        std::vector<uint64_t> exact_words;
+        for (int i = 0; i < tet_vertices.size(); i++) {
+            if (v_is_removed[i])
+                continue;
+            const TetVertex& v = tet_vertices[i];
+            if (v.pos.isDouble() && v.pos.doubles()[0] == v.posf[0] && v.pos.doubles()[1] == v.posf[1]
+                && v.pos.doubles()[2] == v.posf[2])
+                continue;
+            exact_v_ids.push_back(new_v_ids[i]);
+            for (int j = 0; j < 3; j++) {
+                const ExactFT& x = CGAL::exact(v.pos[j]);
+                writeInteger(mpq_numref(x.mpq()), exact_words);
+                writeInteger(mpq_denref(x.mpq()), exact_words);
+            }
+            exact_offsets.push_back(exact_words.size());
+        }
+        header.num_exact_vertices = exact_v_ids.size();
+        writer.writeSection(EXACT_V_IDS, exact_v_ids);
+        writer.writeSection(EXACT_OFFSETS, exact_offsets);
+        writer.writeSection(EXACT_WORDS, exact_words);
+    }
+
+    writer.finish();
+    logger().debug("checkpoint: {} vertices ({} exact), {} tets", header.num_vertices, header.num_exact_vertices,
+                   header.num_tets);
+}
+
+void load(const std::string& path, State& state, int& old_pass,
+          std::vector<TetVertex>& tet_vertices, std::vector<std::array<int, 4>>& tets,
+          std::vector<std::array<int, 4>>& is_surface_fs) {
+    std::unique_ptr<MappedFile> mapped_file;
+    try {
+        mapped_file.reset(new MappedFile(path));
+    } catch (const TetWildError& e) {
+        log_and_throw("checkpoint: " + std::string(e.what()));
+    }
+    const MappedFile& file = *mapped_file;
+    if (file.size() < sizeof(Header))
+        log_and_throw("checkpoint: truncated file " + path);
+    Header header;
+    std::memcpy(&header, file.data(), sizeof(Header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0)
+        log_and_throw("checkpoint: " + path + " is not a checkpoint");
+    if (header.version != VERSION || header.num_sections != NUM_SECTIONS)
+        log_and_throw("checkpoint: unsupported version " + std::to_string(header.version));
+    if (checksum(file.data(), offsetof(Header, header_checksum)) != header.header_checksum)
+        log_and_throw("checkpoint: corrupted header");
+
+    state.bbox_diag = header.bbox_diag;
+    state.eps = header.eps;
+    state.eps_2 = header.eps_2;
+    state.sampling_dist = header.sampling_dist;
+    state.initial_edge_len = header.initial_edge_len;
+    old_pass = int(header.old_pass);
+
+    const size_t num_vertices = header.num_vertices;
+    const size_t num_tets = header.num_tets;
+    const size_t num_exact = header.num_exact_vertices;
+    const double* posf = getSection<double>(file, header, POSF, num_vertices * 3);
+    const double* adaptive_scales = getSection<double>(file, header, ADAPTIVE_SCALES, num_vertices);
+    const uint8_t* flags = getSection<uint8_t>(file, header, VERTEX_FLAGS, num_vertices);
+    const std::array<int32_t, 4>* slz_tets = getSection<std::array<int32_t, 4>>(file, header, TETS, num_tets);
+    const std::array<int32_t, 4>* slz_is_surface_fs =
+            getSection<std::array<int32_t, 4>>(file, header, SURFACE_TAGS, num_tets);
+    const int32_t* exact_v_ids = getSection<int32_t>(file, header, EXACT_V_IDS, num_exact);
+    const uint64_t* exact_offsets = getSection<uint64_t>(file, header, EXACT_OFFSETS, num_exact + 1);
+    const size_t num_words = header.sizes[EXACT_WORDS] / sizeof(uint64_t);
+    const uint64_t* exact_words = getSection<uint64_t>(file, header, EXACT_WORDS, num_words);
+
+    tet_vertices.clear();
+    tet_vertices.resize(num_vertices);
+    for (size_t i = 0; i < num_vertices; i++) {
+        TetVertex& v = tet_vertices[i];
+        v.posf = Point_3f(posf[3 * i], posf[3 * i + 1], posf[3 * i + 2]);
+        v.pos.setDoubles(posf[3 * i], posf[3 * i + 1], posf[3 * i + 2]);
+        v.adaptive_scale = adaptive_scales[i];
+        v.is_rounded = (flags[i] & ROUNDED) != 0;
+        v.is_on_surface = (flags[i] & ON_SURFACE) != 0;
+        v.is_on_bbox = (flags[i] & ON_BBOX) != 0;
+        v.is_on_boundary = (flags[i] & ON_BOUNDARY) != 0;
+    }
+
+    for (size_t i = 0; i < num_exact; i++) {
+        if (exact_v_ids[i] < 0 || size_t(exact_v_ids[i]) >= num_vertices || exact_offsets[i] > exact_offsets[i + 1]
+            || exact_offsets[i + 1] > num_words)
+            log_and_throw("checkpoint: corrupted exact coordinates");
+        const uint64_t* words = exact_words + exact_offsets[i];
+        const uint64_t* end = exact_words + exact_offsets[i + 1];
+        ExactFT xyz[3]; //fresh numbers, the kernel shares them
+        for (int j = 0; j < 3; j++) {
+            words = readInteger(words, end, mpq_numref(xyz[j].mpq()));
+            words = readInteger(words, end, mpq_denref(xyz[j].mpq()));
+            if (mpz_sgn(mpq_denref(xyz[j].mpq())) <= 0)
+                log_and_throw("checkpoint: corrupted exact coordinates");
+            mpq_canonicalize(xyz[j].mpq());
+        }
+        tet_vertices[exact_v_ids[i]].pos = Point_3(CGAL_FT(xyz[0]), CGAL_FT(xyz[1]), CGAL_FT(xyz[2]));
+    }
+
+    tets.resize(num_tets);
+    is_surface_fs.resize(num_tets);
+    for (size_t i = 0; i < num_tets; i++) {
+        for (int j = 0; j < 4; j++) {
+            if (slz_tets[i][j] < 0 || size_t(slz_tets[i][j]) >= num_vertices)
+                log_and_throw("checkpoint: corrupted tets");
+            tets[i][j] = slz_tets[i][j];
+            is_surface_fs[i][j] = slz_is_surface_fs[i][j];
+        }
+    }
+    logger().debug("checkpoint: {} vertices ({} exact), {} tets", num_vertices, num_exact, num_tets);
+}
+
+} // namespace checkpoint
+
+} // namespace tetwild
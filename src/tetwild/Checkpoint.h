@@ -0,0 +1,53 @@
+// This file is part of TetWild, a software for generating tetrahedral meshes.
+//
+// This Source Code Form is subject to the terms of the Mozilla Public License
+// v. 2.0. If a copy of the MPL was not distributed with this file, You can
+// obtain one at http://mozilla.org/MPL/2.0/.
+//
+
+#pragma once
+
+#include <tetwild/State.h>
+#include <tetwild/TetmeshElements.h>
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace tetwild {
+
+namespace checkpoint {
+
+const uint32_t VERSION = 1;
+
+///
+/// @brief      { Whether a file starts with the magic of a binary checkpoint (older checkpoints were written with
+///             igl::serialize) }
+///
+bool isCheckpoint(const std::string& path);
+
+///
+/// @brief      { Writes a binary checkpoint of the mesh optimization. The file starts with a header (magic, version,
+///             the global values of the state, and the offset, size and checksum of each section), followed by flat
+///             arrays aligned on 8 bytes: float positions, adaptive scales, vertex flags, tets and surface tags. The
+///             exact coordinates are only stored for the vertices whose exact position is not their float position,
+///             as the raw 64-bit words of their numerators and denominators. Only the non-removed vertices and tets
+///             are written, relabeled contiguously. }
+///
+void save(const std::string& path, const State& state, int old_pass,
+          const std::vector<TetVertex>& tet_vertices, const std::vector<std::array<int, 4>>& tets,
+          const std::vector<std::array<int, 4>>& is_surface_fs,
+          const std::vector<bool>& v_is_removed, const std::vector<bool>& t_is_removed);
+
+///
+/// @brief      { Reads a checkpoint written by save(), through a memory mapping of the file. Throws if the file is
+///             truncated, corrupted, or was written by another version. The connectivity of the vertices (conn_tets)
+///             is not restored. }
+///
+void load(const std::string& path, State& state, int& old_pass,
+          std::vector<TetVertex>& tet_vertices, std::vector<std::array<int, 4>>& tets,
+          std::vector<std::array<int, 4>>& is_surface_fs);
+
+} // namespace checkpoint
+
+} // namespace tetwild
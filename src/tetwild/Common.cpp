@@ -18,6 +18,7 @@
 #include <geogram/mesh/mesh.h>
 #include <fstream>
 #include <algorithm>
+#include <iterator>
 
 namespace tetwild {
 
@@ -35,7 +36,8 @@ void addRecord(const MeshRecord& record, const Args &args, const State &state) {
     f << record.op << "," << record.timing << "," << record.n_v << "," << record.n_t << ","
       << record.min_min_d_angle << "," << record.avg_min_d_angle << ","
       << record.max_max_d_angle << "," << record.avg_max_d_angle << ","
-      << record.max_energy << "," << record.avg_energy << "\n";
+      << record.max_energy << "," << record.avg_energy << ","
+      << record.envelope_cache_hits << "," << record.envelope_cache_misses << "\n";
     f.close();
 }
 
@@ -121,6 +123,18 @@ void setIntersection(const std::unordered_set<int>& s1, const std::unordered_set
 #endif
 }
 
+void setIntersection(const VertexSet& s1, const VertexSet& s2, VertexSet& s) {
+    // s may alias s1 or s2
+    VertexSet s_tmp;
+    std::set_intersection(s1.begin(), s1.end(), s2.begin(), s2.end(), std::inserter(s_tmp, s_tmp.end()));
+    s = std::move(s_tmp);
+}
+
+void setIntersection(const VertexSet& s1, const VertexSet& s2, std::vector<int>& s) {
+    s.clear();
+    s.reserve(std::min(s1.size(), s2.size()));
+    std::set_intersection(s1.begin(), s1.end(), s2.begin(), s2.end(), std::back_inserter(s));
+}
 
 void sampleTriangle(const std::array<GEO::vec3, 3>& vs, std::vector<GEO::vec3>& ps, const double sampling_dist) {
     double sqrt3_2 = std::sqrt(3) / 2;
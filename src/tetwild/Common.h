@@ -12,6 +12,7 @@
 #pragma once
 
 #include <tetwild/ForwardDecls.h>
+#include <tetwild/SmallSet.h>
 #include <geogram/basic/geometry.h>
 #include <unordered_set>
 #include <vector>
@@ -27,6 +28,9 @@ void pausee();
 inline bool isHaveCommonEle(const std::unordered_set<int>& v1, const std::unordered_set<int>& v2);
 void setIntersection(const std::unordered_set<int>& s1, const std::unordered_set<int>& s2, std::unordered_set<int>& s);
 void setIntersection(const std::unordered_set<int>& s1, const std::unordered_set<int>& s2, std::vector<int>& s);
+inline bool isHaveCommonEle(const VertexSet& v1, const VertexSet& v2);
+void setIntersection(const VertexSet& s1, const VertexSet& s2, VertexSet& s);
+void setIntersection(const VertexSet& s1, const VertexSet& s2, std::vector<int>& s);
 void sampleTriangle(const std::array<GEO::vec3, 3>& vs, std::vector<GEO::vec3>& ps, double sampling_dist);
 
 void addRecord(const MeshRecord& record, const Args &args, const State &state);
@@ -51,4 +55,20 @@ inline bool isHaveCommonEle(const std::unordered_set<int>& v1, const std::unorde
     return false;
 }
 
+inline bool isHaveCommonEle(const VertexSet& v1, const VertexSet& v2) {
+    // both sets are sorted
+    auto it1 = v1.begin();
+    auto it2 = v2.begin();
+    while (it1 != v1.end() && it2 != v2.end()) {
+        if (*it1 < *it2) {
+            ++it1;
+        } else if (*it2 < *it1) {
+            ++it2;
+        } else {
+            return true;
+        }
+    }
+    return false;
+}
+
 } // namespace tetwild
@@ -13,6 +13,7 @@
 #include <tetwild/Args.h>
 #include <tetwild/State.h>
 #include <tetwild/Logger.h>
+#include <tetwild/Parallel.h>
 #include <CGAL/bounding_box.h>
 #include <igl/readOFF.h>
 #include <igl/readSTL.h>
@@ -24,7 +25,10 @@
 #include <igl/boundary_loop.h>
 #include <geogram/mesh/mesh_AABB.h>
 #include <geogram/mesh/mesh_reorder.h>
+#include <geogram/delaunay/delaunay.h>
+#include <geogram/basic/process.h>
 #include <bitset>
+#include <functional>
 
 namespace tetwild {
 
@@ -84,14 +88,96 @@ void DelaunayTetrahedralization::getVoxelPoints(const Point_3& p_min, const Poin
 
     double min_dis = voxel_resolution * voxel_resolution / 4;
 //    double min_dis = state.target_edge_len * state.target_edge_len;//epsilon*2
-    for (int i = 0; i < ds[0].size(); i++) {
-        for (int j = 0; j < ds[1].size(); j++) {
-            for (int k = 0; k < ds[2].size(); k++) {
-                if ((i == 0 || i == ds[0].size() - 1) && (j == 0 || j == ds[1].size() - 1)
-                    && (k == 0 || k == ds[2].size() - 1))
+
+    //the exact coordinates are only converted here, the queries below run in parallel
+    std::array<std::vector<double>, 3> xs;
+    std::array<int, 3> n;
+    for (int d = 0; d < 3; d++) {
+        n[d] = ds[d].size();
+        for (const auto& x : ds[d])
+            xs[d].push_back(CGAL::to_double(x));
+    }
+    auto index = [&](int i, int j, int k) {
+        return (size_t(i) * n[1] + j) * n[2] + k;
+    };
+
+    //a grid point is kept if it is at least sqrt(min_dis) away from the surface. Blocks of the grid are tested
+    //hierarchically: when the distance from the center of a block minus its half diagonal is larger than that,
+    //all the points of the block are kept without querying them.
+    std::vector<char> is_kept(size_t(n[0]) * n[1] * n[2], 0);
+    const double min_dis_sqrt = std::sqrt(min_dis);
+    std::function<void(const std::array<int, 3>&, const std::array<int, 3>&)> classify =
+        [&](const std::array<int, 3>& b, const std::array<int, 3>& e) {
+        int max_size = std::max(e[0] - b[0], std::max(e[1] - b[1], e[2] - b[2]));
+        if (max_size <= 2) {
+            for (int i = b[0]; i < e[0]; i++) {
+                for (int j = b[1]; j < e[1]; j++) {
+                    for (int k = b[2]; k < e[2]; k++) {
+                        GEO::vec3 geo_p(xs[0][i], xs[1][j], xs[2][k]);
+                        is_kept[index(i, j, k)] = geo_face_tree.squared_distance(geo_p) >= min_dis;
+                    }
+                }
+            }
+            return;
+        }
+
+        GEO::vec3 center, half_diag;
+        for (int d = 0; d < 3; d++) {
+            center[d] = (xs[d][b[d]] + xs[d][e[d] - 1]) / 2;
+            half_diag[d] = (xs[d][e[d] - 1] - xs[d][b[d]]) / 2;
+        }
+        //keep a margin for the rounding errors, the points close to the threshold are queried one by one
+        if (std::sqrt(geo_face_tree.squared_distance(center)) - GEO::length(half_diag) > min_dis_sqrt * (1 + 1e-6)) {
+            for (int i = b[0]; i < e[0]; i++) {
+                for (int j = b[1]; j < e[1]; j++) {
+                    std::fill(is_kept.begin() + index(i, j, b[2]), is_kept.begin() + index(i, j, e[2]), 1);
+                }
+            }
+            return;
+        }
+
+        for (int c = 0; c < 8; c++) {
+            std::array<int, 3> cb, ce;
+            bool is_empty = false;
+            for (int d = 0; d < 3; d++) {
+                int m = (b[d] + e[d]) / 2;
+                if (c & (1 << d)) {
+                    cb[d] = m;
+                    ce[d] = e[d];
+                } else {
+                    cb[d] = b[d];
+                    ce[d] = m;
+                }
+                is_empty = is_empty || cb[d] == ce[d];
+            }
+            if (!is_empty)
+                classify(cb, ce);
+        }
+    };
+
+    const int block_size = 16;
+    std::array<int, 3> nb_blocks;
+    for (int d = 0; d < 3; d++)
+        nb_blocks[d] = (n[d] + block_size - 1) / block_size;
+    parallelFor(nb_blocks[0] * nb_blocks[1] * nb_blocks[2], args.num_threads, [&](int block_id, int thread_id) {
+        std::array<int, 3> b, e;
+        std::array<int, 3> ids = {{block_id / (nb_blocks[1] * nb_blocks[2]), (block_id / nb_blocks[2]) % nb_blocks[1],
+                                   block_id % nb_blocks[2]}};
+        for (int d = 0; d < 3; d++) {
+            b[d] = ids[d] * block_size;
+            e[d] = std::min(n[d], b[d] + block_size);
+        }
+        classify(b, e);
+    }, 1);
+
+    //the points are added in the order of the grid
+    for (int i = 0; i < n[0]; i++) {
+        for (int j = 0; j < n[1]; j++) {
+            for (int k = 0; k < n[2]; k++) {
+                if ((i == 0 || i == n[0] - 1) && (j == 0 || j == n[1] - 1)
+                    && (k == 0 || k == n[2] - 1))
                     continue;
-                GEO::vec3 geo_p(CGAL::to_double(ds[0][i]), CGAL::to_double(ds[1][j]), CGAL::to_double(ds[2][k]));
-                if (geo_face_tree.squared_distance(geo_p) < min_dis)
+                if (!is_kept[index(i, j, k)])
                     continue;
                 voxel_points.push_back(Point_d(ds[0][i], ds[1][j], ds[2][k]));
             }
@@ -148,26 +234,29 @@ void DelaunayTetrahedralization::tetra(const std::vector<Point_3>& m_vertices, G
     }
     logger().debug("{} voxel points are added!", voxel_points.size());
 
-    Delaunay T(points.begin(), points.end());
-//    if(!T.is_valid()){
-//        log_and_throw("T is not valid!!");
-//    }
+    std::vector<std::array<int, 4>> cells;
+    int num_threads = getNumThreads(args.num_threads);
+    if (num_threads <= 1 || !tetraInParallel(points, cells, num_threads)) {
+        Delaunay T(points.begin(), points.end());
+//        if(!T.is_valid()){
+//            log_and_throw("T is not valid!!");
+//        }
+        cells.reserve(T.number_of_finite_cells());
+        for (auto it = T.finite_cells_begin(); it != T.finite_cells_end(); ++it) {//it is determinate
+            std::array<int, 4> c;
+            for (int i = 0; i < 4; i++) {
+                int n = it->vertex(i)->info();
+                c[i] = n;
+            }
+            cells.push_back(c);
+        }
+    }
 
     //////get nodes, faces, edges info
     //get bsp nodes
-    int cnt = 0;
-    std::vector<std::array<int, 4>> cells;
-    cells.reserve(T.number_of_finite_cells());
     std::vector<std::vector<int>> conn_n_ids(points.size(), std::vector<int>());
-    for (auto it = T.finite_cells_begin(); it != T.finite_cells_end(); ++it) {//it is determinate
-        std::array<int, 4> c;
-        for (int i = 0; i < 4; i++) {
-            int n = it->vertex(i)->info();
-            c[i] = n;
-        }
+    for (auto& c : cells)
         std::sort(c.begin(), c.end());
-        cells.push_back(c);
-    }
     std::sort(cells.begin(), cells.end());
     for(int i=0;i<cells.size();i++) {
         for (int j = 0; j < 4; j++) {
@@ -175,21 +264,16 @@ void DelaunayTetrahedralization::tetra(const std::vector<Point_3>& m_vertices, G
         }
     }
 
-    //get bsp faces
+    //get bsp faces, i.e. the faces of the (finite) cells, that are the finite facets of the triangulation
     std::vector<std::array<int, 3>> faces;
-    faces.reserve(T.number_of_finite_facets());
+    faces.reserve(cells.size() * 4);
     std::vector<std::vector<int>> conn_f_ids(points.size(), std::vector<int>());
-    for (auto it = T.finite_facets_begin(); it != T.finite_facets_end(); ++it) {
-        std::array<int, 3> f;
-        for (int i = 0; i < 3; i++) {
-            int n = it->first->vertex((it->second + i + 1) % 4)->info();
-            assert(!(points[n].first != it->first->vertex((it->second + i + 1) % 4)->point()));
-            f[i] = n;
-        }
-        std::sort(f.begin(), f.end());
-        faces.push_back(f);
+    for (const auto& c : cells) {
+        for (int i = 0; i < 4; i++)
+            faces.push_back(std::array<int, 3>({{c[i == 0], c[1 + (i <= 1)], c[2 + (i <= 2)]}}));
     }
     std::sort(faces.begin(), faces.end());
+    faces.erase(std::unique(faces.begin(), faces.end()), faces.end());
     for(int i=0;i<faces.size();i++) {
         for (int j = 0; j < 3; j++)
             conn_f_ids[faces[i][j]].push_back(i);
@@ -197,20 +281,15 @@ void DelaunayTetrahedralization::tetra(const std::vector<Point_3>& m_vertices, G
 
     //get bsp edges
     std::vector<std::array<int, 2>> edges;
-    edges.reserve(T.number_of_finite_edges());
-    for (auto it = T.finite_edges_begin(); it != T.finite_edges_end(); ++it) {
-        std::array<int, 2> e;
-        assert(!(points[it->first->vertex(it->second)->info()].first !=
-                 it->first->vertex(it->second)->point()));
-        assert(!(points[it->first->vertex(it->third)->info()].first !=
-                 it->first->vertex(it->third)->point()));
-        e[0] = it->first->vertex(it->second)->info();
-        e[1] = it->first->vertex(it->third)->info();
-        if(e[0]>e[1])
-            e={{e[1], e[0]}};
-        edges.push_back(e);
+    edges.reserve(cells.size() * 6);
+    for (const auto& c : cells) {
+        for (int i = 0; i < 3; i++) {
+            for (int j = i + 1; j < 4; j++)
+                edges.push_back(std::array<int, 2>({{c[i], c[j]}}));
+        }
     }
     std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
 
     //////construct bsp tree
     bsp_vertices.reserve(points.size());//+++
@@ -258,6 +337,53 @@ void DelaunayTetrahedralization::tetra(const std::vector<Point_3>& m_vertices, G
     }
 }
 
+bool DelaunayTetrahedralization::tetraInParallel(const std::vector<std::pair<Point_d, int>>& points,
+                                                 std::vector<std::array<int, 4>>& cells, int num_threads) {
+    //geogram's parallel Delaunay works on doubles
+    std::vector<double> coords(points.size() * 3);
+    for (int i = 0; i < points.size(); i++) {
+        assert(points[i].second == i);
+        for (int j = 0; j < 3; j++)
+            coords[i * 3 + j] = CGAL::to_double(points[i].first[j]);
+    }
+
+    GEO::Process::set_max_threads(num_threads);
+    GEO::Delaunay_var delaunay = GEO::Delaunay::create(3, "PDEL");
+    if (delaunay.is_null()) {
+        logger().debug("parallel Delaunay is not available");
+        return false;
+    }
+    delaunay->set_vertices(points.size(), coords.data());
+
+    cells.resize(delaunay->nb_cells());
+    std::vector<bool> is_used(points.size(), false);
+    for (int c = 0; c < cells.size(); c++) {
+        for (int lv = 0; lv < 4; lv++) {
+            cells[c][lv] = delaunay->cell_vertex(c, lv);
+            is_used[cells[c][lv]] = true;
+        }
+    }
+
+    //the voxel points and the box corners are not doubles, rounding them may have merged points or flipped cells
+    //(the box faces stay planar since each of their coordinates is rounded the same way)
+    bool is_valid = std::find(is_used.begin(), is_used.end(), false) == is_used.end() && !cells.empty();
+    CGAL::Orientation ori = CGAL::COPLANAR;
+    for (int c = 0; c < cells.size() && is_valid; c++) {
+        CGAL::Orientation cur_ori = CGAL::orientation(points[cells[c][0]].first, points[cells[c][1]].first,
+                                                      points[cells[c][2]].first, points[cells[c][3]].first);
+        if (c == 0)
+            ori = cur_ori;
+        is_valid = cur_ori != CGAL::COPLANAR && cur_ori == ori;
+    }
+    if (!is_valid) {
+        logger().debug("parallel Delaunay is not valid for the exact coordinates, falling back to the sequential one");
+        cells.clear();
+        return false;
+    }
+    logger().debug("parallel Delaunay: {} cells", cells.size());
+    return true;
+}
+
 void DelaunayTetrahedralization::outputTetmesh(const std::vector<Point_3>& m_vertices, std::vector<std::array<int, 4>>& cells,
                                                const std::string& output_file){
     std::ofstream of(output_file);
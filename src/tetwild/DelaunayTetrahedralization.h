@@ -44,6 +44,10 @@ public:
                std::vector<Point_3>& bsp_vertices, std::vector<BSPEdge>& bsp_edges,
                std::vector<BSPFace>& bsp_faces, std::vector<BSPtreeNode>& bsp_nodes,
                const Args &args, const State &state);
+    // Delaunay tetrahedralization of the rounded points with geogram's parallel implementation, returns false if it
+    // is not available or if the resulting cells are not valid for the exact coordinates of the points
+    bool tetraInParallel(const std::vector<std::pair<Point_d, int>>& points, std::vector<std::array<int, 4>>& cells,
+                         int num_threads);
     void outputTetmesh(const std::vector<Point_3>& m_vertices, std::vector<std::array<int, 4>>& cells,
                        const std::string& output_file);
 };
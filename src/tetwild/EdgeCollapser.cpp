@@ -12,11 +12,16 @@
 #include <tetwild/EdgeCollapser.h>
 #include <tetwild/Common.h>
 #include <tetwild/Logger.h>
+#include <tetwild/Args.h>
+#include <tetwild/Parallel.h>
 #include <igl/Timer.h>
+#include <atomic>
+#include <memory>
 
 namespace tetwild {
 
 void EdgeCollapser::init() {
+    refreshVertexSoA();
     energy_time = 0;
 
     ////cal dir_edge
@@ -40,25 +45,24 @@ void EdgeCollapser::init() {
     edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
 
     const unsigned int edges_size = edges.size();
+    std::vector<ElementInQueue_ec> eles;
+    eles.reserve(edges_size);
     for (unsigned int i = 0; i < edges_size; i++) {
         double weight = -1;
 //        if (isCollapsable_cd1(edges[i][0], edges[i][1]) && isCollapsable_cd2(edges[i][0], edges[i][1])) {
         if (isCollapsable_cd1(edges[i][0], edges[i][1])) {
             weight = calEdgeLength(edges[i][0], edges[i][1]);
-            if (isCollapsable_cd3(edges[i][0], edges[i][1], weight)) {
-                ElementInQueue_ec ele(edges[i], weight);
-                ec_queue.push(ele);
-            }
+            if (isCollapsable_cd3(edges[i][0], edges[i][1], weight))
+                eles.emplace_back(edges[i], weight);
         }
 //        if (isCollapsable_cd1(edges[i][1], edges[i][0]) && isCollapsable_cd2(edges[i][0], edges[i][1])) {
         if (isCollapsable_cd1(edges[i][1], edges[i][0])) {
             weight = weight == -1 ? calEdgeLength(edges[i][0], edges[i][1]) : weight;
-            if (isCollapsable_cd3(edges[i][0], edges[i][1], weight)) {
-                ElementInQueue_ec ele({{edges[i][1], edges[i][0]}}, weight);
-                ec_queue.push(ele);
-            }
+            if (isCollapsable_cd3(edges[i][0], edges[i][1], weight))
+                eles.emplace_back(std::array<int, 2>({{edges[i][1], edges[i][0]}}), weight);
         }
     }
+    ec_queue.pushAll(std::move(eles));
 
     counter = 0;
     suc_counter = 0;
@@ -70,6 +74,10 @@ void EdgeCollapser::collapse() {
     tet_tss.assign(tets.size(), 0);
     int cnt = 0;
     logger().debug("edge queue size = {}", ec_queue.size());
+    int num_threads = getNumThreads(args.num_threads);
+    if (num_threads > 1 && budget == 0)
+        collapseInParallel(num_threads);
+
     while (!ec_queue.empty()) {
         std::array<int, 2> v_ids = ec_queue.top().v_ids;
         double old_weight = ec_queue.top().weight;
@@ -212,6 +220,170 @@ void EdgeCollapser::collapse() {
     postProcess();
 }
 
+void EdgeCollapser::collapseInParallel(int num_threads) {
+    const int LOCKED = -1;
+    evaluateExactCoordinates();
+
+    //every thread works on its own copy to keep separate timers, counters and queues
+    std::vector<EdgeCollapser> workers(num_threads, EdgeCollapser(*this, ideal_weight));
+    for (auto& worker : workers) {
+        worker.is_limit_length = is_limit_length;
+        worker.is_check_quality = is_check_quality;
+        worker.is_soft = is_soft;
+        worker.soft_energy = soft_energy;
+        worker.breakdown_timing = {{0, 0, 0, 0, 0, 0}};
+        worker.breakdown_timing0 = {{0, 0}};
+    }
+
+    //a vertex is locked by the edge whose token it holds, tokens of previous rounds are stale
+    std::unique_ptr<std::atomic<int>[]> v_locks(new std::atomic<int>[tet_vertices.size()]);
+    for (int i = 0; i < tet_vertices.size(); i++)
+        v_locks[i] = -1;
+
+    const int batch_size = args.is_deterministic ? 8192 : 1024 * num_threads;
+    int round_token = 0;
+    int round = 0;
+    std::vector<ElementInQueue_ec> batch;
+    std::vector<int> return_codes;
+    std::vector<std::vector<int>> old_t_ids;
+    std::vector<std::vector<bool>> is_t_removed;
+    std::vector<ElementInQueue_ec> deferred_eles;
+    while (!ec_queue.empty()) {
+        round++;
+        round_token += batch.size();
+        batch.clear();
+        deferred_eles.clear();
+        for (int n_popped = 0; batch.size() < batch_size && n_popped < 4 * batch_size && !ec_queue.empty(); n_popped++) {
+            std::array<int, 2> v_ids = ec_queue.top().v_ids;
+            double old_weight = ec_queue.top().weight;
+            ec_queue.pop();
+
+            if (!isEdgeValid(v_ids))
+                continue;
+            double weight = calEdgeLength(v_ids);
+            if (weight != old_weight || !isCollapsable_cd3(v_ids[0], v_ids[1], weight))
+                continue;
+            while (!ec_queue.empty() && ec_queue.top().v_ids == v_ids)
+                ec_queue.pop();
+
+            //in deterministic mode, the conflicts are resolved here in the order of the queue
+            if (args.is_deterministic && !lockOneRings(v_ids, round_token, round_token + batch.size(), v_locks.get())) {
+                deferred_eles.emplace_back(v_ids, weight);
+                continue;
+            }
+            batch.emplace_back(v_ids, weight);
+        }
+        for (const auto& ele : deferred_eles)
+            ec_queue.push(ele);
+
+        return_codes.assign(batch.size(), LOCKED);
+        old_t_ids.resize(batch.size());
+        is_t_removed.resize(batch.size());
+        auto collapse_one = [&](int i, int thread_id) {
+            const std::array<int, 2>& v_ids = batch[i].v_ids;
+            if (!args.is_deterministic && !lockOneRings(v_ids, round_token, round_token + i, v_locks.get()))
+                return;
+            EdgeCollapser& worker = workers[thread_id];
+#if TIMING_BREAKDOWN
+            worker.igl_timer.start();
+#endif
+            return_codes[i] = worker.collapseAnEdge(v_ids[0], v_ids[1], old_t_ids[i], is_t_removed[i]);
+#if TIMING_BREAKDOWN
+            double time = worker.igl_timer.getElapsedTime();
+            if (return_codes[i] == SUCCESS)
+                worker.breakdown_timing[id_success] += time;
+            else if (return_codes[i] == ENVELOP_SUC)
+                worker.breakdown_timing[id_env_success] += time;
+            else if (return_codes[i] == ENVELOP)
+                worker.breakdown_timing[id_env_fail] += time;
+            else if (return_codes[i] == FLIP)
+                worker.breakdown_timing[id_flip_fail] += time;
+            else
+                worker.breakdown_timing[id_energy_fail] += time;
+#endif
+            //the new tets may now involve an unrounded vertex, evaluate their exact coordinates while they are locked
+            if (return_codes[i] == SUCCESS || return_codes[i] == ENVELOP_SUC) {
+                for (int j = 0; j < old_t_ids[i].size(); j++) {
+                    if (is_t_removed[i][j] || isTetRounded(old_t_ids[i][j]))
+                        continue;
+                    for (int k = 0; k < 4; k++)
+                        tet_vertices[tets[old_t_ids[i][j]][k]].pos.evaluateExact();
+                }
+            }
+        };
+        parallelFor((int) batch.size(), num_threads, collapse_one);
+        if (!batch.empty() && std::count(return_codes.begin(), return_codes.end(), LOCKED) == batch.size()) {
+            //all the lock attempts failed and have been released, make sure that we progress
+            collapse_one(0, 0);
+        }
+
+        ///apply the changes in the order of the queue
+        for (int i = 0; i < batch.size(); i++) {
+            if (return_codes[i] == LOCKED) {
+                ec_queue.push(batch[i]);
+                continue;
+            }
+            if (return_codes[i] == SUCCESS || return_codes[i] == ENVELOP_SUC) {
+                applyCollapse(batch[i].v_ids[0], old_t_ids[i], is_t_removed[i]);
+                suc_counter++;
+            } else {
+                inf_es.push_back(batch[i].v_ids);
+                inf_e_tss.push_back(ts);
+            }
+            counter++;
+        }
+        for (auto& worker : workers) {
+            while (!worker.ec_queue.empty()) {
+                ec_queue.push(worker.ec_queue.top());
+                worker.ec_queue.pop();
+            }
+        }
+    }
+
+    for (const auto& worker : workers) {
+        envelop_accept_cnt += worker.envelop_accept_cnt;
+        energy_time += worker.energy_time;
+        for (int i = 0; i < breakdown_timing.size(); i++)
+            breakdown_timing[i] += worker.breakdown_timing[i];
+        for (int i = 0; i < breakdown_timing0.size(); i++)
+            breakdown_timing0[i] += worker.breakdown_timing0[i];
+    }
+    logger().debug("{} rounds of parallel collapses", round);
+}
+
+bool EdgeCollapser::lockOneRings(const std::array<int, 2>& v_ids, int round_token, int token, std::atomic<int>* v_locks) {
+    std::vector<int> locked_v_ids;
+    auto lock = [&](int v_id) {
+        int cur = v_locks[v_id].load();
+        while (true) {
+            if (cur == token)
+                return true;
+            if (cur >= round_token)
+                return false;
+            if (v_locks[v_id].compare_exchange_weak(cur, token)) {
+                locked_v_ids.push_back(v_id);
+                return true;
+            }
+        }
+    };
+
+    //once both vertices are locked, nobody else can modify their one-rings
+    bool is_locked = lock(v_ids[0]) && lock(v_ids[1]);
+    for (int i = 0; i < 2 && is_locked; i++) {
+        for (int t_id : tet_vertices[v_ids[i]].conn_tets) {
+            for (int j = 0; j < 4 && is_locked; j++)
+                is_locked = lock(tets[t_id][j]);
+            if (!is_locked)
+                break;
+        }
+    }
+    if (!is_locked) {
+        for (int v_id : locked_v_ids)
+            v_locks[v_id] = -1;
+    }
+    return is_locked;
+}
+
 void EdgeCollapser::postProcess() {
     logger().debug("postProcess!");
     counter = 0;
@@ -267,6 +439,29 @@ void EdgeCollapser::postProcess() {
 }
 
 int EdgeCollapser::collapseAnEdge(int v1_id, int v2_id) {
+    std::vector<int> old_t_ids;
+    std::vector<bool> is_removed;
+    int return_code = collapseAnEdge(v1_id, v2_id, old_t_ids, is_removed);
+    if (return_code == SUCCESS || return_code == ENVELOP_SUC)
+        applyCollapse(v1_id, old_t_ids, is_removed);
+    return return_code;
+}
+
+void EdgeCollapser::applyCollapse(int v1_id, const std::vector<int>& old_t_ids, const std::vector<bool>& is_removed) {
+    for (int i = 0; i < old_t_ids.size(); i++) {
+        if (is_removed[i])
+            t_is_removed[old_t_ids[i]] = true;
+    }
+    v_is_removed[v1_id] = true;
+
+    //update time stamps
+    ts++;
+    for (int i = 0; i < old_t_ids.size(); i++) {
+        tet_tss[old_t_ids[i]] = ts;
+    }
+}
+
+int EdgeCollapser::collapseAnEdge(int v1_id, int v2_id, std::vector<int>& old_t_ids, std::vector<bool>& is_removed) {
     bool is_edge_too_short = false;
     bool is_edge_degenerate = false;
     double length = sqrt(CGAL::squared_distance(tet_vertices[v1_id].posf, tet_vertices[v2_id].posf));
@@ -291,6 +486,7 @@ int EdgeCollapser::collapseAnEdge(int v1_id, int v2_id) {
     }
     if(!isBoundaryPoint(v1_id))
         tet_vertices[v1_id].is_on_boundary = false;
+    syncVertex(v1_id);
 
     //check boundary
     if(tet_vertices[v1_id].is_on_boundary && !tet_vertices[v2_id].is_on_boundary)
@@ -314,11 +510,11 @@ int EdgeCollapser::collapseAnEdge(int v1_id, int v2_id) {
     }
 
     //old_t_ids
-    std::vector<int> old_t_ids;
+    old_t_ids.clear();
     old_t_ids.reserve(tet_vertices[v1_id].conn_tets.size());
     for (auto it = tet_vertices[v1_id].conn_tets.begin(); it != tet_vertices[v1_id].conn_tets.end(); it++)
         old_t_ids.push_back(*it);
-    std::vector<bool> is_removed(old_t_ids.size(), false);
+    is_removed.assign(old_t_ids.size(), false);
 
     //new_tets
     std::vector<std::array<int, 4>> new_tets;
@@ -401,7 +597,7 @@ int EdgeCollapser::collapseAnEdge(int v1_id, int v2_id) {
 
     //check 2.5
     if (tet_vertices[v1_id].is_on_boundary) {
-        Point_3 old_p = tet_vertices[v1_id].pos;
+        HybridPoint_3 old_p = tet_vertices[v1_id].pos;
         Point_3f old_pf = tet_vertices[v1_id].posf;
         tet_vertices[v1_id].posf = tet_vertices[v2_id].posf;
         tet_vertices[v1_id].pos = tet_vertices[v2_id].pos;
@@ -472,7 +668,6 @@ int EdgeCollapser::collapseAnEdge(int v1_id, int v2_id) {
     int cnt = 0;
     for (int i = 0; i < old_t_ids.size(); i++) {
         if (is_removed[i]) {
-            t_is_removed[old_t_ids[i]] = true;
             for (int j = 0; j < 4; j++)
                 if (tets[old_t_ids[i]][j] != v1_id && tets[old_t_ids[i]][j] != v2_id) {
                     tet_vertices[tets[old_t_ids[i]][j]].conn_tets.erase(
@@ -560,13 +755,7 @@ int EdgeCollapser::collapseAnEdge(int v1_id, int v2_id) {
 //        }
 //    }
 
-    v_is_removed[v1_id] = true;
-
-    //update time stamps
-    ts++;
-    for (int i = 0; i < old_t_ids.size(); i++) {
-        tet_tss[old_t_ids[i]] = ts;
-    }
+    //v1 and the removed tets are flagged by the caller, see applyCollapse()
 
     //add new elements
 //    std::vector<std::array<int, 2>> es;
@@ -623,6 +812,8 @@ int EdgeCollapser::collapseAnEdge(int v1_id, int v2_id) {
         }
     }
 
+    syncVertex(v2_id);
+
     if(is_envelop_suc)
         return ENVELOP_SUC;
     return SUCCESS;
@@ -749,12 +940,7 @@ bool EdgeCollapser::isCollapsable_epsilon(int v1_id, int v2_id) {
     }
 
     ///note that tris.size() can be 0 when v1 is on the boundary of the surface!!!
-    for (int i = 0; i < tris.size(); i++) {
-        if (isFaceOutEnvelop(tris[i]))
-            return false;
-    }
-
-    return true;
+    return !isFacesOutEnvelop(tris);
 }
 
 bool EdgeCollapser::isEdgeValid(const std::array<int, 2>& e){
@@ -12,8 +12,9 @@
 #ifndef NEW_GTET_EDGECOLLAPSER_H
 #define NEW_GTET_EDGECOLLAPSER_H
 
+#include <tetwild/BucketQueue.h>
 #include <tetwild/LocalOperations.h>
-#include <queue>
+#include <atomic>
 
 namespace tetwild {
 
@@ -37,7 +38,7 @@ struct cmp_ec {
 
 class EdgeCollapser: public LocalOperations {
 public:
-    std::priority_queue<ElementInQueue_ec, std::vector<ElementInQueue_ec>, cmp_ec> ec_queue;
+    BucketQueue<ElementInQueue_ec, cmp_ec, false> ec_queue;
     double ideal_weight=0;
 
     bool is_limit_length=true;
@@ -55,6 +56,14 @@ public:
     const int ENVELOP=3;
     const int ENVELOP_SUC=4;
     int collapseAnEdge(int v1_id, int v2_id);
+    // Same as above, but the removal of v1 and of the tets is left to applyCollapse()
+    int collapseAnEdge(int v1_id, int v2_id, std::vector<int>& old_t_ids, std::vector<bool>& is_removed);
+    void applyCollapse(int v1_id, const std::vector<int>& old_t_ids, const std::vector<bool>& is_removed);
+
+    // Collapse the queued edges by rounds, edges whose one-rings overlap are never collapsed in the same round
+    void collapseInParallel(int num_threads);
+    // Try to lock all the vertices of the one-rings of an edge with the given token (tokens below round_token are stale)
+    bool lockOneRings(const std::array<int, 2>& v_ids, int round_token, int token, std::atomic<int>* v_locks);
 
     bool is_soft = false;
     double soft_energy = 6;
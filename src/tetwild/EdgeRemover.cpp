@@ -12,11 +12,14 @@
 #include <tetwild/EdgeRemover.h>
 #include <tetwild/Common.h>
 #include <tetwild/Logger.h>
+#include <tetwild/Args.h>
+#include <tetwild/Parallel.h>
 #include <unordered_map>
 
 namespace tetwild {
 
 void EdgeRemover::init() {
+    refreshVertexSoA();
     energy_time = 0;
 
     const unsigned int tets_size = tets.size();
@@ -39,18 +42,16 @@ void EdgeRemover::init() {
     std::sort(edges.begin(), edges.end());
     edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
 
+    std::vector<ElementInQueue_er> eles;
+    eles.reserve(edges.size());
     for (unsigned int i = 0; i < edges.size(); i++) {
-        std::vector<int> t_ids;
-        setIntersection(tet_vertices[edges[i][0]].conn_tets, tet_vertices[edges[i][1]].conn_tets, t_ids);
-        addNewEdge(edges[i]);
-//        if (isSwappable_cd1(edges[i])) {
-//            double weight = calEdgeLength(edges[i]);
-//            if (isSwappable_cd2(weight)) {
-//                ElementInQueue_er ele(edges[i], weight);
-//                er_queue.push(ele);
-//            }
-//        }
+        if (isSwappable_cd1(edges[i])) {
+            double weight = calEdgeLength(edges[i]);
+            if (isSwappable_cd2(weight))
+                eles.emplace_back(edges[i], weight);
+        }
     }
+    er_queue.pushAll(std::move(eles));
 
     counter = 0;
     suc_counter = 0;
@@ -67,7 +68,14 @@ void EdgeRemover::swap(){
     tmp_cnt6=0;
     int cnt5=0;
 
+    int num_threads = getNumThreads(args.num_threads);
     while(!er_queue.empty()){
+        //the first removals are allowed to keep the quality unchanged, those are still done sequentially
+        if (num_threads > 1 && equal_buget <= 0) {
+            cnt5 += swapInParallel(num_threads);
+            break;
+        }
+
         const ElementInQueue_er& ele=er_queue.top();
 
         if(!isEdgeValid(ele.v_ids)){
@@ -122,6 +130,143 @@ void EdgeRemover::swap(){
     logger().debug("energy_time = {}", energy_time);
 }
 
+int EdgeRemover::swapInParallel(int num_threads) {
+    evaluateExactCoordinates();
+
+    //every thread works on its own copy to keep separate timers, counters and queues
+    std::vector<EdgeRemover> workers(num_threads, EdgeRemover(LocalOperations(*this), ideal_weight));
+    for (auto& worker : workers) {
+        worker.is_parallel_worker = true;
+        worker.equal_buget = equal_buget;
+    }
+
+    const int batch_size = args.is_deterministic ? 8192 : 1024 * num_threads;
+    std::vector<int> v_locks;//last round in which a vertex has been locked
+    int round = 0;
+    int cnt5 = 0;
+    std::vector<std::array<int, 2>> edges;
+    std::vector<std::vector<int>> old_t_ids;
+    std::vector<int> t_slots;
+    std::vector<int> n_removed_tets;
+    std::vector<ElementInQueue_er> deferred_eles;
+    while (!er_queue.empty()) {
+        round++;
+        v_locks.resize(tet_vertices.size(), 0);
+        edges.clear();
+        old_t_ids.clear();
+        deferred_eles.clear();
+
+        ///pick a bucket of the longest edges whose rings do not overlap
+        for (int n_popped = 0; edges.size() < batch_size && n_popped < 4 * batch_size && !er_queue.empty(); n_popped++) {
+            ElementInQueue_er ele = er_queue.top();
+            er_queue.pop();
+            if (!isEdgeValid(ele.v_ids))
+                continue;
+            std::vector<int> t_ids;
+            if (!isSwappable_cd1(ele.v_ids, t_ids, true))
+                continue;
+            while (!er_queue.empty() && er_queue.top().v_ids == ele.v_ids)
+                er_queue.pop();
+
+            bool is_locked = false;
+            for (int j = 0; j < t_ids.size() && !is_locked; j++) {
+                for (int k = 0; k < 4; k++) {
+                    if (v_locks[tets[t_ids[j]][k]] == round) {
+                        is_locked = true;
+                        break;
+                    }
+                }
+            }
+            if (is_locked) {
+                deferred_eles.push_back(ele);
+                continue;
+            }
+            for (int t_id : t_ids) {
+                for (int k = 0; k < 4; k++)
+                    v_locks[tets[t_id][k]] = round;
+            }
+            edges.push_back(ele.v_ids);
+            old_t_ids.push_back(std::move(t_ids));
+        }
+        for (const auto& ele : deferred_eles)
+            er_queue.push(ele);
+
+        ///reserve the extra tet of the 5-6 removals, no array is resized while swapping
+        t_slots.assign(edges.size(), -1);
+        for (int i = 0; i < edges.size(); i++) {
+            if (old_t_ids[i].size() != 5)
+                continue;
+            std::vector<int> new_t_ids;
+            getNewTetSlots(1, new_t_ids);
+            t_slots[i] = new_t_ids[0];
+            t_is_removed[t_slots[i]] = true;
+        }
+
+        n_removed_tets.assign(edges.size(), 0);
+        parallelFor((int) edges.size(), num_threads, [&](int i, int thread_id) {
+            EdgeRemover& worker = workers[thread_id];
+            const std::vector<int>& t_ids = old_t_ids[i];
+            worker.reserved_t_ids.clear();
+            if (t_slots[i] >= 0)
+                worker.reserved_t_ids.push_back(t_slots[i]);
+            if (worker.removeAnEdge_32(edges[i][0], edges[i][1], t_ids))
+                n_removed_tets[i] = 3;
+            else if (worker.removeAnEdge_44(edges[i][0], edges[i][1], t_ids))
+                n_removed_tets[i] = 4;
+            else if (worker.removeAnEdge_56(edges[i][0], edges[i][1], t_ids))
+                n_removed_tets[i] = 5;
+            else
+                return;
+
+            //the new tets may now involve an unrounded vertex, evaluate their exact coordinates while they are locked
+            //(the new tets are the old ones and, for a 5-6 removal, the reserved one)
+            std::vector<int> new_t_ids = t_ids;
+            if (n_removed_tets[i] == 5)
+                new_t_ids.push_back(t_slots[i]);
+            bool is_rounded = true;
+            for (int j = 0; j < new_t_ids.size() && is_rounded; j++)
+                is_rounded = isTetRounded(new_t_ids[j]);
+            if (!is_rounded) {
+                for (int t_id : new_t_ids) {
+                    for (int k = 0; k < 4; k++)
+                        tet_vertices[tets[t_id][k]].pos.evaluateExact();
+                }
+            }
+        });
+
+        ///apply the changes
+        for (auto& worker : workers) {
+            for (const auto& t : worker.changed_t_ids)
+                t_is_removed[t.first] = t.second;
+            worker.changed_t_ids.clear();
+            while (!worker.er_queue.empty()) {
+                er_queue.push(worker.er_queue.top());
+                worker.er_queue.pop();
+            }
+        }
+        for (int i = 0; i < edges.size(); i++) {
+            if (n_removed_tets[i] > 0)
+                suc_counter++;
+            if (n_removed_tets[i] == 5)
+                cnt5++;
+            else if (t_slots[i] >= 0)
+                t_empty_start = std::min(t_empty_start, t_slots[i]);//the reserved slot is unused
+            counter++;
+        }
+    }
+
+    for (const auto& worker : workers) {
+        tmp_cnt3 += worker.tmp_cnt3;
+        tmp_cnt4 += worker.tmp_cnt4;
+        tmp_cnt5 += worker.tmp_cnt5;
+        tmp_cnt6 += worker.tmp_cnt6;
+        energy_time += worker.energy_time;
+    }
+    logger().debug("{} rounds of parallel swaps", round);
+
+    return cnt5;
+}
+
 bool EdgeRemover::removeAnEdge_32(int v1_id, int v2_id, const std::vector<int>& old_t_ids) {
     if(old_t_ids.size() >= 6) tmp_cnt6++;
     if(old_t_ids.size() == 5) tmp_cnt5++;
@@ -190,7 +335,7 @@ bool EdgeRemover::removeAnEdge_32(int v1_id, int v2_id, const std::vector<int>&
         }
     }
 
-    t_is_removed[old_t_ids[0]] = true;
+    setTetRemoved(old_t_ids[0], true);
     tets[t_ids[0]] = new_tets[0];//v2
     tets[t_ids[1]] = new_tets[1];//v1
 
@@ -614,7 +759,7 @@ bool EdgeRemover::removeAnEdge_56(int v1_id, int v2_id, const std::vector<int>&
 
     std::vector<int> new_t_ids = old_t_ids;
     getNewTetSlots(1, new_t_ids);
-    t_is_removed[new_t_ids.back()] = false;
+    setTetRemoved(new_t_ids.back(), false);
     for (int i = 0; i < 2; i++) {
         tets[new_t_ids[i]] = new_tets[(selected_id + 1) % 5][i];
         tets[new_t_ids[i + 2]] = new_tets[(selected_id - 1 + 5) % 5][i];
@@ -734,6 +879,15 @@ bool EdgeRemover::isEdgeValid(const std::array<int, 2>& v_ids){
 }
 
 void EdgeRemover::getNewTetSlots(int n, std::vector<int>& new_conn_tets) {
+    if (is_parallel_worker) {
+        //the slots have been reserved by the caller, see swapInParallel()
+        if (reserved_t_ids.size() < n)
+            log_and_throw("Not enough reserved tet slots!");
+        new_conn_tets.insert(new_conn_tets.end(), reserved_t_ids.end() - n, reserved_t_ids.end());
+        reserved_t_ids.resize(reserved_t_ids.size() - n);
+        return;
+    }
+
     unsigned int cnt = 0;
     for (unsigned int i = t_empty_start; i < t_is_removed.size(); i++) {
         if (t_is_removed[i]) {
@@ -757,6 +911,13 @@ void EdgeRemover::getNewTetSlots(int n, std::vector<int>& new_conn_tets) {
     }
 }
 
+void EdgeRemover::setTetRemoved(int t_id, bool is_removed) {
+    if (is_parallel_worker)
+        changed_t_ids.emplace_back(t_id, is_removed);//applied by the caller, see swapInParallel()
+    else
+        t_is_removed[t_id] = is_removed;
+}
+
 void EdgeRemover::addNewEdge(const std::array<int, 2>& e){
     if (isSwappable_cd1(e)) {
         double weight = calEdgeLength(e);
@@ -12,8 +12,8 @@
 #ifndef NEW_GTET_EDGEREMOVER_H
 #define NEW_GTET_EDGEREMOVER_H
 
+#include <tetwild/BucketQueue.h>
 #include <tetwild/LocalOperations.h>
-#include <queue>
 
 namespace tetwild {
 
@@ -36,7 +36,7 @@ struct cmp_er {
 
 class EdgeRemover:public LocalOperations {
 public:
-    std::priority_queue<ElementInQueue_er, std::vector<ElementInQueue_er>, cmp_er> er_queue;
+    BucketQueue<ElementInQueue_er, cmp_er, true> er_queue;
 
     double ideal_weight;
 
@@ -56,6 +56,8 @@ public:
 
     void init();
     void swap();
+    // Remove the queued edges by rounds of edges whose rings do not overlap, returns the number of 5-6 removals
+    int swapInParallel(int num_threads);
     bool removeAnEdge_32(int v1_id, int v2_id, const std::vector<int>& old_t_ids);
     bool removeAnEdge_44(int v1_id, int v2_id, const std::vector<int>& old_t_ids);
     bool removeAnEdge_56(int v1_id, int v2_id, const std::vector<int>& old_t_ids);
@@ -66,11 +68,18 @@ public:
     bool isSwappable_cd2(double weight);
     bool isEdgeValid(const std::array<int, 2>& v_ids);
     void getNewTetSlots(int n, std::vector<int>& new_conn_tets);
+    void setTetRemoved(int t_id, bool is_removed);
 
     void addNewEdge(const std::array<int, 2>& e);
 
     igl::Timer tmp_timer;
     double energy_time = 0;
+
+    // A parallel worker takes its new tets from reserved_t_ids, and records
+    // in changed_t_ids the changes of t_is_removed applied later by the caller
+    bool is_parallel_worker = false;
+    std::vector<int> reserved_t_ids;
+    std::vector<std::pair<int, bool>> changed_t_ids;
 };
 
 } // namespace tetwild
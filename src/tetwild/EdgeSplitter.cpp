@@ -12,6 +12,8 @@
 #include <tetwild/EdgeSplitter.h>
 #include <tetwild/Common.h>
 #include <tetwild/Logger.h>
+#include <tetwild/Args.h>
+#include <tetwild/Parallel.h>
 
 namespace tetwild {
 
@@ -35,6 +37,8 @@ void EdgeSplitter::getMesh_ui(const std::vector<std::array<int, 4>>& tets, Eigen
 }
 
 void EdgeSplitter::init() {
+    refreshVertexSoA();
+
     std::vector<std::array<int, 2>> edges;
     for (unsigned int i = 0; i < tets.size(); i++) {
         if (t_is_removed[i])
@@ -53,13 +57,14 @@ void EdgeSplitter::init() {
     std::sort(edges.begin(), edges.end());
     edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
 
+    std::vector<ElementInQueue_es> eles;
+    eles.reserve(edges.size());
     for (unsigned int i = 0; i < edges.size(); i++) {
         double weight = calEdgeLength(edges[i][0], edges[i][1]);
-        if (isSplittable_cd1(edges[i][0], edges[i][1], weight)) {
-            ElementInQueue_es ele(edges[i], weight);
-            es_queue.push(ele);
-        }
+        if (isSplittable_cd1(edges[i][0], edges[i][1], weight))
+            eles.emplace_back(edges[i], weight);
     }
+    es_queue.pushAll(std::move(eles));
 
     t_empty_start = 0;
     v_empty_start = 0;
@@ -99,6 +104,10 @@ void EdgeSplitter::split() {
     logger().debug("{}", es_queue.size());
     logger().debug("ideal_weight = {}", ideal_weight);
 
+    int num_threads = getNumThreads(args.num_threads);
+    if (num_threads > 1 && budget == 0)
+        splitInParallel(num_threads);
+
     while (!es_queue.empty()) {
         const ElementInQueue_es &ele = es_queue.top();
 
@@ -148,50 +157,119 @@ void EdgeSplitter::split() {
 
 }
 
-bool EdgeSplitter::splitAnEdge(const std::array<int, 2>& edge) {
-    int v1_id = edge[0];
-    int v2_id = edge[1];
+void EdgeSplitter::splitInParallel(int num_threads) {
+    evaluateExactCoordinates();
 
-    //add new vertex
-    TetVertex v;//tet_vertices[v_id] is actually be reset
-    bool is_found = false;
-    for(int i=v_empty_start;i<v_is_removed.size();i++){
-        v_empty_start = i;
-        if(v_is_removed[i]) {
-            is_found = true;
-            break;
-        }
+    //every thread works on its own copy to keep separate timers and counters
+    std::vector<EdgeSplitter> workers(num_threads, EdgeSplitter(LocalOperations(*this), ideal_weight));
+    for (auto& worker : workers) {
+        worker.is_check_quality = is_check_quality;
+        worker.is_cal_quality_end = is_cal_quality_end;
+        worker.is_over_refine = is_over_refine;
     }
-    if(!is_found)
-        v_empty_start = v_is_removed.size();
 
-    int v_id = v_empty_start;
-    if (v_empty_start < v_is_removed.size()) {
-        tet_vertices[v_id] = v;
-        v_is_removed[v_id] = false;
-    } else {
-        tet_vertices.push_back(v);
-        v_is_removed.push_back(false);
+    const int batch_size = args.is_deterministic ? 8192 : 1024 * num_threads;
+    std::vector<int> v_locks;//last round in which a vertex has been locked
+    int round = 0;
+    std::vector<std::array<int, 2>> edges;
+    std::vector<std::vector<int>> old_t_ids;
+    std::vector<std::vector<int>> new_t_ids;
+    std::vector<int> v_ids;
+    std::vector<std::vector<ElementInQueue_es>> new_eles;
+    std::vector<ElementInQueue_es> deferred_eles;
+    while (!es_queue.empty()) {
+        round++;
+        v_locks.resize(tet_vertices.size(), 0);
+        edges.clear();
+        old_t_ids.clear();
+        deferred_eles.clear();
+
+        ///pick the longest edges whose one-rings do not overlap
+        for (int i = 0; i < batch_size && !es_queue.empty(); i++) {
+            ElementInQueue_es ele = es_queue.top();
+            es_queue.pop();
+            std::vector<int> t_ids;
+            setIntersection(tet_vertices[ele.v_ids[0]].conn_tets, tet_vertices[ele.v_ids[1]].conn_tets, t_ids);
+            bool is_locked = v_locks[ele.v_ids[0]] == round || v_locks[ele.v_ids[1]] == round;
+            for (int j = 0; j < t_ids.size() && !is_locked; j++) {
+                for (int k = 0; k < 4; k++) {
+                    if (v_locks[tets[t_ids[j]][k]] == round) {
+                        is_locked = true;
+                        break;
+                    }
+                }
+            }
+            if (is_locked) {
+                deferred_eles.push_back(ele);
+                continue;
+            }
+            v_locks[ele.v_ids[0]] = round;
+            v_locks[ele.v_ids[1]] = round;
+            for (int t_id : t_ids) {
+                for (int k = 0; k < 4; k++)
+                    v_locks[tets[t_id][k]] = round;
+            }
+            edges.push_back(ele.v_ids);
+            old_t_ids.push_back(std::move(t_ids));
+        }
+        for (const auto& ele : deferred_eles)
+            es_queue.push(ele);
+
+        ///reserve the new vertices and tets beforehand, no array is resized while splitting
+        v_ids.resize(edges.size());
+        new_t_ids.assign(edges.size(), std::vector<int>());
+        for (int i = 0; i < edges.size(); i++) {
+            v_ids[i] = getNewVertexSlot();
+            getNewTetSlots(old_t_ids[i].size(), new_t_ids[i]);
+            for (int t_id : new_t_ids[i])
+                t_is_removed[t_id] = false;
+        }
+
+        new_eles.resize(edges.size());
+        parallelFor((int) edges.size(), num_threads, [&](int i, int thread_id) {
+            new_eles[i].clear();
+            workers[thread_id].splitAnEdge(edges[i], v_ids[i], old_t_ids[i], new_t_ids[i], new_eles[i]);
+            //the new vertex is only touched by this thread during this round
+            tet_vertices[v_ids[i]].pos.evaluateExact();
+        });
+        for (int i = 0; i < edges.size(); i++) {
+            for (const auto& ele : new_eles[i])
+                es_queue.push(ele);
+        }
+        counter += edges.size();
+        suc_counter += edges.size();
     }
+    logger().debug("{} rounds of parallel splits", round);
+}
 
-    //    int v_id = -1;
-//    auto empty_slot = std::find(v_is_removed.begin(), v_is_removed.end(), true);//can be improved
-//    if (empty_slot != v_is_removed.end()) {
-//        v_id = empty_slot - v_is_removed.begin();
-//        tet_vertices[v_id] = v;
-//        v_is_removed[v_id] = false;
-//    } else {
-//        tet_vertices.push_back(v);
-//        v_is_removed.push_back(false);
-//        v_id = v_is_removed.size() - 1;
-//    }
+bool EdgeSplitter::splitAnEdge(const std::array<int, 2>& edge) {
+    //add new vertex
+    int v_id = getNewVertexSlot();
 
     //old_t_ids
     std::vector<int> old_t_ids;
-    setIntersection(tet_vertices[v1_id].conn_tets, tet_vertices[v2_id].conn_tets, old_t_ids);
+    setIntersection(tet_vertices[edge[0]].conn_tets, tet_vertices[edge[1]].conn_tets, old_t_ids);
 
-    //new_tets
+    //get new tet ids
     std::vector<int> new_t_ids;
+    getNewTetSlots(old_t_ids.size(), new_t_ids);
+    for (int t_id : new_t_ids)
+        t_is_removed[t_id] = false;
+
+    std::vector<ElementInQueue_es> new_eles;
+    splitAnEdge(edge, v_id, old_t_ids, new_t_ids, new_eles);
+    for (const auto& ele : new_eles)
+        es_queue.push(ele);
+
+    return true;
+}
+
+void EdgeSplitter::splitAnEdge(const std::array<int, 2>& edge, int v_id, const std::vector<int>& old_t_ids,
+                               const std::vector<int>& new_t_ids, std::vector<ElementInQueue_es>& new_eles) {
+    int v1_id = edge[0];
+    int v2_id = edge[1];
+
+    //new_tets
     std::vector<int> n12_v_ids;
     std::vector<std::array<int, 4>> new_tets;
     new_tets.reserve(old_t_ids.size() * 2);
@@ -217,19 +295,21 @@ bool EdgeSplitter::splitAnEdge(const std::array<int, 2>& edge) {
 
     tet_vertices[v_id].posf = CGAL::midpoint(tet_vertices[v1_id].posf, tet_vertices[v2_id].posf);
     tet_vertices[v_id].pos = Point_3(tet_vertices[v_id].posf[0], tet_vertices[v_id].posf[1], tet_vertices[v_id].posf[2]);
+    syncVertex(v_id);
     std::vector<TetQuality> tet_qs;
     if(!is_cal_quality_end) {
         calTetQualities(new_tets, tet_qs);
     }
 
     if (isFlip(new_tets)) {
-        tet_vertices[v_id].pos = CGAL::midpoint(tet_vertices[v1_id].pos, tet_vertices[v2_id].pos);
+        tet_vertices[v_id].pos = midpoint(tet_vertices[v1_id].pos, tet_vertices[v2_id].pos);
         tet_vertices[v_id].posf = Point_3f(CGAL::to_double(tet_vertices[v_id].pos[0]), CGAL::to_double(tet_vertices[v_id].pos[1]),
                                            CGAL::to_double(tet_vertices[v_id].pos[2]));
         tet_vertices[v_id].is_rounded = false;
     } else {
         tet_vertices[v_id].is_rounded = true;
     }
+    syncVertex(v_id);
 
 //    if(!is_cal_quality_end)
 //          calTetQualities(new_tets, tet_qs);
@@ -252,8 +332,6 @@ bool EdgeSplitter::splitAnEdge(const std::array<int, 2>& edge) {
             tet_vertices[v_id].is_on_surface = false;
     }
 
-    //get new tet ids
-    getNewTetSlots(old_t_ids.size(), new_t_ids);
     for (int i = 0; i < old_t_ids.size(); i++) {
         tets[old_t_ids[i]] = new_tets[i * 2];
         tets[new_t_ids[i]] = new_tets[i * 2 + 1];
@@ -261,7 +339,6 @@ bool EdgeSplitter::splitAnEdge(const std::array<int, 2>& edge) {
             tet_qualities[old_t_ids[i]] = tet_qs[i * 2];
             tet_qualities[new_t_ids[i]] = tet_qs[i * 2 + 1];
         }
-        t_is_removed[new_t_ids[i]] = false;
         is_surface_fs[new_t_ids[i]] = is_surface_fs[old_t_ids[i]];
     }
 
@@ -291,6 +368,7 @@ bool EdgeSplitter::splitAnEdge(const std::array<int, 2>& edge) {
             setIntersection(tet_vertices[v1_id].on_edge, tet_vertices[v2_id].on_edge, tet_vertices[v_id].on_edge);
         }
     }
+    syncVertex(v_id);
 
     //update the connection
     for (int i = 0; i < old_t_ids.size(); i++) {
@@ -309,7 +387,7 @@ bool EdgeSplitter::splitAnEdge(const std::array<int, 2>& edge) {
         std::array<int, 2> e={{v1_id, v_id}};
         if(!isLocked_ui(e)) {
             ElementInQueue_es ele(e, weight);
-            es_queue.push(ele);
+            new_eles.push_back(ele);
         }
     }
 
@@ -318,7 +396,7 @@ bool EdgeSplitter::splitAnEdge(const std::array<int, 2>& edge) {
         std::array<int, 2> e={{v2_id, v_id}};
         if(!isLocked_ui(e)) {
             ElementInQueue_es ele(e, weight);
-            es_queue.push(ele);
+            new_eles.push_back(ele);
         }
     }
 
@@ -330,12 +408,48 @@ bool EdgeSplitter::splitAnEdge(const std::array<int, 2>& edge) {
             std::array<int, 2> e = {{*it, v_id}};
             if(!isLocked_ui(e)) {
                 ElementInQueue_es ele(e, weight);
-                es_queue.push(ele);
+                new_eles.push_back(ele);
             }
         }
     }
+}
 
-    return true;
+int EdgeSplitter::getNewVertexSlot() {
+    TetVertex v;//tet_vertices[v_id] is actually be reset
+    bool is_found = false;
+    for(int i=v_empty_start;i<v_is_removed.size();i++){
+        v_empty_start = i;
+        if(v_is_removed[i]) {
+            is_found = true;
+            break;
+        }
+    }
+    if(!is_found)
+        v_empty_start = v_is_removed.size();
+
+    int v_id = v_empty_start;
+    if (v_empty_start < v_is_removed.size()) {
+        tet_vertices[v_id] = v;
+        v_is_removed[v_id] = false;
+    } else {
+        tet_vertices.push_back(v);
+        v_is_removed.push_back(false);
+    }
+
+    //    int v_id = -1;
+//    auto empty_slot = std::find(v_is_removed.begin(), v_is_removed.end(), true);//can be improved
+//    if (empty_slot != v_is_removed.end()) {
+//        v_id = empty_slot - v_is_removed.begin();
+//        tet_vertices[v_id] = v;
+//        v_is_removed[v_id] = false;
+//    } else {
+//        tet_vertices.push_back(v);
+//        v_is_removed.push_back(false);
+//        v_id = v_is_removed.size() - 1;
+//    }
+    syncVertex(v_id);//grows vertex_soa
+
+    return v_id;
 }
 
 int EdgeSplitter::getOverRefineScale(int v1_id, int v2_id){
@@ -12,8 +12,8 @@
 #ifndef NEW_GTET_EDGESPLITTER_H
 #define NEW_GTET_EDGESPLITTER_H
 
+#include <tetwild/BucketQueue.h>
 #include <tetwild/LocalOperations.h>
-#include <queue>
 
 namespace tetwild {
 
@@ -29,6 +29,8 @@ public:
 
 struct cmp_es {
     bool operator()(const ElementInQueue_es &e1, const ElementInQueue_es &e2) {
+        if (e1.weight == e2.weight)
+            return e1.v_ids < e2.v_ids;
         return e1.weight < e2.weight;
     }
 };
@@ -38,7 +40,7 @@ public:
     bool is_check_quality = false;
     bool is_cal_quality_end = false;
 
-    std::priority_queue<ElementInQueue_es, std::vector<ElementInQueue_es>, cmp_es> es_queue;
+    BucketQueue<ElementInQueue_es, cmp_es, true> es_queue;
 
     int t_empty_start=0;
     int v_empty_start=0;
@@ -50,10 +52,16 @@ public:
 
     void init();
     void split();
+    // Split the queued edges by rounds of edges whose one-rings do not overlap
+    void splitInParallel(int num_threads);
 
     bool is_over_refine=false;
     int getOverRefineScale(int v1_id, int v2_id);
     bool splitAnEdge(const std::array<int, 2>& edge);
+    // Split an edge into the given (already reserved) vertex and tet slots, new edges to split are added to new_eles
+    void splitAnEdge(const std::array<int, 2>& edge, int v_id, const std::vector<int>& old_t_ids,
+                     const std::vector<int>& new_t_ids, std::vector<ElementInQueue_es>& new_eles);
+    int getNewVertexSlot();
 
     bool isSplittable_cd1(double weight);
     bool isSplittable_cd1(int v1_id, int v2_id, double weight);
@@ -0,0 +1,85 @@
+// This file is part of TetWild, a software for generating tetrahedral meshes.
+//
+// This Source Code Form is subject to the terms of the Mozilla Public License
+// v. 2.0. If a copy of the MPL was not distributed with this file, You can
+// obtain one at http://mozilla.org/MPL/2.0/.
+//
+
+#include <tetwild/EnvelopeCache.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace tetwild {
+
+EnvelopeCache::EnvelopeCache(size_t max_size)
+    : m_max_shard_size(std::max<size_t>(1, max_size / NUM_SHARDS))
+    , m_num_hits(0)
+    , m_num_misses(0)
+{ }
+
+EnvelopeCache::Key EnvelopeCache::getKey(const Triangle_3f& tri) {
+    return {{tri[0][0], tri[0][1], tri[0][2], tri[1][0], tri[1][1], tri[1][2], tri[2][0], tri[2][1], tri[2][2]}};
+}
+
+size_t EnvelopeCache::KeyHash::operator()(const Key& key) const {
+    uint64_t h = 0x9e3779b97f4a7c15ULL;
+    for (double x : key) {
+        uint64_t bits;
+        std::memcpy(&bits, &x, sizeof(bits));
+        h ^= bits + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+    }
+    //splitmix64 finalizer, the low bits are used to pick the shard
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return (size_t) h;
+}
+
+bool EnvelopeCache::find(const Key& key, double eps_2, double sampling_dist, bool& is_out) {
+    Shard& shard = m_shards[KeyHash()(key) % NUM_SHARDS];
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (shard.eps_2 == eps_2 && shard.sampling_dist == sampling_dist) {
+            auto it = shard.verdicts.find(key);
+            if (it != shard.verdicts.end()) {
+                is_out = it->second;
+                m_num_hits++;
+                return true;
+            }
+        }
+    }
+    m_num_misses++;
+    return false;
+}
+
+void EnvelopeCache::insert(const Key& key, double eps_2, double sampling_dist, bool is_out) {
+    Shard& shard = m_shards[KeyHash()(key) % NUM_SHARDS];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (shard.eps_2 != eps_2 || shard.sampling_dist != sampling_dist) {
+        shard.verdicts.clear();
+        shard.eps_2 = eps_2;
+        shard.sampling_dist = sampling_dist;
+    }
+    if (shard.verdicts.size() >= m_max_shard_size) {
+        shard.verdicts.clear();
+    }
+    shard.verdicts[key] = is_out;
+}
+
+void EnvelopeCache::clear() {
+    for (auto& shard : m_shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.verdicts.clear();
+    }
+    resetCounters();
+}
+
+void EnvelopeCache::resetCounters() {
+    m_num_hits = 0;
+    m_num_misses = 0;
+}
+
+} // namespace tetwild
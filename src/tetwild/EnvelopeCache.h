@@ -0,0 +1,73 @@
+// This file is part of TetWild, a software for generating tetrahedral meshes.
+//
+// This Source Code Form is subject to the terms of the Mozilla Public License
+// v. 2.0. If a copy of the MPL was not distributed with this file, You can
+// obtain one at http://mozilla.org/MPL/2.0/.
+//
+
+#pragma once
+
+#include <tetwild/CGALTypes.h>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+
+namespace tetwild {
+
+///
+/// @brief      { Thread-safe cache of envelope verdicts for triangles. Entries are keyed by the exact float coordinates
+///             of the triangle (in the given vertex order), so moving any of its vertices automatically misses the
+///             old entry. The envelope parameters (eps_2 and sampling_dist) are part of the key as well: a shard is
+///             flushed when they change. The cache is split in independently locked shards, and a shard is flushed
+///             when it grows past its capacity. }
+///
+class EnvelopeCache {
+public:
+    typedef std::array<double, 9> Key;
+
+    EnvelopeCache(size_t max_size = 1 << 18);
+
+    static Key getKey(const Triangle_3f& tri);
+
+    ///
+    /// @brief      { Looks up a triangle }
+    ///
+    /// @param[in]  key            { Key of the triangle (see getKey()) }
+    /// @param[in]  eps_2          { Squared envelope size used for the verdict }
+    /// @param[in]  sampling_dist  { Sampling distance used for the verdict }
+    /// @param[out] is_out         { Cached verdict, if found }
+    ///
+    /// @return     { Whether the triangle was found }
+    ///
+    bool find(const Key& key, double eps_2, double sampling_dist, bool& is_out);
+
+    void insert(const Key& key, double eps_2, double sampling_dist, bool is_out);
+
+    void clear();
+
+    size_t numHits() const { return m_num_hits; }
+    size_t numMisses() const { return m_num_misses; }
+    void resetCounters();
+
+private:
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::unordered_map<Key, bool, KeyHash> verdicts;
+        double eps_2 = -1;
+        double sampling_dist = -1;
+    };
+
+    static const int NUM_SHARDS = 64;
+
+    std::array<Shard, NUM_SHARDS> m_shards;
+    size_t m_max_shard_size;
+    std::atomic<size_t> m_num_hits;
+    std::atomic<size_t> m_num_misses;
+};
+
+} // namespace tetwild
@@ -12,11 +12,12 @@
 #include <tetwild/InoutFiltering.h>
 #include <tetwild/Logger.h>
 #include <tetwild/Utils.h>
+#include <tetwild/Args.h>
+#include <tetwild/WindingNumber.h>
 #include <tetwild/DisableWarnings.h>
 #include <CGAL/centroid.h>
 #include <tetwild/EnableWarnings.h>
 #include <pymesh/MshSaver.h>
-#include <igl/winding_number.h>
 #include <igl/write_triangle_mesh.h>
 #include <igl/remove_unreferenced.h>
 
@@ -44,7 +45,7 @@ std::vector<bool> InoutFiltering::filter() {
     Eigen::MatrixXi F;
     getSurface(V, F);
     Eigen::VectorXd W;
-    igl::winding_number(V, F, C, W);
+    WindingNumber(V, F).evaluate(C, W, args.num_threads);
 
     std::vector<bool> tmp_t_is_removed = t_is_removed;
     cnt = 0;
@@ -94,8 +95,8 @@ void InoutFiltering::getSurface(Eigen::MatrixXd& V, Eigen::MatrixXi& F){
         for (int j = 0; j < 4; j++) {
             if (is_surface_fs[i][j] != state.NOT_SURFACE && is_surface_fs[i][j] > 0) {//outside
                 std::array<int, 3> v_ids = {{tets[i][(j + 1) % 4], tets[i][(j + 2) % 4], tets[i][(j + 3) % 4]}};
-                if (CGAL::orientation(tet_vertices[v_ids[0]].pos, tet_vertices[v_ids[1]].pos,
-                                      tet_vertices[v_ids[2]].pos, tet_vertices[tets[i][j]].pos) != CGAL::POSITIVE) {
+                if (orientation(tet_vertices[v_ids[0]].pos, tet_vertices[v_ids[1]].pos,
+                                tet_vertices[v_ids[2]].pos, tet_vertices[tets[i][j]].pos) != CGAL::POSITIVE) {
                     std::swap(v_ids[0], v_ids[2]);
                 }
                 for (int k = 0; k < is_surface_fs[i][j]; k++) {
@@ -12,6 +12,7 @@
 #ifndef NEW_GTET_INOUTFILTERING_H
 #define NEW_GTET_INOUTFILTERING_H
 
+#include <tetwild/ForwardDecls.h>
 #include <tetwild/TetmeshElements.h>
 #include <Eigen/Dense>
 
@@ -19,6 +20,7 @@ namespace tetwild {
 
 class InoutFiltering {
 public:
+    const Args &args;
     const State &state;
     const std::vector<TetVertex>& tet_vertices;
     const std::vector<std::array<int, 4>>& tets;
@@ -28,8 +30,9 @@ public:
     InoutFiltering(const std::vector<TetVertex>& t_vs, const std::vector<std::array<int, 4>>& ts,
                    const std::vector<std::array<int, 4>>& is_sf_fs,
                    const std::vector<bool>& t_is_rm,
-                   const State &st)
-        : state(st)
+                   const Args &ar, const State &st)
+        : args(ar)
+        , state(st)
         , tet_vertices(t_vs)
         , tets(ts)
         , is_surface_fs(is_sf_fs)
@@ -14,6 +14,9 @@
 #include <tetwild/Args.h>
 #include <tetwild/Logger.h>
 #include <tetwild/DistanceQuery.h>
+#include <tetwild/AMIPSKernels.h>
+#include <tetwild/Predicates.h>
+#include <tetwild/Trace.h>
 #include <pymesh/MshSaver.h>
 #include <igl/svd3x3.h>
 #include <igl/Timer.h>
@@ -347,6 +350,10 @@ void LocalOperations::check() {
 
 void LocalOperations::outputInfo(int op_type, double time, bool is_log) {
     logger().debug("outputing info");
+    const long cache_hits = envelope_cache->numHits();
+    const long cache_misses = envelope_cache->numMisses();
+    logger().debug("envelope cache: {} hits, {} misses", cache_hits, cache_misses);
+    envelope_cache->resetCounters();
     //update min/max dihedral angle infos
     for (int i = 0; i < tets.size(); i++) {
         if (!t_is_removed[i])
@@ -527,25 +534,32 @@ void LocalOperations::outputInfo(int op_type, double time, bool is_log) {
     logger().debug("max_d_angle: >174 {}; >168 {}; >162 {}", cmp_cnt[5] / cnt, cmp_cnt[4] / cnt, cmp_cnt[3] / cnt);
 
     if(is_log) {
-        addRecord(MeshRecord(op_type, time, std::count(v_is_removed.begin(), v_is_removed.end(), false), cnt,
-                             min, min_avg / cnt, max, max_avg / cnt, max_slim_energy, avg_slim_energy / cnt), args, state);
+        MeshRecord record(op_type, time, std::count(v_is_removed.begin(), v_is_removed.end(), false), cnt,
+                          min, min_avg / cnt, max, max_avg / cnt, max_slim_energy, avg_slim_energy / cnt);
+        record.envelope_cache_hits = cache_hits;
+        record.envelope_cache_misses = cache_misses;
+        addRecord(record, args, state);
     }
 }
 
 bool LocalOperations::isTetFlip(const std::array<int, 4>& t) {
+    const TetVertexSoA& vs = *vertex_soa;
     CGAL::Orientation ori;
     bool is_rounded = true;
     for (int j = 0; j < 4; j++)
-        if (!tet_vertices[t[j]].is_rounded) {
+        if (!vs.isRounded(t[j])) {
             is_rounded = false;
             break;
         }
-    if (is_rounded)
-        ori = CGAL::orientation(tet_vertices[t[0]].posf, tet_vertices[t[1]].posf, tet_vertices[t[2]].posf,
-                                tet_vertices[t[3]].posf);
-    else
-        ori = CGAL::orientation(tet_vertices[t[0]].pos, tet_vertices[t[1]].pos, tet_vertices[t[2]].pos,
-                                tet_vertices[t[3]].pos);
+    if (is_rounded) {
+        int sign = orientationFilter(vs.x[t[0]], vs.y[t[0]], vs.z[t[0]], vs.x[t[1]], vs.y[t[1]], vs.z[t[1]],
+                                     vs.x[t[2]], vs.y[t[2]], vs.z[t[2]], vs.x[t[3]], vs.y[t[3]], vs.z[t[3]]);
+        if (sign != 0)
+            return sign < 0;
+        ori = CGAL::orientation(vs.posf(t[0]), vs.posf(t[1]), vs.posf(t[2]), vs.posf(t[3]));
+    } else
+        ori = orientation(tet_vertices[t[0]].pos, tet_vertices[t[1]].pos, tet_vertices[t[2]].pos,
+                          tet_vertices[t[3]].pos);
 
     if (ori != CGAL::POSITIVE)
         return true;
@@ -558,16 +572,39 @@ bool LocalOperations::isTetFlip(int t_id){
 
 bool LocalOperations::isFlip(const std::vector<std::array<int, 4>>& new_tets) {
     ////check orientation
+    //the rounded tets are filtered in batches, the uncertain and the unrounded ones go through isTetFlip()
+    const TetVertexSoA& vs = *vertex_soa;
+    OrientationBatch batch;
+    int batch_t_ids[OrientationBatch::SIZE];
+    int signs[OrientationBatch::SIZE];
+    auto isBatchFlip = [&]() {
+        batch.computeSigns(signs);
+        for (int i = 0; i < batch.size(); i++) {
+            if (signs[i] < 0 || (signs[i] == 0 && isTetFlip(new_tets[batch_t_ids[i]]))) {
+                trace::count(trace::FLIP_REJECTS);
+                return true;
+            }
+        }
+        batch.clear();
+        return false;
+    };
+
     for (int i = 0; i < new_tets.size(); i++) {
-//        CGAL::Orientation ori = CGAL::orientation(tet_vertices[new_tets[i][0]].pos,
-//                                                  tet_vertices[new_tets[i][1]].pos,
-//                                                  tet_vertices[new_tets[i][2]].pos,
-//                                                  tet_vertices[new_tets[i][3]].pos);
-//        if (ori != CGAL::POSITIVE)
-//            return true;
-        if(isTetFlip(new_tets[i]))
+        const auto& t = new_tets[i];
+        if (!vs.isRounded(t[0]) || !vs.isRounded(t[1]) || !vs.isRounded(t[2]) || !vs.isRounded(t[3])) {
+            if (isTetFlip(t)) {
+                trace::count(trace::FLIP_REJECTS);
+                return true;
+            }
+            continue;
+        }
+        batch_t_ids[batch.size()] = i;
+        batch.add(vs.posf(t[0]), vs.posf(t[1]), vs.posf(t[2]), vs.posf(t[3]));
+        if (batch.isFull() && isBatchFlip())
             return true;
     }
+    if (batch.size() > 0 && isBatchFlip())
+        return true;
 
     return false;
 }
@@ -732,19 +769,20 @@ void LocalOperations::calTetQualities(const std::vector<std::array<int, 4>>& new
     T11.resize(n);
     energy.resize(n);
 
+    const TetVertexSoA& vs = *vertex_soa;
     for (int i = 0; i < n; i++) {
-        T0[i] = tet_vertices[new_tets[i][0]].posf[0];
-        T1[i] = tet_vertices[new_tets[i][0]].posf[1];
-        T2[i] = tet_vertices[new_tets[i][0]].posf[2];
-        T3[i] = tet_vertices[new_tets[i][1]].posf[0];
-        T4[i] = tet_vertices[new_tets[i][1]].posf[1];
-        T5[i] = tet_vertices[new_tets[i][1]].posf[2];
-        T6[i] = tet_vertices[new_tets[i][2]].posf[0];
-        T7[i] = tet_vertices[new_tets[i][2]].posf[1];
-        T8[i] = tet_vertices[new_tets[i][2]].posf[2];
-        T9[i] = tet_vertices[new_tets[i][3]].posf[0];
-        T10[i] = tet_vertices[new_tets[i][3]].posf[1];
-        T11[i] = tet_vertices[new_tets[i][3]].posf[2];
+        T0[i] = vs.x[new_tets[i][0]];
+        T1[i] = vs.y[new_tets[i][0]];
+        T2[i] = vs.z[new_tets[i][0]];
+        T3[i] = vs.x[new_tets[i][1]];
+        T4[i] = vs.y[new_tets[i][1]];
+        T5[i] = vs.z[new_tets[i][1]];
+        T6[i] = vs.x[new_tets[i][2]];
+        T7[i] = vs.y[new_tets[i][2]];
+        T8[i] = vs.z[new_tets[i][2]];
+        T9[i] = vs.x[new_tets[i][3]];
+        T10[i] = vs.y[new_tets[i][3]];
+        T11[i] = vs.z[new_tets[i][3]];
     }
 
     ispc::energy_ispc(T0.data(), T1.data(), T2.data(), T3.data(), T4.data(),
@@ -752,10 +790,8 @@ void LocalOperations::calTetQualities(const std::vector<std::array<int, 4>>& new
         T9.data(), T10.data(), T11.data(), energy.data(), n);
 
     for (int i = 0; i < new_tets.size(); i++) {
-        CGAL::Orientation ori = CGAL::orientation(tet_vertices[new_tets[i][0]].posf,
-                                                  tet_vertices[new_tets[i][1]].posf,
-                                                  tet_vertices[new_tets[i][2]].posf,
-                                                  tet_vertices[new_tets[i][3]].posf);
+        CGAL::Orientation ori = CGAL::orientation(vs.posf(new_tets[i][0]), vs.posf(new_tets[i][1]),
+                                                  vs.posf(new_tets[i][2]), vs.posf(new_tets[i][3]));
         if (ori != CGAL::POSITIVE) {
             tet_qs[i].slim_energy = state.MAX_ENERGY;
             continue;
@@ -766,8 +802,39 @@ void LocalOperations::calTetQualities(const std::vector<std::array<int, 4>>& new
             tet_qs[i].slim_energy = state.MAX_ENERGY;
     }
 #else
-    for (int i = 0; i < new_tets.size(); i++) {
-        calTetQuality_AMIPS(new_tets[i], tet_qs[i]);
+    if (energy_type != state.ENERGY_AMIPS) {
+        for (int i = 0; i < new_tets.size(); i++) {
+            calTetQuality_AMIPS(new_tets[i], tet_qs[i]);
+        }
+        return;
+    }
+
+    //same as calling calTetQuality_AMIPS() on each tet, with the energies evaluated in a batch
+    int n = new_tets.size();
+    static thread_local TetCoordBatch batch;
+    static thread_local std::vector<double> energy;
+    batch.resize(n);
+    energy.resize(n);
+
+    const TetVertexSoA& vs = *vertex_soa;
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < 4; j++) {
+            batch.set(i, j * 3, vs.x[new_tets[i][j]]);
+            batch.set(i, j * 3 + 1, vs.y[new_tets[i][j]]);
+            batch.set(i, j * 3 + 2, vs.z[new_tets[i][j]]);
+        }
+    }
+    comformalAMIPSEnergyBatch(batch, energy.data());
+
+    for (int i = 0; i < n; i++) {
+        CGAL::Orientation ori = CGAL::orientation(vs.posf(new_tets[i][0]), vs.posf(new_tets[i][1]),
+                                                  vs.posf(new_tets[i][2]), vs.posf(new_tets[i][3]));
+        if (ori != CGAL::POSITIVE) //degenerate in floats
+            tet_qs[i].slim_energy = state.MAX_ENERGY;
+        else
+            tet_qs[i].slim_energy = energy[i];
+        if (std::isinf(tet_qs[i].slim_energy) || std::isnan(tet_qs[i].slim_energy) || tet_qs[i].slim_energy <= 0)
+            tet_qs[i].slim_energy = state.MAX_ENERGY;
     }
 #endif
 }
@@ -861,18 +928,16 @@ void LocalOperations::calTetQuality_AD(const std::array<int, 4>& tet, TetQuality
 
 void LocalOperations::calTetQuality_AMIPS(const std::array<int, 4>& tet, TetQuality& t_quality) {
     if (energy_type == state.ENERGY_AMIPS) {
-        CGAL::Orientation ori = CGAL::orientation(tet_vertices[tet[0]].posf,
-                                                  tet_vertices[tet[1]].posf,
-                                                  tet_vertices[tet[2]].posf,
-                                                  tet_vertices[tet[3]].posf);
+        const TetVertexSoA& vs = *vertex_soa;
+        CGAL::Orientation ori = CGAL::orientation(vs.posf(tet[0]), vs.posf(tet[1]), vs.posf(tet[2]), vs.posf(tet[3]));
         if (ori != CGAL::POSITIVE) {//degenerate in floats
             t_quality.slim_energy = state.MAX_ENERGY;
         } else {
             std::array<double, 12> T;
             for (int i = 0; i < 4; i++) {
-                for (int j = 0; j < 3; j++) {
-                    T[i*3+j] = tet_vertices[tet[i]].posf[j];
-                }
+                T[i*3] = vs.x[tet[i]];
+                T[i*3+1] = vs.y[tet[i]];
+                T[i*3+2] = vs.z[tet[i]];
             }
             t_quality.slim_energy = comformalAMIPSEnergy_new(T.data());
             if (std::isinf(t_quality.slim_energy) || std::isnan(t_quality.slim_energy))
@@ -1031,10 +1096,78 @@ bool LocalOperations::isFaceOutEnvelop(const Triangle_3f& tri) {
 //    }
 }
 
+bool LocalOperations::isFacesOutEnvelop(const std::vector<Triangle_3f>& tris) {
+#if CHECK_ENVELOP
+    if (!state.use_sampling) {
+        if (tris.empty())
+            return false;
+        trace::count(trace::ENVELOPE_REJECTS);
+        return true;
+    }
+
+#if TIMING_BREAKDOWN
+    igl_timer0.start();
+#endif
+    static thread_local std::vector<GEO::vec3> ps;
+    static thread_local std::vector<GEO::vec3> tri_ps;
+    static thread_local std::vector<EnvelopeCache::Key> keys;
+    ps.clear();
+    keys.clear();
+    for (const Triangle_3f& tri : tris) {
+        if (tri.is_degenerate())
+            continue;
+        const EnvelopeCache::Key key = EnvelopeCache::getKey(tri);
+        bool is_out;
+        if (envelope_cache->find(key, state.eps_2, state.sampling_dist, is_out)) {
+            if (is_out) {
+#if TIMING_BREAKDOWN
+                breakdown_timing0[id_sampling] += igl_timer0.getElapsedTime();
+#endif
+                trace::count(trace::ENVELOPE_REJECTS);
+                return true;
+            }
+            continue;
+        }
+        std::array<GEO::vec3, 3> vs = {{GEO::vec3(tri[0][0], tri[0][1], tri[0][2]),
+                                        GEO::vec3(tri[1][0], tri[1][1], tri[1][2]),
+                                        GEO::vec3(tri[2][0], tri[2][1], tri[2][2])}};
+        tri_ps.clear();
+        sampleTriangle(vs, tri_ps, state.sampling_dist);
+        ps.insert(ps.end(), tri_ps.begin(), tri_ps.end());
+        keys.push_back(key);
+    }
+#if TIMING_BREAKDOWN
+    breakdown_timing0[id_sampling] += igl_timer0.getElapsedTime();
+#endif
+    if (ps.empty())
+        return false;
+
+#if TIMING_BREAKDOWN
+    igl_timer0.start();
+#endif
+    bool is_out = !geo_sf_tree.points_in_envelope(ps, state.eps_2);
+#if TIMING_BREAKDOWN
+    breakdown_timing0[id_aabb] += igl_timer0.getElapsedTime();
+#endif
+    //when a sample is out, we do not know which face it belongs to
+    if (!is_out) {
+        for (const auto& key : keys)
+            envelope_cache->insert(key, state.eps_2, state.sampling_dist, false);
+    } else
+        trace::count(trace::ENVELOPE_REJECTS);
+    return is_out;
+#else
+    return false;
+#endif
+}
+
 bool LocalOperations::isPointOutEnvelop(const Point_3f& p) {
 #if CHECK_ENVELOP
     GEO::vec3 geo_p(p[0], p[1], p[2]);
-    return !geo_sf_tree.point_in_envelope(geo_p, state.eps_2);
+    if (geo_sf_tree.point_in_envelope(geo_p, state.eps_2))
+        return false;
+    trace::count(trace::ENVELOPE_REJECTS);
+    return true;
 #else
     return false;
 #endif
@@ -1045,6 +1178,21 @@ bool LocalOperations::isFaceOutEnvelop_sampling(const Triangle_3f& tri) {
     if (tri.is_degenerate())
         return false;
 
+    //the key holds the coordinates, so faces with a moved vertex never hit a stale verdict
+    const EnvelopeCache::Key key = EnvelopeCache::getKey(tri);
+    bool is_out;
+    if (envelope_cache->find(key, state.eps_2, state.sampling_dist, is_out))
+        return is_out;
+    is_out = isFaceOutEnvelop_sampling_uncached(tri);
+    envelope_cache->insert(key, state.eps_2, state.sampling_dist, is_out);
+    return is_out;
+#else
+    return false;
+#endif
+}
+
+bool LocalOperations::isFaceOutEnvelop_sampling_uncached(const Triangle_3f& tri) {
+#if CHECK_ENVELOP
 #if TIMING_BREAKDOWN
     igl_timer0.start();
 #endif
@@ -1108,7 +1256,10 @@ bool LocalOperations::isFaceOutEnvelop_sampling(const Triangle_3f& tri) {
 bool LocalOperations::isPointOutBoundaryEnvelop(const Point_3f& p) {
 #if CHECK_ENVELOP
     GEO::vec3 geo_p(p[0], p[1], p[2]);
-    return !geo_b_tree.point_in_envelope(geo_p, state.eps_2);
+    if (geo_b_tree.point_in_envelope(geo_p, state.eps_2))
+        return false;
+    trace::count(trace::ENVELOPE_REJECTS);
+    return true;
 #else
     return false;
 #endif
@@ -1249,6 +1400,17 @@ bool LocalOperations::isTetRounded(int t_id){
     return true;
 }
 
+void LocalOperations::evaluateExactCoordinates() {
+    //the lazy exact kernel computes and caches exact coordinates on demand, which is not thread-safe,
+    //so evaluate beforehand all the coordinates that may be read from several threads
+    for (int t_id = 0; t_id < tets.size(); t_id++) {
+        if (t_is_removed[t_id] || isTetRounded(t_id))
+            continue;
+        for (int j = 0; j < 4; j++)
+            tet_vertices[tets[t_id][j]].pos.evaluateExact();
+    }
+}
+
 void LocalOperations::getFaceConnTets(int v1_id, int v2_id, int v3_id, std::vector<int>& t_ids){
     std::vector<int> v1, v2, v3, tmp;
     v1.reserve(tet_vertices[v1_id].conn_tets.size());
@@ -14,9 +14,11 @@
 
 #include <tetwild/ForwardDecls.h>
 #include <tetwild/TetmeshElements.h>
+#include <tetwild/EnvelopeCache.h>
 #include <tetwild/geogram/MeshAABB.h>
 #include <igl/grad.h>
 #include <igl/Timer.h>
+#include <memory>
 
 #ifdef TETWILD_WITH_ISPC
 #include <ispc/energy.h>
@@ -42,6 +44,10 @@ public:
     std::vector<bool>& t_is_removed;
     std::vector<TetQuality>& tet_qualities;
 
+    ///shared by the copies of this object (operators and parallel workers)
+    std::shared_ptr<TetVertexSoA> vertex_soa;
+    std::shared_ptr<EnvelopeCache> envelope_cache;
+
     int energy_type;
 
     const GEO::Mesh &geo_sf_mesh;
@@ -61,11 +67,20 @@ public:
         tet_qualities(tet_qs), energy_type(e_type),
         geo_sf_mesh(geo_mesh), geo_sf_tree(geo_tree), geo_b_tree(b_t),
         args(ar), state(st)
-    { }
+    {
+        vertex_soa = std::make_shared<TetVertexSoA>();
+        vertex_soa->build(tet_vertices);
+        envelope_cache = std::make_shared<EnvelopeCache>();
+    }
 
     void check();
     void outputInfo(int op_type, double time, bool is_log = true);
 
+    ///tet_vertices[v_id].posf or one of the flags mirrored in vertex_soa has been changed
+    void syncVertex(int v_id) { vertex_soa->update(v_id, tet_vertices[v_id]); }
+    ///tet_vertices may have been changed outside of the local operations
+    void refreshVertexSoA() { vertex_soa->build(tet_vertices); }
+
     void calTetQualities(const std::vector<std::array<int, 4>>& new_tets, std::vector<TetQuality>& tet_qs, bool all_measure = false);
     void calTetQualities(const std::vector<int>& t_ids, bool all_measure = false);
 
@@ -95,13 +110,18 @@ public:
 
 //    EnvelopSide getUpperLowerBounds(const Triangle_3f& tri);
     bool isFaceOutEnvelop(const Triangle_3f& tri);
+    ///whether any of the faces is out of the envelop, the samples of the faces are queried as one packet
+    bool isFacesOutEnvelop(const std::vector<Triangle_3f>& tris);
     bool isPointOutEnvelop(const Point_3f& p);
+    ///cached in envelope_cache
     bool isFaceOutEnvelop_sampling(const Triangle_3f& tri);
+    bool isFaceOutEnvelop_sampling_uncached(const Triangle_3f& tri);
     bool isPointOutBoundaryEnvelop(const Point_3f& p);
     bool isBoundarySlide(int v1_id, int v2_id, Point_3f& pf);
 
     bool isTetOnSurface(int t_id);
     bool isTetRounded(int t_id);
+    void evaluateExactCoordinates();
     void getFaceConnTets(int v1_id, int v2_id, int v3_id, std::vector<int>& t_ids);
     bool isIsolated(int v_id);
     bool isBoundaryPoint(int v_id);
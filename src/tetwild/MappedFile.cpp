@@ -0,0 +1,62 @@
+// This file is part of TetWild, a software for generating tetrahedral meshes.
+//
+// This Source Code Form is subject to the terms of the Mozilla Public License
+// v. 2.0. If a copy of the MPL was not distributed with this file, You can
+// obtain one at http://mozilla.org/MPL/2.0/.
+//
+
+#include <tetwild/MappedFile.h>
+#include <tetwild/Exception.h>
+
+#ifdef _WIN32
+#include <fstream>
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace tetwild {
+
+MappedFile::MappedFile(const std::string& path) {
+#ifdef _WIN32
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        throw TetWildError("cannot open " + path);
+    m_buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    m_data = m_buffer.data();
+    m_size = m_buffer.size();
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw TetWildError("cannot open " + path);
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        throw TetWildError("cannot stat " + path);
+    }
+    m_size = size_t(st.st_size);
+    if (m_size > 0) {
+        void* addr = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            ::close(fd);
+            throw TetWildError("cannot map " + path);
+        }
+        //the files are read in parallel chunks, so read ahead the whole file
+        ::madvise(addr, m_size, MADV_WILLNEED);
+        m_data = static_cast<const char*>(addr);
+    }
+    ::close(fd);
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifndef _WIN32
+    if (m_data != nullptr)
+        ::munmap(const_cast<char*>(m_data), m_size);
+#endif
+}
+
+} // namespace tetwild
@@ -0,0 +1,38 @@
+// This file is part of TetWild, a software for generating tetrahedral meshes.
+//
+// This Source Code Form is subject to the terms of the Mozilla Public License
+// v. 2.0. If a copy of the MPL was not distributed with this file, You can
+// obtain one at http://mozilla.org/MPL/2.0/.
+//
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace tetwild {
+
+///
+/// @brief      { Read-only memory mapping of a whole file (read into memory on Windows). Throws a TetWildError if
+///             the file cannot be opened, without logging it: the callers decide whether it is an error. }
+///
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+private:
+    const char* m_data = nullptr;
+    size_t m_size = 0;
+#ifdef _WIN32
+    std::vector<char> m_buffer;
+#endif
+};
+
+} // namespace tetwild
@@ -12,6 +12,9 @@
 #include <tetwild/MeshConformer.h>
 #include <tetwild/Logger.h>
 #include <tetwild/Args.h>
+#include <tetwild/Parallel.h>
+#include <cstdint>
+#include <unordered_map>
 
 namespace tetwild {
 
@@ -20,165 +23,200 @@ void MeshConformer::match(const Args &args) {
     matchDivFaces(args);
 }
 
-void MeshConformer::matchVertexIndices(int x, const std::vector<std::array<int, 2>>& seed_v_list,
-                                       std::vector<int>& f_list) {
-    int seed_id;
-    int l = 0, r = seed_v_list.size() - 1;
-    while (l < r) {
-        int mid = (l + r) / 2;
-        if (seed_v_list[mid][0] < x)
-            l = mid + 1;
-        else
-            r = mid;
-    }
-    if (r >= l && seed_v_list[l][0]==x) {
-        f_list.push_back(seed_v_list[l][1]);
-        int s = l - 1;
-        while (s >= 0) {
-            if (seed_v_list[s][0] == x)
-                f_list.push_back(seed_v_list[s][1]);
-            else
-                break;
-            s--;
-        }
-        s = l + 1;
-        while (s < seed_v_list.size()) {
-            if (seed_v_list[s][0] == x)
-                f_list.push_back(seed_v_list[s][1]);
-            else
-                break;
-            s++;
-        }
-    }
+size_t MeshConformer::TriangleHash::operator()(const std::array<int, 3>& tri) const {
+    uint64_t h = (uint64_t) tri[0];
+    h = h * 0x9e3779b97f4a7c15ULL + (uint64_t) tri[1];
+    h = h * 0x9e3779b97f4a7c15ULL + (uint64_t) tri[2];
+    h ^= h >> 31;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 29;
+    return (size_t) h;
 }
 
-
 void MeshConformer::matchDivFaces(const Args &args) {
-    std::vector<std::array<int, 2>> seed_v_list;
-    seed_v_list.reserve(bsp_faces.size() * 3);
+    ///the faces of the bsp tree are still the tets faces here: index them by sorted vertex triples, and list the faces
+    ///around each vertex (counting sort, the vertices are numbered from 0)
+    const int NOT_FOUND = -1;
+    const int DUPLICATED = -2;
+    std::unordered_map<std::array<int, 3>, int, TriangleHash> faces_by_vertices;
+    faces_by_vertices.reserve(bsp_faces.size());
+    std::vector<int> conn_f_offsets(bsp_vertices.size() + 1, 0);
     for (int i = 0; i < bsp_faces.size(); i++) {
+        std::array<int, 3> tri = {{bsp_faces[i].vertices[0], bsp_faces[i].vertices[1], bsp_faces[i].vertices[2]}};
         for (int j = 0; j < 3; j++)
-            seed_v_list.push_back(std::array<int, 2>({{bsp_faces[i].vertices[j], i}}));
+            conn_f_offsets[tri[j] + 1]++;
+        std::sort(tri.begin(), tri.end());
+        auto it = faces_by_vertices.emplace(tri, i);
+        if (!it.second)
+            it.first->second = DUPLICATED;
+    }
+    for (int i = 0; i < bsp_vertices.size(); i++)
+        conn_f_offsets[i + 1] += conn_f_offsets[i];
+    std::vector<int> conn_f_ids(conn_f_offsets.back());
+    std::vector<int> conn_f_cnts(conn_f_offsets.begin(), conn_f_offsets.end() - 1);
+    for (int i = 0; i < bsp_faces.size(); i++) {
+        for (int j = 0; j < 3; j++)
+            conn_f_ids[conn_f_cnts[bsp_faces[i].vertices[j]]++] = i;
     }
-    std::sort(seed_v_list.begin(), seed_v_list.end(), [](const std::array<int, 2> &a, const std::array<int, 2> &b) {
-        return a[0] < b[0];//todo: there should be a O(n) algorithm
-    });
 
+    ///the workers only evaluate predicates on the points, triangles and planes built here: a construction from a
+    ///shared lazy exact object copies its handle, whose reference count is not thread-safe
+    std::vector<Triangle_3> m_tris, bsp_tris;
+    std::vector<Plane_3> m_plns, bsp_plns;
+    m_tris.reserve(m_faces.size());
+    m_plns.reserve(m_faces.size());
+    for (const auto& f : m_faces) {
+        m_tris.emplace_back(m_vertices[f[0]], m_vertices[f[1]], m_vertices[f[2]]);
+        m_plns.emplace_back(m_vertices[f[0]], m_vertices[f[1]], m_vertices[f[2]]);
+    }
+    bsp_tris.reserve(bsp_faces.size());
+    bsp_plns.reserve(bsp_faces.size());
+    for (const auto& f : bsp_faces) {
+        const std::vector<int>& vs = f.vertices;
+        bsp_tris.emplace_back(bsp_vertices[vs[0]], bsp_vertices[vs[1]], bsp_vertices[vs[2]]);
+        bsp_plns.emplace_back(bsp_vertices[vs[0]], bsp_vertices[vs[1]], bsp_vertices[vs[2]]);
+    }
+    int num_threads = getNumThreads(args.num_threads);
+    if (num_threads > 1) {
+        //the lazy evaluation in a predicate updates the shared representations as well, so none may happen there
+        for (auto& p : m_vertices)
+            CGAL::exact(p);
+        for (auto& p : bsp_vertices)
+            CGAL::exact(p);
+        for (int i = 0; i < m_faces.size(); i++) {
+            CGAL::exact(m_tris[i]);
+            CGAL::exact(m_plns[i]);
+        }
+        for (int i = 0; i < bsp_faces.size(); i++) {
+            CGAL::exact(bsp_tris[i]);
+            CGAL::exact(bsp_plns[i]);
+        }
+    }
+    auto bspTriangle = [&](int f_id) {
+        const std::vector<int>& vs = bsp_faces[f_id].vertices;
+        return std::array<const Point_3*, 3>({{&bsp_vertices[vs[0]], &bsp_vertices[vs[1]], &bsp_vertices[vs[2]]}});
+    };
+
+    ///the input faces are processed in parallel by batches, the div faces they give to the bsp faces and nodes are
+    ///inserted in input order afterwards, so the result does not depend on the number of threads
+    struct FaceMatch {
+        int matched_f_id;
+        std::vector<int> div_f_ids;
+        std::vector<int> cross_f_ids; //faces crossing the plane of the input face, their nodes are found serially
+    };
     const int m_faces_size = m_faces.size();
-    for (int i = 0; i < m_faces_size; i++) {
-        int m_f_id = i;
-        std::array<Point_3, 3> tri1 = {{m_vertices[m_faces[i][0]], m_vertices[m_faces[i][1]], m_vertices[m_faces[i][2]]}};
-
+    const int batch_size = 1 << 16;
+    std::vector<FaceMatch> matches;
+    for (int begin = 0; begin < m_faces_size; begin += batch_size) {
         if (args.user_callback) {
-            args.user_callback(Step::FaceMatching, double(i) / double(m_faces_size));
+            args.user_callback(Step::FaceMatching, double(begin) / double(m_faces_size));
         }
 
-        ///find seed info
-        std::unordered_set<int> seed_fids, seed_nids;
-        std::vector<std::vector<int>> f_lists;
-        is_matched[i] = true;
-        for (int j = 0; j < 3; j++) {
-            std::vector<int> f_list;
-            matchVertexIndices(m_faces[i][j], seed_v_list, f_list);
-            if (f_list.size() == 0)
-                is_matched[i] = false;
-            for (int k = 0; k < f_list.size(); k++)
-                seed_fids.insert(f_list[k]);
-            if (is_matched[i])//possibly matched
-                f_lists.push_back(f_list);
-        }
-        if (is_matched[i]) {
-            is_matched[i] = false;
-            for (int j = 0; j < f_lists.size(); j++)
-                std::sort(f_lists[j].begin(), f_lists[j].end());
-            std::vector<int> tmp, tmp1;
-            std::set_intersection(f_lists[0].begin(), f_lists[0].end(), f_lists[1].begin(), f_lists[1].end(),
-                                  std::back_inserter(tmp));
-            std::set_intersection(tmp.begin(), tmp.end(), f_lists[2].begin(), f_lists[2].end(),
-                                  std::back_inserter(tmp1));//todo: find a better way to cal intersection
-            //todo: you can use unordered_set and set a *good* hash function to find identical triangles on bsp tree
-            if (tmp1.size() == 1) {
-                std::array<int, 3> tmp_bsp = {{bsp_faces[tmp1[0]].vertices[0], bsp_faces[tmp1[0]].vertices[1],
-                                               bsp_faces[tmp1[0]].vertices[2]}};
-                std::array<int, 3> tmp_m = m_faces[i];
-                std::sort(tmp_bsp.begin(), tmp_bsp.end());
-                std::sort(tmp_m.begin(), tmp_m.end());
-                if (tmp_bsp == tmp_m) {
-                    is_matched[i] = true;
-                    bsp_faces[tmp1[0]].matched_f_id = i;
-                    continue;
-                }
-            }
-        }
-        for (auto it = seed_fids.begin(); it != seed_fids.end(); it++)
-            for (auto jt = bsp_faces[*it].conn_nodes.begin(); jt != bsp_faces[*it].conn_nodes.end(); jt++) {
-                seed_nids.insert(*jt);
+        int end = std::min(m_faces_size, begin + batch_size);
+        matches.resize(end - begin);
+        parallelFor(end - begin, num_threads, [&](int k, int thread_id) {
+            int i = begin + k;
+            FaceMatch& match = matches[k];
+            match.matched_f_id = NOT_FOUND;
+            match.div_f_ids.clear();
+            match.cross_f_ids.clear();
+
+            std::array<int, 3> tri = m_faces[i];
+            std::sort(tri.begin(), tri.end());
+            auto it = faces_by_vertices.find(tri);
+            if (it != faces_by_vertices.end() && it->second != DUPLICATED) {
+                match.matched_f_id = it->second;
+                return;
             }
 
-        for (auto it = seed_fids.begin(); it != seed_fids.end(); it++) {
-            ////cal intersection type
-            std::array<Point_3, 3> tri2 = {{bsp_vertices[bsp_faces[*it].vertices[0]],
-                                            bsp_vertices[bsp_faces[*it].vertices[1]],
-                                            bsp_vertices[bsp_faces[*it].vertices[2]]}};
-            int int_type = triangleIntersection3d(tri1, tri2, true);
-            if (int_type == COPLANAR_INT) {
-                bsp_faces[*it].div_faces.insert(i);
-            } else if (int_type == CROSS_INT) {
-                for (auto nit = bsp_faces[*it].conn_nodes.begin(); nit != bsp_faces[*it].conn_nodes.end(); nit++)
-                    bsp_nodes[*nit].div_faces.insert(i);
+            ///find seed info
+            std::array<const Point_3*, 3> tri1 = {{&m_vertices[m_faces[i][0]], &m_vertices[m_faces[i][1]],
+                                                  &m_vertices[m_faces[i][2]]}};
+            std::unordered_set<int> seed_fids, seed_nids;
+            for (int j = 0; j < 3; j++)
+                seed_fids.insert(conn_f_ids.begin() + conn_f_offsets[m_faces[i][j]],
+                                 conn_f_ids.begin() + conn_f_offsets[m_faces[i][j] + 1]);
+            for (auto it = seed_fids.begin(); it != seed_fids.end(); it++)
+                for (auto jt = bsp_faces[*it].conn_nodes.begin(); jt != bsp_faces[*it].conn_nodes.end(); jt++) {
+                    seed_nids.insert(*jt);
+                }
+
+            for (auto it = seed_fids.begin(); it != seed_fids.end(); it++) {
+                ////cal intersection type
+                int int_type = triangleIntersection3d(tri1, m_tris[i], m_plns[i],
+                                                      bspTriangle(*it), bsp_tris[*it], bsp_plns[*it], true);
+                if (int_type == COPLANAR_INT) {
+                    match.div_f_ids.push_back(*it);
+                } else if (int_type == CROSS_INT) {
+                    match.cross_f_ids.push_back(*it);
+                }
             }
-        }
 
-        ///dfs all the info
-        std::unordered_set<int> new_fids;
-        std::unordered_set<int> new_nids = seed_nids;
-        while (true) {
-            new_fids.clear();
-            for (auto it = new_nids.begin(); it != new_nids.end(); it++) {
-                for (int j = 0; j < bsp_nodes[*it].faces.size(); j++) {
-                    int bsp_f_id = bsp_nodes[*it].faces[j];
-                    auto fit = std::find(seed_fids.begin(), seed_fids.end(), bsp_f_id);
-                    if (fit == seed_fids.end()) {
-                        ///check if the plane-coplanar or plane-crossing
-                        ///check if intersecting (coplanar -> do_intersection / crossing -> sort 4 interseting points)
-                        ///if intersected -> insert into new_fids
-                        /////if coplanar-intersecting -> divface for face
-                        /////else if crossing-intersecting -> divface for node
-                        std::array<Point_3, 3> tri2 = {{bsp_vertices[bsp_faces[bsp_f_id].vertices[0]],
-                                                        bsp_vertices[bsp_faces[bsp_f_id].vertices[1]],
-                                                        bsp_vertices[bsp_faces[bsp_f_id].vertices[2]]}};
-                        int int_type = triangleIntersection3d(tri1, tri2, false);
-                        if (int_type != NONE_INT)
-                            new_fids.insert(bsp_f_id);
-
-                        if (int_type == COPLANAR_INT) {
-                            bsp_faces[bsp_f_id].div_faces.insert(i);
-                        } else if (int_type == CROSS_INT) {
-                            for (auto nit = bsp_faces[bsp_f_id].conn_nodes.begin();
-                                 nit != bsp_faces[bsp_f_id].conn_nodes.end(); nit++)
-                                bsp_nodes[*nit].div_faces.insert(i);
+            ///dfs all the info
+            std::unordered_set<int> new_fids;
+            std::unordered_set<int> new_nids = seed_nids;
+            while (true) {
+                new_fids.clear();
+                for (auto it = new_nids.begin(); it != new_nids.end(); it++) {
+                    for (int j = 0; j < bsp_nodes[*it].faces.size(); j++) {
+                        int bsp_f_id = bsp_nodes[*it].faces[j];
+                        if (seed_fids.count(bsp_f_id) == 0) {
+                            ///check if the plane-coplanar or plane-crossing
+                            ///check if intersecting (coplanar -> do_intersection / crossing -> sort 4 interseting points)
+                            ///if intersected -> insert into new_fids
+                            /////if coplanar-intersecting -> divface for face
+                            /////else if crossing-intersecting -> divface for node
+                            int int_type = triangleIntersection3d(tri1, m_tris[i], m_plns[i], bspTriangle(bsp_f_id),
+                                                                  bsp_tris[bsp_f_id], bsp_plns[bsp_f_id], false);
+                            if (int_type != NONE_INT)
+                                new_fids.insert(bsp_f_id);
+
+                            if (int_type == COPLANAR_INT) {
+                                match.div_f_ids.push_back(bsp_f_id);
+                            } else if (int_type == CROSS_INT) {
+                                match.cross_f_ids.push_back(bsp_f_id);
+                            }
                         }
                     }
                 }
-            }
 
-            if (new_fids.size() == 0)
-                break;
+                if (new_fids.size() == 0)
+                    break;
 
-            new_nids.clear();
-            for (auto it = new_fids.begin(); it != new_fids.end(); it++) {
-                for (auto jt = bsp_faces[*it].conn_nodes.begin(); jt != bsp_faces[*it].conn_nodes.end(); jt++) {
-                    auto nid = std::find(seed_nids.begin(), seed_nids.end(), *jt);
-                    if (nid == seed_nids.end()) {
-                        new_nids.insert(*jt);
+                new_nids.clear();
+                for (auto it = new_fids.begin(); it != new_fids.end(); it++) {
+                    for (auto jt = bsp_faces[*it].conn_nodes.begin(); jt != bsp_faces[*it].conn_nodes.end(); jt++) {
+                        if (seed_nids.count(*jt) == 0) {
+                            new_nids.insert(*jt);
+                        }
                     }
                 }
+                if (new_nids.size() == 0)
+                    break;
+
+                seed_fids.insert(new_fids.begin(), new_fids.end());
+                seed_nids.insert(new_nids.begin(), new_nids.end());//c++11
             }
-            if (new_nids.size() == 0)
-                break;
+        });
 
-            seed_fids.insert(new_fids.begin(), new_fids.end());
-            seed_nids.insert(new_nids.begin(), new_nids.end());//c++11
+        for (int i = begin; i < end; i++) {
+            const FaceMatch& match = matches[i - begin];
+            if (match.matched_f_id >= 0) {
+                is_matched[i] = true;
+                bsp_faces[match.matched_f_id].matched_f_id = i;
+                continue;
+            }
+            is_matched[i] = false;
+            for (int f_id : match.div_f_ids)
+                bsp_faces[f_id].div_faces.insert(i);
+            std::array<const Point_3*, 3> tri1 = {{&m_vertices[m_faces[i][0]], &m_vertices[m_faces[i][1]],
+                                                  &m_vertices[m_faces[i][2]]}};
+            for (int f_id : match.cross_f_ids) {
+                if (crossIntersection3d(tri1, m_plns[i], bspTriangle(f_id), bsp_plns[f_id]) != CROSS_INT)
+                    continue;
+                for (int n_id : bsp_faces[f_id].conn_nodes)
+                    bsp_nodes[n_id].div_faces.insert(i);
+            }
         }
     }
     logger().debug("{} faces matched!", std::count(is_matched.begin(), is_matched.end(), true));
@@ -219,10 +257,11 @@ void MeshConformer::getOrientedVertices(int bsp_f_id){
     }
 }
 
-void triangleSideofPlane(const std::array<Point_3, 3>& tri, const Plane_3& pln,
-                         std::vector<Point_3>& pos_vs, std::vector<Point_3>& neg_vs, std::vector<Point_3>& on_vs) {
+void triangleSideofPlane(const std::array<const Point_3*, 3>& tri, const Plane_3& pln,
+                         std::vector<const Point_3*>& pos_vs, std::vector<const Point_3*>& neg_vs,
+                         std::vector<const Point_3*>& on_vs) {
     for (int i = 0; i < 3; i++) {
-        CGAL::Oriented_side side = pln.oriented_side(tri[i]);
+        CGAL::Oriented_side side = pln.oriented_side(*tri[i]);
         if (side == CGAL::ON_POSITIVE_SIDE) {
             pos_vs.push_back(tri[i]);
         } else if (side == CGAL::ON_NEGATIVE_SIDE) {
@@ -233,19 +272,15 @@ void triangleSideofPlane(const std::array<Point_3, 3>& tri, const Plane_3& pln,
     }
 }
 
-int MeshConformer::triangleIntersection3d(const std::array<Point_3, 3>& tri1, const std::array<Point_3, 3>& tri2,
-                                          bool intersect_known) {
+int MeshConformer::triangleIntersection3d(const std::array<const Point_3*, 3>& tri1, const Triangle_3& t1,
+                                          const Plane_3& pln1, const std::array<const Point_3*, 3>& tri2,
+                                          const Triangle_3& t2, const Plane_3& pln2, bool intersect_known) {
     if (!intersect_known) {
-        Triangle_3 t1(tri1[0], tri1[1], tri1[2]);
-        Triangle_3 t2(tri2[0], tri2[1], tri2[2]);
         if (!do_intersect(t1, t2))
             return NONE_INT;
     }
 
-    Plane_3 pln1(tri1[0], tri1[1], tri1[2]);
-    Plane_3 pln2(tri2[0], tri2[1], tri2[2]);
-
-    std::vector<Point_3> pos_vs1, neg_vs1, on_vs1;
+    std::vector<const Point_3*> pos_vs1, neg_vs1, on_vs1;
     triangleSideofPlane(tri1, pln2, pos_vs1, neg_vs1, on_vs1);
 
     ///coplanar
@@ -275,7 +310,7 @@ int MeshConformer::triangleIntersection3d(const std::array<Point_3, 3>& tri1, co
     }
 
     ///cross
-    std::vector<Point_3> pos_vs2, neg_vs2, on_vs2;
+    std::vector<const Point_3*> pos_vs2, neg_vs2, on_vs2;
     triangleSideofPlane(tri2, pln1, pos_vs2, neg_vs2, on_vs2);
     if (pos_vs2.size() == 0 || neg_vs2.size() == 0) {
 //        if(intersect_known)
@@ -289,18 +324,34 @@ int MeshConformer::triangleIntersection3d(const std::array<Point_3, 3>& tri1, co
 //            return NONE_INT;
     }
 
+    ///the triangles cross each other's planes, crossIntersection3d() tells if they only touch at a point
+    return CROSS_INT;
+}
+
+int MeshConformer::crossIntersection3d(const std::array<const Point_3*, 3>& tri1, const Plane_3& pln1,
+                                       const std::array<const Point_3*, 3>& tri2, const Plane_3& pln2) {
+    std::vector<const Point_3*> pos_vs1, neg_vs1, on_vs1_ptrs;
+    triangleSideofPlane(tri1, pln2, pos_vs1, neg_vs1, on_vs1_ptrs);
+    std::vector<const Point_3*> pos_vs2, neg_vs2, on_vs2_ptrs;
+    triangleSideofPlane(tri2, pln1, pos_vs2, neg_vs2, on_vs2_ptrs);
+    std::vector<Point_3> on_vs1, on_vs2;
+    for (const Point_3* p : on_vs1_ptrs)
+        on_vs1.push_back(*p);
+    for (const Point_3* p : on_vs2_ptrs)
+        on_vs2.push_back(*p);
+
     std::vector<std::pair<Point_3, int>> sorted_vs;
     ///cal intersecting points for tri1
     for (int i = 0; i < pos_vs1.size(); i++) {
         for (int j = 0; j < neg_vs1.size(); j++) {
-            Segment_3 seg1(pos_vs1[i], neg_vs1[j]);
+            Segment_3 seg1(*pos_vs1[i], *neg_vs1[j]);
             auto result = intersection(seg1, pln2);
             assert(!(!result));
             if (result) {
                 if (const Point_3 *p = boost::get<Point_3>(&*result))
                     on_vs1.push_back(*p);
                 else
-                    throw TetWildError("MeshConformer::triangleIntersection3d");
+                    throw TetWildError("MeshConformer::crossIntersection3d");
             }
         }
     }
@@ -311,14 +362,14 @@ int MeshConformer::triangleIntersection3d(const std::array<Point_3, 3>& tri1, co
     ///cal intersecting points for tri2
     for (int i = 0; i < pos_vs2.size(); i++) {
         for (int j = 0; j < neg_vs2.size(); j++) {
-            Segment_3 seg2(pos_vs2[i], neg_vs2[j]);
+            Segment_3 seg2(*pos_vs2[i], *neg_vs2[j]);
             auto result = intersection(seg2, pln1);
             assert(!(!result));
             if (result) {
                 if (const Point_3 *p = boost::get<Point_3>(&*result))
                     on_vs2.push_back(*p);
                 else
-                    throw TetWildError("MeshConformer::triangleIntersection3d");
+                    throw TetWildError("MeshConformer::crossIntersection3d");
             }
         }
     }
@@ -348,6 +399,18 @@ int MeshConformer::triangleIntersection3d(const std::array<Point_3, 3>& tri1, co
 }
 
 void MeshConformer::initT(const Vector_3& nv) {
+    t = getT(nv);
+}
+
+Point_2 MeshConformer::to2d(const Point_3& p){
+    return to2d(p, t);
+}
+
+Point_3 MeshConformer::to3d(const Point_2& p, const Plane_3& pln) {
+    return to3d(p, pln, t);
+}
+
+int MeshConformer::getT(const Vector_3& nv) {
     std::vector<Vector_3> vs {Vector_3(1, 0, 0), Vector_3(0, 1, 0), Vector_3(0, 0, 1)};
     std::vector<bool> is_ppd(3, false);
 
@@ -355,17 +418,16 @@ void MeshConformer::initT(const Vector_3& nv) {
         if (nv * vs[i] == 0)
             is_ppd[i] = true;
     }
-    int i = std::find(is_ppd.begin(), is_ppd.end(), false) - is_ppd.begin();
-    t = i;
+    return std::find(is_ppd.begin(), is_ppd.end(), false) - is_ppd.begin();
 }
 
-Point_2 MeshConformer::to2d(const Point_3& p){
+Point_2 MeshConformer::to2d(const Point_3& p, int t){
     int x=(t+1)%3;
     int y=(t+2)%3;
     return Point_2(p[x], p[y]);
 }
 
-Point_3 MeshConformer::to3d(const Point_2& p, const Plane_3& pln) {
+Point_3 MeshConformer::to3d(const Point_2& p, const Plane_3& pln, int t) {
     Line_3 l;
     switch (t) {
         case 0:
@@ -34,7 +34,9 @@ public:
             m_vertices(m_vs), m_faces(m_fs), bsp_vertices(bsp_vs), bsp_edges(bsp_es), bsp_faces(bsp_fs), bsp_nodes(bsp_ns){}
 
     void match(const Args &args);
-    void matchVertexIndices(int x, const std::vector<std::array<int, 2>>& seed_v_list, std::vector<int>& f_list);
+    struct TriangleHash {
+        size_t operator()(const std::array<int, 3>& tri) const;
+    };
     void matchDivFaces(const Args &args);
     void getOrientedVertices(int bsp_f_id);
 
@@ -42,13 +44,29 @@ public:
     const int CROSS_INT=1;
     const int POINT_INT=2;
     const int NONE_INT=3;
-    int triangleIntersection3d(const std::array<Point_3, 3>& tri1, const std::array<Point_3, 3>& tri2,
+    ///
+    /// @brief      { Intersection type of two triangles given by their vertices, triangles and planes, using
+    ///             predicates only. CROSS_INT means that each triangle crosses the plane of the other one. }
+    ///
+    int triangleIntersection3d(const std::array<const Point_3*, 3>& tri1, const Triangle_3& t1, const Plane_3& pln1,
+                               const std::array<const Point_3*, 3>& tri2, const Triangle_3& t2, const Plane_3& pln2,
                                bool intersect_known=true);
+    ///
+    /// @brief      { CROSS_INT if two triangles reported as CROSS_INT above intersect along a segment, POINT_INT if
+    ///             they only touch at a point. It constructs the intersection points, so it is not thread-safe. }
+    ///
+    int crossIntersection3d(const std::array<const Point_3*, 3>& tri1, const Plane_3& pln1,
+                            const std::array<const Point_3*, 3>& tri2, const Plane_3& pln2);
 
     int t = 0;
     void initT(const Vector_3 &nv);
     Point_2 to2d(const Point_3 &p);
     Point_3 to3d(const Point_2 &p, const Plane_3 &pln);
+
+    //same as above with the projection axis passed explicitly, for concurrent callers
+    static int getT(const Vector_3 &nv);
+    static Point_2 to2d(const Point_3 &p, int t);
+    static Point_3 to3d(const Point_2 &p, const Plane_3 &pln, int t);
 };
 
 } // namespace tetwild
@@ -0,0 +1,608 @@
+// This file is part of TetWild, a software for generating tetrahedral meshes.
+//
+// This Source Code Form is subject to the terms of the Mozilla Public License
+// v. 2.0. If a copy of the MPL was not distributed with this file, You can
+// obtain one at http://mozilla.org/MPL/2.0/.
+//
+
+#include <tetwild/MeshReader.h>
+#include <tetwild/Logger.h>
+#include <tetwild/MappedFile.h>
+#include <tetwild/Parallel.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cctype>
+#include <cstring>
+#include <sstream>
+#include <type_traits>
+#include <vector>
+
+namespace tetwild {
+
+namespace {
+
+const size_t MIN_CHUNK_SIZE = 1 << 20;
+
+///
+/// @brief      { Reports a malformed file. Nothing is logged: readTriangleMesh() catches the error and lets the
+///             caller fall back to another reader. }
+///
+[[noreturn]] void parseError(const std::string& msg) {
+    throw TetWildError(msg);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// text files
+
+inline bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+///
+/// @brief      { Splits [0, size) into about 4 chunks per thread, each chunk ending after a newline (or at the end
+///             of the file) }
+///
+std::vector<size_t> splitLines(const char* data, size_t size, int num_threads) {
+    size_t num_chunks = std::max(size_t(1), std::min(size / MIN_CHUNK_SIZE, size_t(4 * getNumThreads(num_threads))));
+    std::vector<size_t> bounds(1, 0);
+    for (size_t i = 1; i < num_chunks; i++) {
+        size_t pos = std::max(bounds.back(), size * i / num_chunks);
+        const char* nl = static_cast<const char*>(std::memchr(data + pos, '\n', size - pos));
+        if (nl == nullptr)
+            break;
+        bounds.push_back(nl - data + 1);
+    }
+    if (bounds.back() != size)
+        bounds.push_back(size);
+    return bounds;
+}
+
+///
+/// @brief      { Parses a number starting at p (after blanks) with strtod/strtol, without reading past end. Returns
+///             false if there is no number. }
+///
+template<typename T>
+bool parseNumber(const char*& p, const char* end, T& x) {
+    while (p < end && isBlank(*p))
+        p++;
+    char buf[64];
+    size_t len = 0;
+    while (p + len < end && len < sizeof(buf) - 1 && !isBlank(p[len]) && p[len] != '\n' && p[len] != '/')
+        len++;
+    if (len == 0)
+        return false;
+    std::memcpy(buf, p, len);
+    buf[len] = '\0';
+    char* num_end;
+    if (std::is_floating_point<T>::value)
+        x = T(std::strtod(buf, &num_end));
+    else
+        x = T(std::strtol(buf, &num_end, 10));
+    if (num_end == buf)
+        return false;
+    p += num_end - buf;
+    return true;
+}
+
+inline const char* skipToken(const char* p, const char* end) {
+    while (p < end && !isBlank(*p) && *p != '\n')
+        p++;
+    return p;
+}
+
+inline const char* nextLine(const char* p, const char* end) {
+    const char* nl = static_cast<const char*>(std::memchr(p, '\n', end - p));
+    return nl == nullptr ? end : nl + 1;
+}
+
+inline bool startsWith(const char* p, const char* end, const char* word) {
+    size_t len = std::strlen(word);
+    return size_t(end - p) > len && std::memcmp(p, word, len) == 0 && isBlank(p[len]);
+}
+
+struct TextChunk {
+    std::vector<double> vertices; //x, y, z
+    std::vector<int> face_ids; //OBJ, one-based, or negative relative to face_num_vertices
+    std::vector<int> face_sizes;
+    std::vector<int> face_num_vertices; //number of vertices of the chunk before each face
+};
+
+///
+/// @brief      { Parses the 'v' and 'f' lines of an OBJ chunk }
+///
+void parseObjChunk(const char* p, const char* end, TextChunk& chunk) {
+    while (p < end) {
+        const char* line_end = nextLine(p, end);
+        while (p < line_end && isBlank(*p))
+            p++;
+        if (startsWith(p, line_end, "v")) {
+            p++;
+            std::array<double, 3> xyz;
+            for (int k = 0; k < 3; k++) {
+                if (!parseNumber(p, line_end, xyz[k]))
+                    parseError("cannot parse OBJ vertex: " + std::string(p, line_end));
+            }
+            chunk.vertices.insert(chunk.vertices.end(), xyz.begin(), xyz.end());
+        } else if (startsWith(p, line_end, "f")) {
+            p++;
+            int size = 0, id;
+            while (parseNumber(p, line_end, id)) {
+                if (id == 0)
+                    parseError("invalid OBJ face index: " + std::string(p, line_end));
+                chunk.face_ids.push_back(id);
+                size++;
+                p = skipToken(p, line_end); //texture and normal indices
+            }
+            chunk.face_sizes.push_back(size);
+            chunk.face_num_vertices.push_back(int(chunk.vertices.size() / 3));
+        }
+        p = line_end;
+    }
+}
+
+///
+/// @brief      { Parses the 'vertex' lines of an ascii STL chunk }
+///
+void parseAsciiStlChunk(const char* p, const char* end, TextChunk& chunk) {
+    while (p < end) {
+        const char* line_end = nextLine(p, end);
+        while (p < line_end && isBlank(*p))
+            p++;
+        if (startsWith(p, line_end, "vertex")) {
+            p += 6;
+            for (int k = 0; k < 3; k++) {
+                double x;
+                if (!parseNumber(p, line_end, x))
+                    parseError("cannot parse STL vertex: " + std::string(p, line_end));
+                chunk.vertices.push_back(x);
+            }
+        }
+        p = line_end;
+    }
+}
+
+///
+/// @brief      { Parses the chunks of a text file in parallel and concatenates their vertices }
+///
+template<typename ParseChunk>
+std::vector<TextChunk> parseText(const MappedFile& file, int num_threads, const ParseChunk& parse_chunk,
+                                 Eigen::MatrixXd& V, std::vector<int>& vertex_offsets) {
+    std::vector<size_t> bounds = splitLines(file.data(), file.size(), num_threads);
+    std::vector<TextChunk> chunks(bounds.size() - 1);
+    parallelFor(chunks.size(), num_threads, [&](int i, int thread_id) {
+        parse_chunk(file.data() + bounds[i], file.data() + bounds[i + 1], chunks[i]);
+    }, 1);
+
+    vertex_offsets.assign(chunks.size() + 1, 0);
+    for (size_t i = 0; i < chunks.size(); i++)
+        vertex_offsets[i + 1] = vertex_offsets[i] + int(chunks[i].vertices.size() / 3);
+    V.resize(vertex_offsets.back(), 3);
+    parallelFor(chunks.size(), num_threads, [&](int i, int thread_id) {
+        const std::vector<double>& vs = chunks[i].vertices;
+        for (size_t j = 0; j < vs.size() / 3; j++)
+            V.row(vertex_offsets[i] + j) << vs[3 * j], vs[3 * j + 1], vs[3 * j + 2];
+    }, 1);
+    return chunks;
+}
+
+void readObj(const MappedFile& file, Eigen::MatrixXd& V, Eigen::MatrixXi& F, int num_threads) {
+    std::vector<int> vertex_offsets;
+    std::vector<TextChunk> chunks = parseText(file, num_threads, parseObjChunk, V, vertex_offsets);
+
+    //triangles of each chunk (fans of the polygons)
+    std::vector<int> face_offsets(chunks.size() + 1, 0);
+    for (size_t i = 0; i < chunks.size(); i++) {
+        int num_triangles = 0;
+        for (int size : chunks[i].face_sizes)
+            num_triangles += std::max(0, size - 2);
+        face_offsets[i + 1] = face_offsets[i] + num_triangles;
+    }
+    F.resize(face_offsets.back(), 3);
+    const int num_vertices = int(V.rows());
+    parallelFor(chunks.size(), num_threads, [&](int i, int thread_id) {
+        const TextChunk& chunk = chunks[i];
+        auto vertexId = [&](int id, int f_id) {
+            int v_id = id > 0 ? id - 1 : vertex_offsets[i] + chunk.face_num_vertices[f_id] + id;
+            if (v_id < 0 || v_id >= num_vertices)
+                parseError("OBJ face index out of range: " + std::to_string(id));
+            return v_id;
+        };
+        int t_id = face_offsets[i];
+        size_t first = 0;
+        for (size_t f_id = 0; f_id < chunk.face_sizes.size(); f_id++) {
+            const int size = chunk.face_sizes[f_id];
+            for (int j = 1; j + 1 < size; j++, t_id++) {
+                F(t_id, 0) = vertexId(chunk.face_ids[first], f_id);
+                F(t_id, 1) = vertexId(chunk.face_ids[first + j], f_id);
+                F(t_id, 2) = vertexId(chunk.face_ids[first + j + 1], f_id);
+            }
+            first += size;
+        }
+    }, 1);
+}
+
+void readAsciiStl(const MappedFile& file, Eigen::MatrixXd& V, Eigen::MatrixXi& F, int num_threads) {
+    std::vector<int> vertex_offsets;
+    parseText(file, num_threads, parseAsciiStlChunk, V, vertex_offsets);
+    if (V.rows() % 3 != 0)
+        parseError("ascii STL: the number of vertices is not a multiple of 3");
+    F.resize(V.rows() / 3, 3);
+    parallelFor(F.rows(), num_threads, [&](int i, int thread_id) {
+        F.row(i) << 3 * i, 3 * i + 1, 3 * i + 2;
+    }, 4096);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// binary files
+
+template<typename T>
+inline T load(const char* src) {
+    T x;
+    std::memcpy(&x, src, sizeof(T));
+    return x;
+}
+
+void readBinaryStl(const MappedFile& file, Eigen::MatrixXd& V, Eigen::MatrixXi& F, int num_threads) {
+    //80 bytes of header, the number of facets, then 50 bytes per facet: normal, 3 vertices (float32), attribute
+    const int num_facets = int(load<uint32_t>(file.data() + 80));
+    V.resize(3 * num_facets, 3);
+    F.resize(num_facets, 3);
+    parallelFor(num_facets, num_threads, [&](int i, int thread_id) {
+        const char* src = file.data() + 84 + 50 * size_t(i) + 12;
+        for (int j = 0; j < 3; j++) {
+            for (int k = 0; k < 3; k++)
+                V(3 * i + j, k) = load<float>(src + 12 * j + 4 * k);
+            F(i, j) = 3 * i + j;
+        }
+    }, 4096);
+}
+
+///
+/// @brief      { Scalar type of a PLY property }
+///
+struct PlyType {
+    enum Kind { INT8, UINT8, INT16, UINT16, INT32, UINT32, FLOAT32, FLOAT64 } kind;
+    int size;
+
+    static bool parse(const std::string& name, PlyType& type) {
+        static const std::vector<std::pair<std::string, PlyType>> types = {
+            {"char", {INT8, 1}}, {"int8", {INT8, 1}}, {"uchar", {UINT8, 1}}, {"uint8", {UINT8, 1}},
+            {"short", {INT16, 2}}, {"int16", {INT16, 2}}, {"ushort", {UINT16, 2}}, {"uint16", {UINT16, 2}},
+            {"int", {INT32, 4}}, {"int32", {INT32, 4}}, {"uint", {UINT32, 4}}, {"uint32", {UINT32, 4}},
+            {"float", {FLOAT32, 4}}, {"float32", {FLOAT32, 4}}, {"double", {FLOAT64, 8}}, {"float64", {FLOAT64, 8}}};
+        for (const auto& t : types) {
+            if (t.first == name) {
+                type = t.second;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    ///
+    /// @brief      { Reads a value of this type, swapping its bytes if the file endianness is not the host one }
+    ///
+    double read(const char* src, bool swap) const {
+        char buf[8];
+        std::memcpy(buf, src, size);
+        if (swap)
+            std::reverse(buf, buf + size);
+        switch (kind) {
+            case INT8: return load<int8_t>(buf);
+            case UINT8: return load<uint8_t>(buf);
+            case INT16: return load<int16_t>(buf);
+            case UINT16: return load<uint16_t>(buf);
+            case INT32: return load<int32_t>(buf);
+            case UINT32: return load<uint32_t>(buf);
+            case FLOAT32: return load<float>(buf);
+            default: return load<double>(buf);
+        }
+    }
+};
+
+struct PlyProperty {
+    std::string name;
+    PlyType type;
+    bool is_list = false;
+    PlyType count_type;
+};
+
+struct PlyElement {
+    std::string name;
+    size_t count = 0;
+    std::vector<PlyProperty> properties;
+};
+
+///
+/// @brief      { Reads the faces of a binary PLY, starting at offset. Returns the offset of the end of the faces. }
+///
+size_t readPlyFaces(const MappedFile& file, size_t offset, const PlyElement& face, bool swap, int num_vertices,
+                    Eigen::MatrixXi& F, int num_threads) {
+    //byte size of the scalar properties before and after the list of vertex indices
+    size_t before = 0, after = 0;
+    const PlyProperty* list = nullptr;
+    for (const PlyProperty& prop : face.properties) {
+        if (prop.is_list) {
+            if (list != nullptr || (prop.name != "vertex_indices" && prop.name != "vertex_index"))
+                return 0;
+            list = &prop;
+        } else
+            (list == nullptr ? before : after) += prop.type.size;
+    }
+    if (list == nullptr)
+        return 0;
+    const size_t count_size = list->count_type.size;
+    const size_t id_size = list->type.size;
+    const int num_faces = int(face.count);
+
+    auto checkIndex = [&](double id) {
+        if (id < 0 || id >= num_vertices)
+            parseError("PLY face index out of range: " + std::to_string(id));
+        return int(id);
+    };
+
+    //fast path: all the faces are triangles, and the records have a fixed size
+    const size_t stride = before + count_size + 3 * id_size + after;
+    bool all_triangles = offset + stride * face.count <= file.size();
+    if (all_triangles) {
+        std::vector<char> is_triangle(num_faces);
+        parallelFor(num_faces, num_threads, [&](int i, int thread_id) {
+            is_triangle[i] = list->count_type.read(file.data() + offset + stride * i + before, swap) == 3;
+        }, 4096);
+        all_triangles = std::all_of(is_triangle.begin(), is_triangle.end(), [](char c) { return c != 0; });
+    }
+    if (all_triangles) {
+        F.resize(num_faces, 3);
+        parallelFor(num_faces, num_threads, [&](int i, int thread_id) {
+            const char* src = file.data() + offset + stride * i + before + count_size;
+            for (int j = 0; j < 3; j++)
+                F(i, j) = checkIndex(list->type.read(src + id_size * j, swap));
+        }, 4096);
+        return offset + stride * face.count;
+    }
+
+    //polygons, the records are walked serially
+    std::vector<std::array<int, 3>> triangles;
+    triangles.reserve(face.count);
+    for (size_t i = 0; i < face.count; i++) {
+        if (offset + before + count_size > file.size())
+            parseError("PLY file is truncated");
+        const int size = int(list->count_type.read(file.data() + offset + before, swap));
+        const char* src = file.data() + offset + before + count_size;
+        offset += before + count_size + size_t(std::max(0, size)) * id_size + after;
+        if (offset > file.size())
+            parseError("PLY file is truncated");
+        for (int j = 1; j + 1 < size; j++)
+            triangles.push_back({{checkIndex(list->type.read(src, swap)),
+                                  checkIndex(list->type.read(src + id_size * j, swap)),
+                                  checkIndex(list->type.read(src + id_size * (j + 1), swap))}});
+    }
+    F.resize(triangles.size(), 3);
+    for (size_t i = 0; i < triangles.size(); i++)
+        F.row(i) << triangles[i][0], triangles[i][1], triangles[i][2];
+    return offset;
+}
+
+///
+/// @brief      { Reads a binary PLY. Returns false for ascii files and for layouts that are not handled (lists in
+///             other elements than the faces). }
+///
+bool readBinaryPly(const MappedFile& file, Eigen::MatrixXd& V, Eigen::MatrixXi& F, int num_threads) {
+    const char* data = file.data();
+    const char* end = data + file.size();
+    const char* header_end = nullptr;
+    for (const char* p = data; p < end; p = nextLine(p, end)) {
+        if (size_t(end - p) >= 10 && std::memcmp(p, "end_header", 10) == 0
+            && (p + 10 == end || p[10] == '\n' || isBlank(p[10]))) {
+            header_end = nextLine(p, end);
+            break;
+        }
+    }
+    if (header_end == nullptr)
+        parseError("PLY file without end_header");
+
+    //header
+    bool is_little_endian = true;
+    std::vector<PlyElement> elements;
+    std::istringstream header(std::string(data, header_end));
+    std::string line;
+    while (std::getline(header, line)) {
+        std::istringstream words(line);
+        std::string keyword;
+        words >> keyword;
+        if (keyword == "format") {
+            std::string format;
+            words >> format;
+            if (format == "ascii")
+                return false;
+            is_little_endian = format == "binary_little_endian";
+        } else if (keyword == "element") {
+            elements.emplace_back();
+            words >> elements.back().name >> elements.back().count;
+        } else if (keyword == "property") {
+            if (elements.empty())
+                parseError("PLY property outside of an element");
+            PlyProperty prop;
+            std::string type;
+            words >> type;
+            if (type == "list") {
+                std::string count_type;
+                words >> count_type >> type;
+                prop.is_list = true;
+                if (!PlyType::parse(count_type, prop.count_type))
+                    parseError("unknown PLY type: " + count_type);
+            }
+            if (!PlyType::parse(type, prop.type))
+                parseError("unknown PLY type: " + type);
+            words >> prop.name;
+            elements.back().properties.push_back(prop);
+        }
+    }
+    const uint16_t one = 1;
+    const bool is_host_little_endian = *reinterpret_cast<const char*>(&one) == 1;
+    const bool swap = is_little_endian != is_host_little_endian;
+
+    //elements
+    size_t offset = header_end - data;
+    bool has_vertices = false;
+    for (const PlyElement& element : elements) {
+        if (element.name == "face") {
+            if (!has_vertices)
+                return false;
+            offset = readPlyFaces(file, offset, element, swap, int(V.rows()), F, num_threads);
+            if (offset == 0)
+                return false;
+            continue;
+        }
+        size_t stride = 0;
+        std::array<int, 3> xyz_offsets = {{-1, -1, -1}};
+        std::array<PlyType, 3> xyz_types;
+        for (const PlyProperty& prop : element.properties) {
+            if (prop.is_list)
+                return false;
+            for (int k = 0; k < 3; k++) {
+                if (prop.name == std::string(1, char('x' + k))) {
+                    xyz_offsets[k] = int(stride);
+                    xyz_types[k] = prop.type;
+                }
+            }
+            stride += prop.type.size;
+        }
+        if (offset + stride * element.count > file.size())
+            parseError("PLY file is truncated");
+        if (element.name == "vertex") {
+            if (*std::min_element(xyz_offsets.begin(), xyz_offsets.end()) < 0)
+                parseError("PLY vertices without x, y or z");
+            V.resize(element.count, 3);
+            parallelFor(int(element.count), num_threads, [&](int i, int thread_id) {
+                const char* src = data + offset + stride * i;
+                for (int k = 0; k < 3; k++)
+                    V(i, k) = xyz_types[k].read(src + xyz_offsets[k], swap);
+            }, 4096);
+            has_vertices = true;
+        }
+        offset += stride * element.count;
+    }
+    return has_vertices;
+}
+
+///
+/// @brief      { Lowercase extension of a file, with the dot }
+///
+std::string extension(const std::string& path) {
+    size_t dot = path.find_last_of('.');
+    std::string ext = dot == std::string::npos ? "" : path.substr(dot);
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return char(std::tolower(c)); });
+    return ext;
+}
+
+bool readMesh(const std::string& path, Eigen::MatrixXd& V, Eigen::MatrixXi& F, int num_threads) {
+    const std::string ext = extension(path);
+    if (ext == ".obj") {
+        MappedFile file(path);
+        readObj(file, V, F, num_threads);
+        return true;
+    }
+    if (ext == ".stl") {
+        MappedFile file(path);
+        if (file.size() >= 84 && file.size() == 84 + 50 * size_t(load<uint32_t>(file.data() + 80)))
+            readBinaryStl(file, V, F, num_threads);
+        else if (file.size() >= 5 && std::memcmp(file.data(), "solid", 5) == 0)
+            readAsciiStl(file, V, F, num_threads);
+        else
+            return false;
+        return true;
+    }
+    if (ext == ".ply") {
+        MappedFile file(path);
+        if (file.size() < 3 || std::memcmp(file.data(), "ply", 3) != 0)
+            parseError("not a PLY file: " + path);
+        return readBinaryPly(file, V, F, num_threads);
+    }
+    return false;
+}
+
+} // anonymous namespace
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool readTriangleMesh(const std::string& path, Eigen::MatrixXd& V, Eigen::MatrixXi& F, int num_threads) {
+    V.resize(0, 3);
+    F.resize(0, 3);
+    bool is_read = false;
+    try {
+        is_read = readMesh(path, V, F, num_threads);
+    } catch (const TetWildError& e) {
+        logger().warn("cannot parse {}: {}", path, e.what());
+    }
+    if (!is_read) {
+        V.resize(0, 3);
+        F.resize(0, 3);
+    }
+    return is_read;
+}
+
+void weldVertices(const Eigen::MatrixXd& V, const Eigen::MatrixXi& F, double eps,
+                  Eigen::MatrixXd& VO, Eigen::MatrixXi& FO, int num_threads) {
+    const int num_vertices = int(V.rows());
+
+    //grid cells
+    std::vector<std::array<double, 3>> cells(num_vertices);
+    parallelFor(num_vertices, num_threads, [&](int i, int thread_id) {
+        for (int k = 0; k < 3; k++)
+            cells[i][k] = std::round(V(i, k) / eps);
+    }, 4096);
+
+    //slabs along x, bounded by sampled cells, so that the slabs are ordered and the equal cells are in the same slab
+    const int num_slabs = std::max(1, std::min(num_vertices / 4096, 4 * getNumThreads(num_threads)));
+    std::vector<double> splitters;
+    if (num_slabs > 1) {
+        const int num_samples = 64 * num_slabs;
+        std::vector<double> samples(num_samples);
+        for (int i = 0; i < num_samples; i++)
+            samples[i] = cells[size_t(i) * num_vertices / num_samples][0];
+        std::sort(samples.begin(), samples.end());
+        for (int s = 1; s < num_slabs; s++)
+            splitters.push_back(samples[s * 64]);
+        splitters.erase(std::unique(splitters.begin(), splitters.end()), splitters.end());
+    }
+    std::vector<std::vector<int>> slabs(splitters.size() + 1);
+    for (int i = 0; i < num_vertices; i++)
+        slabs[std::upper_bound(splitters.begin(), splitters.end(), cells[i][0]) - splitters.begin()].push_back(i);
+
+    //sort the slabs and number the distinct cells (the first vertex of each cell represents it)
+    std::vector<int> old_2_new(num_vertices);
+    std::vector<std::vector<int>> representatives(slabs.size());
+    parallelFor(slabs.size(), num_threads, [&](int s, int thread_id) {
+        std::vector<int>& slab = slabs[s];
+        std::sort(slab.begin(), slab.end(), [&](int a, int b) {
+            return cells[a] < cells[b] || (cells[a] == cells[b] && a < b);
+        });
+        for (size_t j = 0; j < slab.size(); j++) {
+            if (j == 0 || cells[slab[j]] != cells[slab[j - 1]])
+                representatives[s].push_back(slab[j]);
+            old_2_new[slab[j]] = int(representatives[s].size()) - 1;
+        }
+    }, 1);
+    std::vector<int> slab_offsets(slabs.size() + 1, 0);
+    for (size_t s = 0; s < slabs.size(); s++)
+        slab_offsets[s + 1] = slab_offsets[s] + int(representatives[s].size());
+
+    VO.resize(slab_offsets.back(), 3);
+    parallelFor(slabs.size(), num_threads, [&](int s, int thread_id) {
+        for (int v_id : slabs[s])
+            old_2_new[v_id] += slab_offsets[s];
+        for (size_t j = 0; j < representatives[s].size(); j++)
+            VO.row(slab_offsets[s] + j) = V.row(representatives[s][j]);
+    }, 1);
+    FO.resize(F.rows(), F.cols());
+    parallelFor(int(F.rows()), num_threads, [&](int i, int thread_id) {
+        for (int j = 0; j < F.cols(); j++)
+            FO(i, j) = old_2_new[F(i, j)];
+    }, 4096);
+}
+
+} // namespace tetwild
@@ -0,0 +1,49 @@
+// This file is part of TetWild, a software for generating tetrahedral meshes.
+//
+// This Source Code Form is subject to the terms of the Mozilla Public License
+// v. 2.0. If a copy of the MPL was not distributed with this file, You can
+// obtain one at http://mozilla.org/MPL/2.0/.
+//
+
+#pragma once
+
+#include <Eigen/Dense>
+#include <string>
+
+namespace tetwild {
+
+///
+/// @brief      { Reads a triangle mesh from a .stl (binary or ascii), .obj or binary .ply file. The file is memory
+///             mapped and parsed in parallel: the binary records are decoded directly at their offsets, and the text
+///             files are cut into chunks at line boundaries, parsed independently, and concatenated in order.
+///             Polygons are triangulated as fans, as in igl::read_triangle_mesh(). The vertices of an .stl file are
+///             not merged (three per facet). }
+///
+/// @param[in]  path         { Input file }
+/// @param[out] V            { #V x 3 vertices }
+/// @param[out] F            { #F x 3 triangles }
+/// @param[in]  num_threads  { Number of threads (see getNumThreads()) }
+///
+/// @return     { False if the format is not handled (other extensions, ascii .ply) or the file cannot be parsed, in
+///             which case V and F are empty and the caller should fall back to another reader. }
+///
+bool readTriangleMesh(const std::string& path, Eigen::MatrixXd& V, Eigen::MatrixXi& F, int num_threads);
+
+///
+/// @brief      { Merges the vertices that fall into the same cell of a grid of spacing eps (the coordinates rounded
+///             to multiples of eps), like igl::remove_duplicate_vertices(). The cells are distributed into slabs
+///             along x, which are sorted in parallel. The merged vertices are ordered lexicographically by cell, and
+///             each cell keeps its first vertex, so the groups of merged vertices match igl's but the representative
+///             coordinates may differ within a cell. }
+///
+/// @param[in]  V            { #V x 3 vertices }
+/// @param[in]  F            { #F x 3 triangles }
+/// @param[in]  eps          { Grid spacing }
+/// @param[out] VO           { #VO x 3 merged vertices }
+/// @param[out] FO           { #F x 3 triangles indexing VO }
+/// @param[in]  num_threads  { Number of threads (see getNumThreads()) }
+///
+void weldVertices(const Eigen::MatrixXd& V, const Eigen::MatrixXi& F, double eps,
+                  Eigen::MatrixXd& VO, Eigen::MatrixXi& FO, int num_threads);
+
+} // namespace tetwild
@@ -12,14 +12,17 @@
 #include <tetwild/MeshRefinement.h>
 #include <tetwild/Common.h>
 #include <tetwild/Args.h>
+#include <tetwild/Checkpoint.h>
 #include <tetwild/Logger.h>
 #include <tetwild/Serialization.h>
+#include <tetwild/Trace.h>
 #include <tetwild/EdgeCollapser.h>
 #include <tetwild/EdgeSplitter.h>
 #include <tetwild/EdgeRemover.h>
 #include <tetwild/VertexSmoother.h>
 #include <tetwild/Quality.h>
 #include <tetwild/Utils.h>
+#include <tetwild/WindingNumber.h>
 #include <tetwild/DisableWarnings.h>
 #include <tetwild/geogram/MeshAABB.h>
 #include <CGAL/centroid.h>
@@ -28,11 +31,49 @@
 #include <pymesh/MshSaver.h>
 #include <geogram/mesh/mesh_AABB.h>
 #include <geogram/points/kd_tree.h>
-#include <igl/winding_number.h>
 #include <igl/write_triangle_mesh.h>
 
 namespace tetwild {
 
+namespace {
+
+///
+/// @brief      { Trace span of a local operation, with its numbers of attempts, successes, and candidates rejected by
+///             the inversion and envelope checks. The rejects are also added to the counter tracks of the trace. }
+///
+class OperationSpan {
+public:
+    explicit OperationSpan(const char* name) : m_span(name, "operation"), m_name(name) {
+        if (trace::isEnabled()) {
+            m_flip_rejects = trace::total(trace::FLIP_REJECTS);
+            m_envelope_rejects = trace::total(trace::ENVELOPE_REJECTS);
+        }
+    }
+
+    void finish(const LocalOperations& op) {
+        if (!trace::isEnabled())
+            return;
+        const double flip_rejects = double(trace::total(trace::FLIP_REJECTS) - m_flip_rejects);
+        const double envelope_rejects = double(trace::total(trace::ENVELOPE_REJECTS) - m_envelope_rejects);
+        m_span.addArg("attempts", op.counter);
+        m_span.addArg("successes", op.suc_counter);
+        m_span.addArg("flip_rejects", flip_rejects);
+        m_span.addArg("envelope_rejects", envelope_rejects);
+        trace::counterEvent("attempts", m_name, op.counter);
+        trace::counterEvent("successes", m_name, op.suc_counter);
+        trace::counterEvent("flip_rejects", m_name, flip_rejects);
+        trace::counterEvent("envelope_rejects", m_name, envelope_rejects);
+    }
+
+private:
+    trace::Span m_span;
+    const char* m_name;
+    int64_t m_flip_rejects = 0;
+    int64_t m_envelope_rejects = 0;
+};
+
+} // anonymous namespace
+
 void MeshRefinement::prepareData(bool is_init) {
     igl_timer.start();
     if (is_init) {
@@ -48,7 +89,7 @@ void MeshRefinement::prepareData(bool is_init) {
 
     GEO::Mesh simple_mesh;
     getSimpleMesh(simple_mesh);
-    GEO::MeshFacetsAABBWithEps simple_tree(simple_mesh);
+    GEO::MeshFacetsAABBWithEps simple_tree(simple_mesh, true, args.use_wide_bvh);
     LocalOperations localOperation(tet_vertices, tets, is_surface_fs, v_is_removed, t_is_removed, tet_qualities,
                                    state.ENERGY_AMIPS, simple_mesh, simple_tree, simple_tree, args, state);
     localOperation.calTetQualities(tets, tet_qualities, true);//cal all measure
@@ -71,7 +112,7 @@ bool MeshRefinement::round() {
             continue;
         }
         tet_vertices[i].is_rounded = true;
-        Point_3 old_p = tet_vertices[i].pos;
+        HybridPoint_3 old_p = tet_vertices[i].pos;
         tet_vertices[i].pos = Point_3(tet_vertices[i].posf[0], tet_vertices[i].posf[1], tet_vertices[i].posf[2]);
 
         for (auto it = tet_vertices[i].conn_tets.begin(); it != tet_vertices[i].conn_tets.end(); it++) {
@@ -86,8 +127,8 @@ bool MeshRefinement::round() {
 //                ori = CGAL::orientation(tet_vertices[tets[*it][0]].posf, tet_vertices[tets[*it][1]].posf,
 //                                        tet_vertices[tets[*it][2]].posf, tet_vertices[tets[*it][3]].posf);
 //            else
-                ori = CGAL::orientation(tet_vertices[tets[*it][0]].pos, tet_vertices[tets[*it][1]].pos,
-                                        tet_vertices[tets[*it][2]].pos, tet_vertices[tets[*it][3]].pos);
+                ori = orientation(tet_vertices[tets[*it][0]].pos, tet_vertices[tets[*it][1]].pos,
+                                  tet_vertices[tets[*it][2]].pos, tet_vertices[tets[*it][3]].pos);
 
             if (ori != CGAL::POSITIVE) {
                 tet_vertices[i].is_rounded = false;
@@ -128,6 +169,7 @@ void MeshRefinement::clear() {
 
 int MeshRefinement::doOperations(EdgeSplitter& splitter, EdgeCollapser& collapser, EdgeRemover& edge_remover,
                                  VertexSmoother& smoother, const std::array<bool, 4>& ops){
+    trace::Span pass_span("pass", "pass");
     int cnt0=0;
     for(int i=0;i<tet_vertices.size();i++){
         if(v_is_removed[i] || tet_vertices[i].is_locked || tet_vertices[i].is_rounded)
@@ -140,8 +182,10 @@ int MeshRefinement::doOperations(EdgeSplitter& splitter, EdgeCollapser& collapse
     if (ops[0]) {
         igl_timer.start();
         logger().info("edge splitting...");
+        OperationSpan op_span("split");
         splitter.init();
         splitter.split();
+        op_span.finish(splitter);
         tmp_time = igl_timer.getElapsedTime();
         splitter.outputInfo(MeshRecord::OpType::OP_SPLIT, tmp_time, is_log);
         logger().info("edge splitting done!");
@@ -151,8 +195,10 @@ int MeshRefinement::doOperations(EdgeSplitter& splitter, EdgeCollapser& collapse
     if (ops[1]) {
         igl_timer.start();
         logger().info("edge collapsing...");
+        OperationSpan op_span("collapse");
         collapser.init();
         collapser.collapse();
+        op_span.finish(collapser);
         tmp_time = igl_timer.getElapsedTime();
         collapser.outputInfo(MeshRecord::OpType::OP_COLLAPSE, tmp_time, is_log);
         logger().info("edge collapsing done!");
@@ -162,8 +208,10 @@ int MeshRefinement::doOperations(EdgeSplitter& splitter, EdgeCollapser& collapse
     if (ops[2]) {
         igl_timer.start();
         logger().info("edge removal...");
+        OperationSpan op_span("swap");
         edge_remover.init();
         edge_remover.swap();
+        op_span.finish(edge_remover);
         tmp_time = igl_timer.getElapsedTime();
         edge_remover.outputInfo(MeshRecord::OpType::OP_SWAP, tmp_time, is_log);
         logger().info("edge removal done!");
@@ -173,7 +221,9 @@ int MeshRefinement::doOperations(EdgeSplitter& splitter, EdgeCollapser& collapse
     if (ops[3]) {
         igl_timer.start();
         logger().info("vertex smoothing...");
+        OperationSpan op_span("smooth");
         smoother.smooth();
+        op_span.finish(smoother);
         tmp_time = igl_timer.getElapsedTime();
         smoother.outputInfo(MeshRecord::OpType::OP_SMOOTH, tmp_time, is_log);
         logger().info("vertex smoothing done!");
@@ -216,11 +266,12 @@ int MeshRefinement::doOperationLoops(EdgeSplitter& splitter, EdgeCollapser& coll
 
 void MeshRefinement::refine(int energy_type, const std::array<bool, 4>& ops, bool is_pre, bool is_post, int scalar_update)
 {
-    GEO::MeshFacetsAABBWithEps geo_sf_tree(geo_sf_mesh);
+    trace::Span span("refine", "stage");
+    GEO::MeshFacetsAABBWithEps geo_sf_tree(geo_sf_mesh, true, args.use_wide_bvh);
     if (geo_b_mesh.vertices.nb() == 0) {
         getSimpleMesh(geo_b_mesh);//for constructing aabb tree, the mesh cannot be empty
     }
-    GEO::MeshFacetsAABBWithEps geo_b_tree(geo_b_mesh);
+    GEO::MeshFacetsAABBWithEps geo_b_tree(geo_b_mesh, true, args.use_wide_bvh);
 
     min_adaptive_scale = (state.bbox_diag / 1000) / state.initial_edge_len; // set min_edge_length to diag / 1000 would be better
 
@@ -625,7 +676,7 @@ void MeshRefinement::markInOut(std::vector<bool>& tmp_t_is_removed){
     getSurface(V, F);
     Eigen::VectorXd W;
     logger().debug("winding number...");
-    igl::winding_number(V, F, C, W);
+    WindingNumber(V, F).evaluate(C, W, args.num_threads);
     logger().debug("winding number done");
 
     cnt = 0;
@@ -999,10 +1050,10 @@ void MeshRefinement::check() {
         if (t_is_removed[i])
             continue;
 
-        CGAL::Orientation ori = CGAL::orientation(tet_vertices[tets[i][0]].pos,
-                                                  tet_vertices[tets[i][1]].pos,
-                                                  tet_vertices[tets[i][2]].pos,
-                                                  tet_vertices[tets[i][3]].pos);
+        CGAL::Orientation ori = orientation(tet_vertices[tets[i][0]].pos,
+                                            tet_vertices[tets[i][1]].pos,
+                                            tet_vertices[tets[i][2]].pos,
+                                            tet_vertices[tets[i][3]].pos);
 
         if (ori == CGAL::COPLANAR) {
             logger().debug("tet {} is degenerate!", i);
@@ -1034,7 +1085,7 @@ void MeshRefinement::check() {
     tet_faces.erase(std::unique(tet_faces.begin(), tet_faces.end()), tet_faces.end());
 
     for (int i = 0; i < tet_faces.size(); i++) {
-        std::unordered_set<int> tmp;
+        VertexSet tmp;
         setIntersection(tet_vertices[tet_faces[i][0]].conn_tets, tet_vertices[tet_faces[i][1]].conn_tets, tmp);
         setIntersection(tet_vertices[tet_faces[i][2]].conn_tets, tmp, tmp);
 
@@ -1067,7 +1118,7 @@ void MeshRefinement::outputMidResult(bool is_with_bbox, double id) {
         getSurface(V, F);
         Eigen::VectorXd W;
         logger().debug("winding number...");
-        igl::winding_number(V, F, C, W);
+        WindingNumber(V, F).evaluate(C, W, args.num_threads);
         logger().debug("winding number done");
 
         cnt = 0;
@@ -1151,8 +1202,8 @@ void MeshRefinement::getSurface(Eigen::MatrixXd& V, Eigen::MatrixXi& F){
         for (int j = 0; j < 4; j++) {
             if (is_surface_fs[i][j] != state.NOT_SURFACE && is_surface_fs[i][j] > 0) {//outside
                 std::array<int, 3> v_ids = {{tets[i][(j + 1) % 4], tets[i][(j + 2) % 4], tets[i][(j + 3) % 4]}};
-                if (CGAL::orientation(tet_vertices[v_ids[0]].pos, tet_vertices[v_ids[1]].pos,
-                                      tet_vertices[v_ids[2]].pos, tet_vertices[tets[i][j]].pos) != CGAL::POSITIVE) {
+                if (orientation(tet_vertices[v_ids[0]].pos, tet_vertices[v_ids[1]].pos,
+                                tet_vertices[v_ids[2]].pos, tet_vertices[tets[i][j]].pos) != CGAL::POSITIVE) {
                     int tmp = v_ids[0];
                     v_ids[0] = v_ids[2];
                     v_ids[2] = tmp;
@@ -1191,8 +1242,8 @@ void MeshRefinement::getTrackedSurface(Eigen::MatrixXd& V, Eigen::MatrixXi& F) {
         for (int j = 0; j < 4; j++) {
             if (is_surface_fs[i][j] != state.NOT_SURFACE && is_surface_fs[i][j] >= 0) {//outside
                 std::array<int, 3> v_ids = {{tets[i][(j + 1) % 4], tets[i][(j + 2) % 4], tets[i][(j + 3) % 4]}};
-                if (CGAL::orientation(tet_vertices[v_ids[0]].pos, tet_vertices[v_ids[1]].pos,
-                                      tet_vertices[v_ids[2]].pos, tet_vertices[tets[i][j]].pos) != CGAL::POSITIVE) {
+                if (orientation(tet_vertices[v_ids[0]].pos, tet_vertices[v_ids[1]].pos,
+                                tet_vertices[v_ids[2]].pos, tet_vertices[tets[i][j]].pos) != CGAL::POSITIVE) {
                     int tmp = v_ids[0];
                     v_ids[0] = v_ids[2];
                     v_ids[2] = tmp;
@@ -1332,17 +1383,22 @@ bool MeshRefinement::deserialization(const Eigen::MatrixXd& V_in, const Eigen::M
     state.is_mesh_closed = (geo_b_mesh.vertices.nb() == 0);
 
     //deserialization
-    igl::deserialize(state.bbox_diag, "bbox_diag", slz_file);
-    igl::deserialize(state.eps, "eps", slz_file);
-    igl::deserialize(state.eps_2, "eps_2", slz_file);
-    igl::deserialize(state.sampling_dist, "sampling_dist", slz_file);
-    igl::deserialize(state.initial_edge_len, "initial_edge_len", slz_file);
-    // igl::deserialize(state.NOT_SURFACE, "NOT_SURFACE", slz_file);
-    igl::deserialize(old_pass, "old_pass", slz_file);
-
-    igl::deserialize(tet_vertices, "tet_vertices", slz_file);
-    igl::deserialize(tets, "tets", slz_file);
-    igl::deserialize(is_surface_fs, "is_surface_fs", slz_file);
+    if (checkpoint::isCheckpoint(slz_file))
+        checkpoint::load(slz_file, state, old_pass, tet_vertices, tets, is_surface_fs);
+    else {
+        //checkpoint written with igl::serialize
+        igl::deserialize(state.bbox_diag, "bbox_diag", slz_file);
+        igl::deserialize(state.eps, "eps", slz_file);
+        igl::deserialize(state.eps_2, "eps_2", slz_file);
+        igl::deserialize(state.sampling_dist, "sampling_dist", slz_file);
+        igl::deserialize(state.initial_edge_len, "initial_edge_len", slz_file);
+        // igl::deserialize(state.NOT_SURFACE, "NOT_SURFACE", slz_file);
+        igl::deserialize(old_pass, "old_pass", slz_file);
+
+        igl::deserialize(tet_vertices, "tet_vertices", slz_file);
+        igl::deserialize(tets, "tets", slz_file);
+        igl::deserialize(is_surface_fs, "is_surface_fs", slz_file);
+    }
 
     t_is_removed = std::vector<bool>(tets.size(), false);
     v_is_removed = std::vector<bool>(tet_vertices.size(), false);
@@ -1365,59 +1421,7 @@ bool MeshRefinement::deserialization(const Eigen::MatrixXd& V_in, const Eigen::M
 
 void MeshRefinement::serialization(const std::string& slz_file) {
     logger().debug("serializing ...");
-    igl::serialize(state.bbox_diag, "bbox_diag", slz_file, true);
-    igl::serialize(state.eps, "eps", slz_file);
-    igl::serialize(state.eps_2, "eps_2", slz_file);
-    igl::serialize(state.sampling_dist, "sampling_dist", slz_file);
-    igl::serialize(state.initial_edge_len, "initial_edge_len", slz_file);
-    // igl::serialize(state.NOT_SURFACE, "NOT_SURFACE", slz_file);
-    igl::serialize(old_pass, "old_pass", slz_file);
-
-    //relabel
-    std::vector<int> new_v_ids(tet_vertices.size(), -1);
-    int cnt = 0;
-    for (int i = 0; i < tet_vertices.size(); i++) {
-        if (v_is_removed[i])
-            continue;
-        new_v_ids[i] = cnt++;
-    }
-
-    // serialize
-    std::vector <TetVertex> slz_tet_vertices;
-    slz_tet_vertices.reserve(std::count(v_is_removed.begin(), v_is_removed.end(), false));
-    for (int i = 0; i < tet_vertices.size(); i++) {
-        if (v_is_removed[i])
-            continue;
-        slz_tet_vertices.push_back(tet_vertices[i]);
-        slz_tet_vertices.back().conn_tets.clear();
-        slz_tet_vertices.back().on_face.clear();
-        slz_tet_vertices.back().on_edge.clear();
-    }
-    igl::serialize(slz_tet_vertices, "tet_vertices", slz_file);
-    slz_tet_vertices.clear();
-
-    std::vector <std::array<int, 4>> slz_tets;
-    slz_tets.reserve(std::count(t_is_removed.begin(), t_is_removed.end(), false));
-    for (int i = 0; i < tets.size(); i++) {
-        if (t_is_removed[i])
-            continue;
-        slz_tets.push_back(tets[i]);
-        for (int j = 0; j < 4; j++)
-            slz_tets.back()[j] = new_v_ids[tets[i][j]];
-    }
-    igl::serialize(slz_tets, "tets", slz_file);
-    slz_tets.clear();
-
-    std::vector<std::array<int, 4>> slz_is_surface_fs;
-    slz_is_surface_fs.reserve(std::count(t_is_removed.begin(), t_is_removed.end(), false));
-    for (int i = 0; i < is_surface_fs.size(); i++) {
-        if (t_is_removed[i])
-            continue;
-        slz_is_surface_fs.push_back(is_surface_fs[i]);
-    }
-    igl::serialize(slz_is_surface_fs, "is_surface_fs", slz_file);
-    slz_is_surface_fs.clear();
-
+    checkpoint::save(slz_file, state, old_pass, tet_vertices, tets, is_surface_fs, v_is_removed, t_is_removed);
     logger().debug("serialization done");
 }
 
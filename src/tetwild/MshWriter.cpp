@@ -0,0 +1,115 @@
+// This file is part of TetWild, a software for generating tetrahedral meshes.
+//
+// This Source Code Form is subject to the terms of the Mozilla Public License
+// v. 2.0. If a copy of the MPL was not distributed with this file, You can
+// obtain one at http://mozilla.org/MPL/2.0/.
+//
+
+#include <tetwild/MshWriter.h>
+#include <tetwild/Logger.h>
+#include <tetwild/Parallel.h>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace tetwild {
+
+namespace {
+
+const int MSH_TET = 4;
+const size_t RECORDS_PER_BLOCK = 1 << 16;
+
+///
+/// @brief      { Encodes num records of record_size bytes with encode(i, dst), by blocks of RECORDS_PER_BLOCK records
+///             encoded in parallel, and writes them in order. A few blocks per thread are kept in memory at once. }
+///
+template<typename Encode>
+void writeRecords(std::ofstream &out, size_t num, size_t record_size, int num_threads, const Encode &encode) {
+    const size_t num_blocks = (num + RECORDS_PER_BLOCK - 1) / RECORDS_PER_BLOCK;
+    const size_t blocks_per_batch = 4 * getNumThreads(num_threads);
+    std::vector<std::vector<char>> buffers(std::min(blocks_per_batch, num_blocks));
+    for (size_t b0 = 0; b0 < num_blocks; b0 += blocks_per_batch) {
+        const size_t num_batch_blocks = std::min(blocks_per_batch, num_blocks - b0);
+        parallelFor(int(num_batch_blocks), num_threads, [&](int i, int thread_id) {
+            size_t begin = (b0 + i) * RECORDS_PER_BLOCK;
+            size_t end = std::min(num, begin + RECORDS_PER_BLOCK);
+            buffers[i].resize((end - begin) * record_size);
+            char *dst = buffers[i].data();
+            for (size_t r = begin; r < end; r++, dst += record_size)
+                encode(r, dst);
+        }, 1);
+        for (size_t i = 0; i < num_batch_blocks; i++)
+            out.write(buffers[i].data(), buffers[i].size());
+    }
+}
+
+template<typename T>
+inline void put(char *&dst, T x) {
+    std::memcpy(dst, &x, sizeof(T));
+    dst += sizeof(T);
+}
+
+} // anonymous namespace
+
+void writeMsh(const std::string &path, const Eigen::MatrixXd &V, const Eigen::MatrixXi &T,
+              const Eigen::VectorXd &A, const std::string &field_name, int num_threads) {
+    if (A.size() != T.rows())
+        log_and_throw("writeMsh: the element field must have one value per tet");
+
+    std::ofstream out(path, std::ios::binary);
+    if (!out)
+        log_and_throw("Error opening " + path + " to write msh file.");
+
+    out << "$MeshFormat\n";
+    out << "2.2 1 " << sizeof(double) << "\n";
+    int32_t one = 1;
+    out.write((const char *) &one, sizeof(int32_t));
+    out << "$EndMeshFormat\n";
+
+    ///nodes: index, x, y, z
+    out << "$Nodes\n";
+    out << V.rows() << "\n";
+    writeRecords(out, V.rows(), sizeof(int32_t) + 3 * sizeof(double), num_threads, [&](size_t i, char *dst) {
+        put<int32_t>(dst, int32_t(i + 1));
+        for (int j = 0; j < 3; j++)
+            put<double>(dst, V(i, j));
+    });
+    out << "$EndNodes\n";
+
+    ///elements: one block of tets without tags, then index and vertices
+    out << "$Elements\n";
+    out << T.rows() << "\n";
+    if (T.rows() > 0) {
+        int32_t header[3] = {MSH_TET, int32_t(T.rows()), 0};
+        out.write((const char *) header, sizeof(header));
+        writeRecords(out, T.rows(), 5 * sizeof(int32_t), num_threads, [&](size_t i, char *dst) {
+            put<int32_t>(dst, int32_t(i + 1));
+            for (int j = 0; j < 4; j++)
+                put<int32_t>(dst, T(i, j) + 1);
+        });
+    }
+    out << "$EndElements\n";
+
+    ///element field: index and value
+    out << "$ElementData\n";
+    out << 1 << "\n"; //num string tags
+    out << "\"" << field_name << "\"\n";
+    out << "1\n"; //num real tags
+    out << "0.0\n"; //time value
+    out << "3\n"; //num int tags
+    out << "0\n"; //time step
+    out << "1\n"; //1-component scalar field
+    out << T.rows() << "\n";
+    writeRecords(out, T.rows(), sizeof(int32_t) + sizeof(double), num_threads, [&](size_t i, char *dst) {
+        put<int32_t>(dst, int32_t(i + 1));
+        put<double>(dst, A(i));
+    });
+    out << "$EndElementData\n";
+
+    out.close();
+    if (out.fail())
+        log_and_throw("Error writing " + path);
+}
+
+} // namespace tetwild
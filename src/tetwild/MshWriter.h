@@ -0,0 +1,30 @@
+// This file is part of TetWild, a software for generating tetrahedral meshes.
+//
+// This Source Code Form is subject to the terms of the Mozilla Public License
+// v. 2.0. If a copy of the MPL was not distributed with this file, You can
+// obtain one at http://mozilla.org/MPL/2.0/.
+//
+
+#pragma once
+
+#include <Eigen/Dense>
+#include <string>
+
+namespace tetwild {
+
+///
+/// @brief      { Writes a tet mesh as a binary MSH 2.2 file, with the same content as PyMesh::MshSaver (nodes, tets,
+///             and one element scalar field). The records are encoded in parallel, by blocks, directly from the
+///             matrices, and each block is written at once. }
+///
+/// @param[in]  path         { Output file }
+/// @param[in]  V            { #V x 3 vertices }
+/// @param[in]  T            { #T x 4 tets }
+/// @param[in]  A            { #T values of the element field }
+/// @param[in]  field_name   { Name of the element field }
+/// @param[in]  num_threads  { Number of threads (see getNumThreads()) }
+///
+void writeMsh(const std::string &path, const Eigen::MatrixXd &V, const Eigen::MatrixXi &T,
+              const Eigen::VectorXd &A, const std::string &field_name, int num_threads);
+
+} // namespace tetwild
@@ -0,0 +1,96 @@
+// This file is part of TetWild, a software for generating tetrahedral meshes.
+//
+// This Source Code Form is subject to the terms of the Mozilla Public License
+// v. 2.0. If a copy of the MPL was not distributed with this file, You can
+// obtain one at http://mozilla.org/MPL/2.0/.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace tetwild {
+
+////////////////////////////////////////////////////////////////////////////////
+
+///
+/// @brief      { Number of threads to actually use for a requested number of threads }
+///
+/// @param[in]  num_threads  { Requested number of threads (<= 0 means all hardware threads) }
+///
+/// @return     { Number of threads, at least 1 }
+///
+inline int getNumThreads(int num_threads) {
+    if (num_threads <= 0) {
+        num_threads = (int) std::thread::hardware_concurrency();
+    }
+    return std::max(1, num_threads);
+}
+
+///
+/// @brief      { Calls func(i, thread_id) for every i in [0, n) using a pool of
+///             num_threads threads (the calling thread being thread 0). Indices
+///             are handed out in chunks, so func must not depend on the
+///             processing order. The first exception thrown by a worker is
+///             rethrown on the calling thread. }
+///
+/// @param[in]  n            { Number of iterations }
+/// @param[in]  num_threads  { Number of threads (see getNumThreads()) }
+/// @param[in]  func         { Functor called as func(int i, int thread_id) }
+/// @param[in]  chunk_size   { Number of consecutive indices grabbed at once by a thread }
+///
+template<typename Func>
+void parallelFor(int n, int num_threads, const Func &func, int chunk_size = 16) {
+    num_threads = std::min(getNumThreads(num_threads), (n + chunk_size - 1) / chunk_size);
+    if (num_threads <= 1) {
+        for (int i = 0; i < n; i++) {
+            func(i, 0);
+        }
+        return;
+    }
+
+    std::atomic<int> next(0);
+    std::atomic<bool> is_stopped(false);
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    auto worker = [&](int thread_id) {
+        try {
+            while (!is_stopped) {
+                int start = next.fetch_add(chunk_size);
+                if (start >= n) {
+                    break;
+                }
+                int end = std::min(n, start + chunk_size);
+                for (int i = start; i < end; i++) {
+                    func(i, thread_id);
+                }
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+            is_stopped = true;
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(num_threads - 1);
+    for (int t = 1; t < num_threads; t++) {
+        threads.emplace_back(worker, t);
+    }
+    worker(0);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+} // namespace tetwild
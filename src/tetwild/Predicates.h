@@ -0,0 +1,102 @@
+// This file is part of TetWild, a software for generating tetrahedral meshes.
+//
+// This Source Code Form is subject to the terms of the Mozilla Public License
+// v. 2.0. If a copy of the MPL was not distributed with this file, You can
+// obtain one at http://mozilla.org/MPL/2.0/.
+//
+
+#pragma once
+
+#include <cmath>
+
+namespace tetwild {
+
+///
+/// @brief      { Static error bound of the orientation determinant evaluated in double precision, relative to its
+///             permanent (Shewchuk, Adaptive Precision Floating-Point Arithmetic, orient3d stage A) }
+///
+const double ORIENTATION_ERROR_BOUND = (7.0 + 56.0 * 1.1102230246251565e-16) * 1.1102230246251565e-16;
+
+///
+/// @brief      { Sign of the orientation of four points given by their double coordinates, with the same
+///             convention as CGAL::orientation(p, q, r, s) }
+///
+/// @return     { 1 (CGAL::POSITIVE) or -1 (CGAL::NEGATIVE) when the floating point sign is certified, 0 when it
+///             is not and an exact predicate must decide }
+///
+inline int orientationFilter(double px, double py, double pz, double qx, double qy, double qz,
+                             double rx, double ry, double rz, double sx, double sy, double sz) {
+    const double adx = qx - px, ady = qy - py, adz = qz - pz;
+    const double bdx = rx - px, bdy = ry - py, bdz = rz - pz;
+    const double cdx = sx - px, cdy = sy - py, cdz = sz - pz;
+
+    const double bdxcdy = bdx * cdy, cdxbdy = cdx * bdy;
+    const double cdxady = cdx * ady, adxcdy = adx * cdy;
+    const double adxbdy = adx * bdy, bdxady = bdx * ady;
+
+    const double det = adz * (bdxcdy - cdxbdy) + bdz * (cdxady - adxcdy) + cdz * (adxbdy - bdxady);
+    const double permanent = (std::abs(bdxcdy) + std::abs(cdxbdy)) * std::abs(adz)
+                             + (std::abs(cdxady) + std::abs(adxcdy)) * std::abs(bdz)
+                             + (std::abs(adxbdy) + std::abs(bdxady)) * std::abs(cdz);
+    const double err_bound = ORIENTATION_ERROR_BOUND * permanent;
+    if (det > err_bound)
+        return 1;
+    if (-det > err_bound)
+        return -1;
+    return 0;
+}
+
+///
+/// @brief      { Orientations of a small batch of tets, filtered as orientationFilter(). The coordinates are stored
+///             as structure of arrays so that the determinants of the whole batch are evaluated in vector registers. }
+///
+class OrientationBatch {
+public:
+    static const int SIZE = 8;
+
+    int size() const { return n; }
+    bool isFull() const { return n == SIZE; }
+    void clear() { n = 0; }
+
+    ///
+    /// @brief      { Adds a tet, given by the coordinates of its four vertices }
+    ///
+    template<typename Point>
+    void add(const Point& p, const Point& q, const Point& r, const Point& s) {
+        const Point* ps[4] = {&p, &q, &r, &s};
+        for (int j = 0; j < 4; j++) {
+            for (int k = 0; k < 3; k++)
+                c[3 * j + k][n] = (*ps[j])[k];
+        }
+        n++;
+    }
+
+    ///
+    /// @brief      { Signs of the tets added so far, see orientationFilter() }
+    ///
+    void computeSigns(int signs[SIZE]) const {
+        double det[SIZE], err_bound[SIZE];
+        for (int i = 0; i < SIZE; i++) {
+            const double adx = c[3][i] - c[0][i], ady = c[4][i] - c[1][i], adz = c[5][i] - c[2][i];
+            const double bdx = c[6][i] - c[0][i], bdy = c[7][i] - c[1][i], bdz = c[8][i] - c[2][i];
+            const double cdx = c[9][i] - c[0][i], cdy = c[10][i] - c[1][i], cdz = c[11][i] - c[2][i];
+
+            const double bdxcdy = bdx * cdy, cdxbdy = cdx * bdy;
+            const double cdxady = cdx * ady, adxcdy = adx * cdy;
+            const double adxbdy = adx * bdy, bdxady = bdx * ady;
+
+            det[i] = adz * (bdxcdy - cdxbdy) + bdz * (cdxady - adxcdy) + cdz * (adxbdy - bdxady);
+            err_bound[i] = ORIENTATION_ERROR_BOUND * ((std::abs(bdxcdy) + std::abs(cdxbdy)) * std::abs(adz)
+                                                      + (std::abs(cdxady) + std::abs(adxcdy)) * std::abs(bdz)
+                                                      + (std::abs(adxbdy) + std::abs(bdxady)) * std::abs(cdz));
+        }
+        for (int i = 0; i < n; i++)
+            signs[i] = det[i] > err_bound[i] ? 1 : (-det[i] > err_bound[i] ? -1 : 0);
+    }
+
+private:
+    double c[12][SIZE] = {}; //x, y, z of the four vertices, one row per coordinate
+    int n = 0;
+};
+
+} // namespace tetwild
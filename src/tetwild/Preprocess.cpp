@@ -15,6 +15,7 @@
 #include <tetwild/State.h>
 #include <tetwild/Logger.h>
 #include <tetwild/DistanceQuery.h>
+#include <tetwild/Parallel.h>
 #include <pymesh/MshSaver.h>
 #include <igl/fit_plane.h>
 #include <igl/remove_duplicate_vertices.h>
@@ -29,6 +30,7 @@
 #include <geogram/numerics/predicates.h>
 #include <geogram/basic/geometry_nd.h>
 #include <unordered_map>
+#include <memory>
 
 namespace tetwild {
 
@@ -217,7 +219,7 @@ void Preprocess::process(GEO::Mesh& geo_sf_mesh, std::vector<Point_3>& m_vertice
     f_is_removed = std::vector<bool>(F_in.rows(), false);
 
     // mesh_reorder(geo_sf_mesh, GEO::MESH_ORDER_HILBERT);
-    GEO::MeshFacetsAABBWithEps geo_face_tree(geo_sf_mesh);
+    GEO::MeshFacetsAABBWithEps geo_face_tree(geo_sf_mesh, true, args.use_wide_bvh);
 
     std::vector<std::array<int, 2>> edges;
     edges.reserve(F_in.rows()*6);
@@ -232,12 +234,15 @@ void Preprocess::process(GEO::Mesh& geo_sf_mesh, std::vector<Point_3>& m_vertice
     edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
 
     const int edges_size = edges.size();
+    std::vector<ElementInQueue_sm> eles;
+    eles.reserve(edges_size * 2);
     for (int i = 0; i < edges_size; i++) {
         double weight = getEdgeLength(edges[i]);
-        sm_queue.push(ElementInQueue_sm(edges[i], weight));
-        sm_queue.push(ElementInQueue_sm(std::array<int, 2>({{edges[i][1], edges[i][0]}}), weight));
+        eles.emplace_back(edges[i], weight);
+        eles.emplace_back(std::array<int, 2>({{edges[i][1], edges[i][0]}}), weight);
         progress_total += 2;
     }
+    sm_queue.pushAll(std::move(eles));
 
     //simplification
     ts = 0;
@@ -418,6 +423,10 @@ double Preprocess::getCosAngle(int v_id, int v1_id, int v2_id) {
 void Preprocess::simplify(const GEO::Mesh &geo_mesh, const GEO::MeshFacetsAABBWithEps& face_aabb_tree, const Args &args) {
     int cnt = 0;
 //    logger().debug("queue.size() = {}", sm_queue.size());
+    int num_threads = getNumThreads(args.num_threads);
+    if (num_threads > 1)
+        cnt += simplifyInParallel(geo_mesh, face_aabb_tree, args, num_threads);
+
     while (!sm_queue.empty()) {
         std::array<int, 2> v_ids = sm_queue.top().v_ids;
         double old_weight = sm_queue.top().weight;
@@ -449,6 +458,123 @@ void Preprocess::simplify(const GEO::Mesh &geo_mesh, const GEO::MeshFacetsAABBWi
     }
 }
 
+int Preprocess::simplifyInParallel(const GEO::Mesh &geo_mesh, const GEO::MeshFacetsAABBWithEps& face_aabb_tree,
+                                   const Args &args, int num_threads) {
+    const int LOCKED = -1;
+    const int FAILED = 0;
+    const int COLLAPSABLE = 1;
+
+    //a vertex is locked by the edge whose token it holds, tokens of previous rounds are stale
+    std::unique_ptr<std::atomic<int>[]> v_locks(new std::atomic<int>[V_in.rows()]);
+    for (int i = 0; i < V_in.rows(); i++)
+        v_locks[i] = -1;
+
+    const int batch_size = args.is_deterministic ? 8192 : 1024 * num_threads;
+    int round_token = 0;
+    int round = 0;
+    int cnt = 0;
+    std::vector<ElementInQueue_sm> batch;
+    std::vector<int> return_codes;
+    std::vector<std::vector<int>> n12_f_ids;
+    std::vector<std::unordered_set<int>> new_f_ids;
+    std::vector<GEO::vec3> new_ps;
+    std::vector<ElementInQueue_sm> deferred_eles;
+    while (!sm_queue.empty()) {
+        round++;
+        round_token += batch.size();
+        batch.clear();
+        deferred_eles.clear();
+        for (int n_popped = 0; batch.size() < batch_size && n_popped < 4 * batch_size && !sm_queue.empty(); n_popped++) {
+            std::array<int, 2> v_ids = sm_queue.top().v_ids;
+            double old_weight = sm_queue.top().weight;
+            sm_queue.pop();
+
+            if (args.user_callback) {
+                args.user_callback(Step::Preprocess, double(progress_current) / double(progress_total));
+            }
+            ++progress_current;
+
+            if (!isEdgeValid(v_ids, old_weight))
+                continue;
+
+            //in deterministic mode, the conflicts are resolved here in the order of the queue
+            if (args.is_deterministic && !lockOneRings(v_ids, round_token, round_token + batch.size(), v_locks.get())) {
+                deferred_eles.emplace_back(v_ids, old_weight);
+                continue;
+            }
+            batch.emplace_back(v_ids, old_weight);
+        }
+        for (const auto& ele : deferred_eles)
+            sm_queue.push(ele);
+
+        //the checks only read the one-rings of the edges and the envelope tree, the changes are applied afterwards
+        return_codes.assign(batch.size(), LOCKED);
+        n12_f_ids.resize(batch.size());
+        new_f_ids.resize(batch.size());
+        new_ps.resize(batch.size());
+        auto check_one = [&](int i, int thread_id) {
+            const std::array<int, 2>& v_ids = batch[i].v_ids;
+            if (!args.is_deterministic && !lockOneRings(v_ids, round_token, round_token + i, v_locks.get()))
+                return;
+            return_codes[i] = isCollapsable(v_ids[0], v_ids[1], geo_mesh, face_aabb_tree, n12_f_ids[i], new_f_ids[i], new_ps[i])
+                              ? COLLAPSABLE : FAILED;
+        };
+        parallelFor((int) batch.size(), num_threads, check_one);
+        if (!batch.empty() && std::count(return_codes.begin(), return_codes.end(), LOCKED) == batch.size()) {
+            //all the lock attempts failed and have been released, make sure that we progress
+            check_one(0, 0);
+        }
+
+        ///apply the changes in the order of the queue
+        for (int i = 0; i < batch.size(); i++) {
+            if (return_codes[i] == LOCKED) {
+                sm_queue.push(batch[i]);
+            } else if (return_codes[i] == COLLAPSABLE) {
+                applyCollapse(batch[i].v_ids[0], batch[i].v_ids[1], n12_f_ids[i], new_f_ids[i], new_ps[i]);
+                cnt++;
+            } else {
+                inf_es.push_back(batch[i].v_ids);
+                inf_e_tss.push_back(ts);
+            }
+        }
+    }
+    logger().debug("{} rounds of parallel simplification", round);
+    return cnt;
+}
+
+bool Preprocess::lockOneRings(const std::array<int, 2>& v_ids, int round_token, int token, std::atomic<int>* v_locks) {
+    std::vector<int> locked_v_ids;
+    auto lock = [&](int v_id) {
+        int cur = v_locks[v_id].load();
+        while (true) {
+            if (cur == token)
+                return true;
+            if (cur >= round_token)
+                return false;
+            if (v_locks[v_id].compare_exchange_weak(cur, token)) {
+                locked_v_ids.push_back(v_id);
+                return true;
+            }
+        }
+    };
+
+    //once both vertices are locked, nobody else can modify their one-rings
+    bool is_locked = lock(v_ids[0]) && lock(v_ids[1]);
+    for (int i = 0; i < 2 && is_locked; i++) {
+        for (int f_id : conn_fs[v_ids[i]]) {
+            for (int j = 0; j < 3 && is_locked; j++)
+                is_locked = lock(F_in(f_id, j));
+            if (!is_locked)
+                break;
+        }
+    }
+    if (!is_locked) {
+        for (int v_id : locked_v_ids)
+            v_locks[v_id] = -1;
+    }
+    return is_locked;
+}
+
 void Preprocess::postProcess(const GEO::Mesh &geo_mesh, const GEO::MeshFacetsAABBWithEps& face_aabb_tree, const Args &args) {
     logger().debug("postProcess!");
 
@@ -481,18 +607,29 @@ void Preprocess::postProcess(const GEO::Mesh &geo_mesh, const GEO::MeshFacetsAAB
 }
 
 bool Preprocess::removeAnEdge(int v1_id, int v2_id, const GEO::Mesh &geo_mesh, const GEO::MeshFacetsAABBWithEps& face_aabb_tree) {
+    std::vector<int> n12_f_ids;
+    std::unordered_set<int> new_f_ids;
+    GEO::vec3 new_p;
+    if (!isCollapsable(v1_id, v2_id, geo_mesh, face_aabb_tree, n12_f_ids, new_f_ids, new_p))
+        return false;
+    applyCollapse(v1_id, v2_id, n12_f_ids, new_f_ids, new_p);
+    return true;
+}
+
+bool Preprocess::isCollapsable(int v1_id, int v2_id, const GEO::Mesh &geo_mesh, const GEO::MeshFacetsAABBWithEps& face_aabb_tree,
+                               std::vector<int>& n12_f_ids, std::unordered_set<int>& new_f_ids, GEO::vec3& new_p) {
     if (!isOneRingClean(v1_id) || !isOneRingClean(v2_id))
         return false;
 
     //check if flip after collapsing
-    std::vector<int> n12_f_ids;
+    n12_f_ids.clear();
     setIntersection(conn_fs[v1_id], conn_fs[v2_id], n12_f_ids);
     if (n12_f_ids.size() != 2) {//!!!
 //        logger().debug("error: n12_f_ids.size()!=2");
         return false;
     }
 
-    std::unordered_set<int> new_f_ids;
+    new_f_ids.clear();
     for (int f_id:conn_fs[v1_id]) {
         if (f_id != n12_f_ids[0] && f_id != n12_f_ids[1]) {
             new_f_ids.insert(f_id);
@@ -542,11 +679,19 @@ bool Preprocess::removeAnEdge(int v1_id, int v2_id, const GEO::Mesh &geo_mesh, c
     face_aabb_tree.nearest_facet(mid_p, nearest_p, _);//project back to surface
     for(int j=0;j<3;j++)
         V_in(v1_id, j) = nearest_p[j];
+    new_p = nearest_p;
     V_in.row(v2_id) = V_in.row(v1_id);
-    if (isOutEnvelop(new_f_ids, geo_mesh, face_aabb_tree)) {
-        V_in.row(v1_id) = v1_old_p;
-        V_in.row(v2_id) = v2_old_p;
-        return false;
+    bool is_out = isOutEnvelop(new_f_ids, geo_mesh, face_aabb_tree);
+    V_in.row(v1_id) = v1_old_p;
+    V_in.row(v2_id) = v2_old_p;
+    return !is_out;
+}
+
+void Preprocess::applyCollapse(int v1_id, int v2_id, const std::vector<int>& n12_f_ids, const std::unordered_set<int>& new_f_ids,
+                               const GEO::vec3& new_p) {
+    for (int j = 0; j < 3; j++) {
+        V_in(v1_id, j) = new_p[j];
+        V_in(v2_id, j) = new_p[j];
     }
     c++;
 
@@ -594,8 +739,6 @@ bool Preprocess::removeAnEdge(int v1_id, int v2_id, const GEO::Mesh &geo_mesh, c
         sm_queue.push(ElementInQueue_sm(std::array<int, 2>({{v_id, v2_id}}), weight));
         progress_total += 2;
     }
-
-    return true;
 }
 
 bool Preprocess::isEdgeValid(const std::array<int, 2>& v_ids){
@@ -12,13 +12,14 @@
 #ifndef NEW_GTET_PREPROCESS_H
 #define NEW_GTET_PREPROCESS_H
 
+#include <tetwild/BucketQueue.h>
 #include <tetwild/ForwardDecls.h>
 #include <tetwild/CGALTypes.h>
 #include <tetwild/geogram/MeshAABB.h>
 #include <geogram/mesh/mesh.h>
 #include <Eigen/Dense>
+#include <atomic>
 #include <unordered_set>
-#include <queue>
 
 namespace tetwild {
 
@@ -41,7 +42,7 @@ struct cmp_sm {
 };
 
 class Preprocess {
-    std::priority_queue<ElementInQueue_sm, std::vector<ElementInQueue_sm>, cmp_sm> sm_queue;
+    BucketQueue<ElementInQueue_sm, cmp_sm, false> sm_queue;
     int c=0;
 public:
     State &state;
@@ -60,8 +61,18 @@ public:
     void process(GEO::Mesh& geo_sf_mesh, std::vector<Point_3>& m_vertices, std::vector<std::array<int, 3>>& m_faces, const Args &args);
 
     void simplify(const GEO::Mesh &geo_mesh, const GEO::MeshFacetsAABBWithEps& face_aabb_tree, const Args &args);
+    // Collapses the edges of the queue by rounds of independent collapses checked in parallel, returns the number of collapses
+    int simplifyInParallel(const GEO::Mesh &geo_mesh, const GEO::MeshFacetsAABBWithEps& face_aabb_tree, const Args &args, int num_threads);
+    // Try to lock all the vertices of the faces around an edge with the given token (tokens below round_token are stale)
+    bool lockOneRings(const std::array<int, 2>& v_ids, int round_token, int token, std::atomic<int>* v_locks);
     void postProcess(const GEO::Mesh &geo_mesh, const GEO::MeshFacetsAABBWithEps& face_aabb_tree, const Args &args);
     bool removeAnEdge(int v1_id, int v2_id, const GEO::Mesh &geo_mesh, const GEO::MeshFacetsAABBWithEps& face_aabb_tree);
+    // Only reads the one-rings of v1 and v2 (the positions of v1 and v2 are changed temporarily), so it can run
+    // concurrently on edges with disjoint one-rings
+    bool isCollapsable(int v1_id, int v2_id, const GEO::Mesh &geo_mesh, const GEO::MeshFacetsAABBWithEps& face_aabb_tree,
+                       std::vector<int>& n12_f_ids, std::unordered_set<int>& new_f_ids, GEO::vec3& new_p);
+    void applyCollapse(int v1_id, int v2_id, const std::vector<int>& n12_f_ids, const std::unordered_set<int>& new_f_ids,
+                       const GEO::vec3& new_p);
 
     void swap(const GEO::Mesh &geo_mesh, const GEO::MeshFacetsAABBWithEps& face_aabb_tree);
     double getCosAngle(int v_id, int v1_id, int v2_id);
@@ -80,7 +80,7 @@ namespace igl {
         }
         template<>
         inline void serialize(const tetwild::TetVertex &v, std::vector<char> &buffer) {
-            ::igl::serialize(v.pos, std::string("pos"), buffer);
+            ::igl::serialize(tetwild::Point_3(v.pos), std::string("pos"), buffer);
             ::igl::serialize(v.posf, std::string("posf"), buffer);
 
             ::igl::serialize(v.is_rounded, std::string("is_rounded"), buffer);
@@ -107,7 +107,9 @@ namespace igl {
 
         template<>
         inline void deserialize(tetwild::TetVertex &v, const std::vector<char> &buffer) {
-            ::igl::deserialize(v.pos, std::string("pos"), buffer);
+            tetwild::Point_3 pos;
+            ::igl::deserialize(pos, std::string("pos"), buffer);
+            v.pos = pos;
             ::igl::deserialize(v.posf, std::string("posf"), buffer);
 
             ::igl::deserialize(v.is_rounded, std::string("is_rounded"), buffer);
@@ -13,8 +13,10 @@
 #include <tetwild/Common.h>
 #include <tetwild/Logger.h>
 #include <tetwild/Args.h>
+#include <tetwild/Parallel.h>
 #include <igl/Timer.h>
 #include <bitset>
+#include <atomic>
 
 //centroid
 #include <tetwild/DisableWarnings.h>
@@ -75,145 +77,111 @@ void SimpleTetrahedralization::triangulation(std::vector<TetVertex>& tet_vertice
     int original_v_size = bsp_vertices.size();
 
     ///cal arrangement
+    //the arrangements are computed in parallel on the faces as they are before any of them is split, then merged in
+    //face order: the vertices found on a bsp_edge by several of its faces are merged, and the edge is split once
+    std::vector<int> arr_f_ids;
     for (int i = 0; i < bsp_faces.size(); i++) {
         if (bsp_faces[i].div_faces.size() == 0) {
             continue;
         }
-
-        if (args.user_callback) {
-            args.user_callback(Step::Tetra, 0.3 * double(i) / double(bsp_faces.size()));
-        }
-
-        ///cal arrangement
-        Plane_3 pln;
-        constructPlane(i, pln);
-        MC.initT(pln.orthogonal_vector());
         MC.getOrientedVertices(i);
-        Polygon_2 poly;
-        for (int j = 0; j < bsp_faces[i].vertices.size(); j++) {
-            poly.push_back(MC.to2d(bsp_vertices[bsp_faces[i].vertices[j]]));
-        }
-        assert(poly.is_simple());
-
-        Arrangement_2 arr;
-        std::vector<Segment_arr_2> arr_segs;
-        for (int j = 0; j < poly.size(); j++)
-            arr_segs.push_back(Segment_arr_2(poly[j], poly[(j + 1) % poly.size()]));
-        for (auto it = bsp_faces[i].div_faces.begin(); it != bsp_faces[i].div_faces.end(); it++) {
-            std::array<Point_2, 3> df_vs;
-            for (int j = 0; j < 3; j++)
-                df_vs[j] = MC.to2d(MC.m_vertices[MC.m_faces[*it][j]]);
-            for (int j = 0; j < 3; j++) {
-                Line_2 l(df_vs[j], df_vs[(j + 1) % 3]);
-                int cnt_pos = 0, cnt_neg = 0;
-                for (int k = 0; k < poly.size(); k++) {
-                    CGAL::Oriented_side side=l.oriented_side(poly[k]);
-                    if(side==CGAL::ON_POSITIVE_SIDE)
-                        cnt_pos++;
-                    if(side==CGAL::ON_NEGATIVE_SIDE)
-                        cnt_neg++;
-                }
-                if(cnt_pos>0 && cnt_neg>0)
-                    arr_segs.push_back(Segment_arr_2(df_vs[j], df_vs[(j + 1) % 3]));
+        arr_f_ids.push_back(i);
+    }
+    //the constructions from the shared points are done here: a worker only uses the objects of its own face, since
+    //copying a lazy exact object updates the reference counts of the representations it shares
+    int num_threads = getNumThreads(args.num_threads);
+    std::vector<FaceProjection> face_projs(arr_f_ids.size());
+    for (int i = 0; i < arr_f_ids.size(); i++) {
+        projectFace(arr_f_ids[i], face_projs[i]);
+        if (num_threads > 1) {
+            //the exact evaluation releases the shared points the constructions refer to
+            FaceProjection& proj = face_projs[i];
+            CGAL::exact(proj.pln);
+            for (auto& p : proj.vs)
+                CGAL::exact(p);
+            for (auto& df_vs : proj.df_vs) {
+                for (auto& p : df_vs)
+                    CGAL::exact(p);
             }
+            for (auto& seg : proj.segs)
+                CGAL::exact(seg);
         }
-        CGAL::insert(arr, arr_segs.begin(), arr_segs.end());
-
-        std::map<Point_2, int> vs_arr2bsp;
-        std::vector<std::vector<int>> new_v_ids(bsp_faces[i].edges.size(), std::vector<int>());
-        std::vector<Segment_3> segs(bsp_faces[i].edges.size(), Segment_3());
-        for (int j = 0; j < bsp_faces[i].edges.size(); j++) {
-            segs[j] = Segment_3(bsp_vertices[bsp_edges[bsp_faces[i].edges[j]].vertices[0]],
-                                bsp_vertices[bsp_edges[bsp_faces[i].edges[j]].vertices[1]]);
-        }
-        for (auto it = arr.vertices_begin(); it != arr.vertices_end(); it++) {
-            if (poly.has_on_unbounded_side(it->point())) {
-                vs_arr2bsp[it->point()] = -1;
-                continue;
-            }
-            auto vit = std::find(poly.vertices_begin(), poly.vertices_end(), it->point());//todo
-            if (vit != poly.vertices_end()) {
-                int n = vit - poly.vertices_begin();
-                vs_arr2bsp[it->point()] = bsp_faces[i].vertices[n];
+    }
+    std::vector<FaceArrangement> face_arrs(arr_f_ids.size());
+    std::atomic<int> progress_current(0);
+    parallelFor((int) arr_f_ids.size(), num_threads, [&](int i, int thread_id) {
+        calArrangement(arr_f_ids[i], face_projs[i], face_arrs[i]);
+        int cnt = ++progress_current;
+        if (args.user_callback && thread_id == 0) {
+            args.user_callback(Step::Tetra, 0.3 * double(cnt) / double(arr_f_ids.size()));
+        }
+    }, 1);
+
+    ///merge the new vertices
+    std::map<int, std::vector<int>> new_v_ids_on_edges;
+    for (int i = 0; i < arr_f_ids.size(); i++) {
+        int f_id = arr_f_ids[i];
+        FaceArrangement& face_arr = face_arrs[i];
+        std::vector<int> local2bsp = bsp_faces[f_id].vertices;
+        for (int j = 0; j < face_arr.new_vs.size(); j++) {
+            if (face_arr.new_vs_on_edges[j] < 0) {
+                bsp_vertices.push_back(face_arr.new_vs[j]);
+                local2bsp.push_back(bsp_vertices.size() - 1);
+                bsp_faces[f_id].vertices.push_back(bsp_vertices.size() - 1);
                 continue;
             }
-            Point_3 p = MC.to3d(it->point(), pln);
-            int on_e_local_id = -1;
-            for (int j = 0; j < bsp_faces[i].edges.size(); j++) {
-                if (segs[j].has_on(p)) {
-                    on_e_local_id = j;
-                    break;
-                }
-            }
-            if (on_e_local_id >= 0) {//if the vertex is on the edges of this bsp_face
-                bsp_vertices.push_back(p);
-                vs_arr2bsp[it->point()] = bsp_vertices.size() - 1;
-                new_v_ids[on_e_local_id].push_back(bsp_vertices.size() - 1);
-                bsp_faces[i].vertices.push_back(bsp_vertices.size() - 1);
+            int e_id = bsp_faces[f_id].edges[face_arr.new_vs_on_edges[j]];
+            std::vector<int>& on_e_v_ids = new_v_ids_on_edges[e_id];
+            auto it = std::find_if(on_e_v_ids.begin(), on_e_v_ids.end(), [&](int v_id) {
+                return bsp_vertices[v_id] == face_arr.new_vs[j];
+            });
+            if (it != on_e_v_ids.end()) {
+                local2bsp.push_back(*it);
                 continue;
             }
-            //else
-            bsp_vertices.push_back(p);
-            vs_arr2bsp[it->point()] = bsp_vertices.size() - 1;
-            bsp_faces[i].vertices.push_back(bsp_vertices.size() - 1);
+            bsp_vertices.push_back(face_arr.new_vs[j]);
+            local2bsp.push_back(bsp_vertices.size() - 1);
+            on_e_v_ids.push_back(bsp_vertices.size() - 1);
         }
-
-        std::vector<std::array<int, 2>> es;
-        for (auto it = arr.edges_begin(); it != arr.edges_end(); it++) {
-            Point_2 &p1 = it->source()->point();
-            Point_2 &p2 = it->target()->point();
-            if (vs_arr2bsp[p1] < 0 || vs_arr2bsp[p2] < 0)
-                continue;
-            std::array<int, 2> e = {{vs_arr2bsp[p1], vs_arr2bsp[p2]}};
-            std::sort(e.begin(), e.end());
-            es.push_back(e);
+        for (auto& e : face_arr.inner_es) {
+            e = {{local2bsp[e[0]], local2bsp[e[1]]}};
         }
-        std::sort(es.begin(), es.end());
-
-        std::vector<std::array<int, 2>> tmp_es;
-        int old_e_size = bsp_faces[i].edges.size();
-        for (int j = 0; j < old_e_size; j++) {
-            if (new_v_ids[j].size() == 0)
-                continue;
-            std::vector<int> new_es = bsp_edges[bsp_faces[i].edges[j]].vertices;
-            new_es.insert(new_es.end(), new_v_ids[j].begin(), new_v_ids[j].end());
-            std::sort(new_es.begin(), new_es.end(), [&](int a, int b) {
-                return bsp_vertices[a] < bsp_vertices[b];
-            });
-
-            std::vector<int> new_e_ids;
-            for (int k = 0; k < new_es.size() - 1; k++) {
-                BSPEdge new_bsp_e(new_es[k], new_es[k + 1]);
-                new_bsp_e.conn_faces = bsp_edges[bsp_faces[i].edges[j]].conn_faces;
-                if (k == 0)
-                    bsp_edges[bsp_faces[i].edges[j]] = new_bsp_e;
-                else {
-                    bsp_edges.push_back(new_bsp_e);
-                    new_e_ids.push_back(bsp_edges.size() - 1);
-                }
+    }
 
-                std::array<int, 2> e = {{new_es[k], new_es[k + 1]}};
-                std::sort(e.begin(), e.end());
-                tmp_es.push_back(e);
+    ///split the bsp_edges, the new vertices and edges are added to all the faces around
+    for (auto& e_vs : new_v_ids_on_edges) {
+        int e_id = e_vs.first;
+        const std::vector<int>& new_v_ids = e_vs.second;
+        std::vector<int> new_es = bsp_edges[e_id].vertices;
+        new_es.insert(new_es.end(), new_v_ids.begin(), new_v_ids.end());
+        std::sort(new_es.begin(), new_es.end(), [&](int a, int b) {
+            return bsp_vertices[a] < bsp_vertices[b];
+        });
+
+        std::vector<int> new_e_ids;
+        std::unordered_set<int> conn_faces = bsp_edges[e_id].conn_faces;
+        for (int k = 0; k < new_es.size() - 1; k++) {
+            BSPEdge new_bsp_e(new_es[k], new_es[k + 1]);
+            new_bsp_e.conn_faces = conn_faces;
+            if (k == 0)
+                bsp_edges[e_id] = new_bsp_e;
+            else {
+                bsp_edges.push_back(new_bsp_e);
+                new_e_ids.push_back(bsp_edges.size() - 1);
             }
+        }
 
-            for (auto it = bsp_edges[bsp_faces[i].edges[j]].conn_faces.begin();
-                 it != bsp_edges[bsp_faces[i].edges[j]].conn_faces.end(); it++) {
-                bsp_faces[*it].edges.insert(bsp_faces[*it].edges.end(), new_e_ids.begin(), new_e_ids.end());
-                if (*it == i)
-                    continue;
-                bsp_faces[*it].vertices.insert(bsp_faces[*it].vertices.end(), new_v_ids[j].begin(), new_v_ids[j].end());
-            }
+        for (auto it = conn_faces.begin(); it != conn_faces.end(); it++) {
+            bsp_faces[*it].edges.insert(bsp_faces[*it].edges.end(), new_e_ids.begin(), new_e_ids.end());
+            bsp_faces[*it].vertices.insert(bsp_faces[*it].vertices.end(), new_v_ids.begin(), new_v_ids.end());
         }
-        std::sort(tmp_es.begin(), tmp_es.end());
+    }
 
-        std::vector<std::array<int, 2>> diff_es;
-        std::set_difference(es.begin(), es.end(), tmp_es.begin(), tmp_es.end(),
-                            std::back_inserter(diff_es));
-        for (int j = 0; j < diff_es.size(); j++) {
-            BSPEdge e(diff_es[j][0], diff_es[j][1]);
-            bsp_edges.push_back(e);
-            bsp_faces[i].edges.push_back(bsp_edges.size() - 1);
+    ///add the edges inside the faces
+    for (int i = 0; i < arr_f_ids.size(); i++) {
+        for (const auto& e : face_arrs[i].inner_es) {
+            bsp_edges.push_back(BSPEdge(e[0], e[1]));
+            bsp_faces[arr_f_ids[i]].edges.push_back(bsp_edges.size() - 1);
         }
     }
     logger().debug("2D arr {}", tmp_timer.getElapsedTime());
@@ -259,8 +227,8 @@ void SimpleTetrahedralization::triangulation(std::vector<TetVertex>& tet_vertice
         if (is_tet) {
             is_tets[i] = true;
             std::array<int, 4> t = {{v_ids[0], v_ids[1], v_ids[2], v_ids[3]}};
-            if (CGAL::orientation(tet_vertices[t[0]].pos, tet_vertices[t[1]].pos, tet_vertices[t[2]].pos,
-                                  tet_vertices[t[3]].pos) != CGAL::POSITIVE) {
+            if (orientation(tet_vertices[t[0]].pos, tet_vertices[t[1]].pos, tet_vertices[t[2]].pos,
+                            tet_vertices[t[3]].pos) != CGAL::POSITIVE) {
                 int tmp = t[1];
                 t[1] = t[3];
                 t[3] = tmp;
@@ -355,8 +323,8 @@ void SimpleTetrahedralization::triangulation(std::vector<TetVertex>& tet_vertice
         for (int j = 0; j < bsp_nodes[i].faces.size(); j++) {
             for (const std::array<int, 3> &f_ids:cdt_faces[bsp_nodes[i].faces[j]]) {
                 std::array<int, 4> t = {{c_id, f_ids[0], f_ids[1], f_ids[2]}};
-                if (CGAL::orientation(tet_vertices[t[0]].pos, tet_vertices[t[1]].pos, tet_vertices[t[2]].pos,
-                                      tet_vertices[t[3]].pos) != CGAL::POSITIVE) {
+                if (orientation(tet_vertices[t[0]].pos, tet_vertices[t[1]].pos, tet_vertices[t[2]].pos,
+                                tet_vertices[t[3]].pos) != CGAL::POSITIVE) {
                     int tmp = t[1];
                     t[1] = t[3];
                     t[3] = tmp;
@@ -367,7 +335,7 @@ void SimpleTetrahedralization::triangulation(std::vector<TetVertex>& tet_vertice
         }
 
         //round into float
-        Point_3 old_p = tet_vertices[c_id].pos;
+        HybridPoint_3 old_p = tet_vertices[c_id].pos;
         tet_vertices[c_id].posf = Point_3f(CGAL::to_double(old_p[0]), CGAL::to_double(old_p[1]),
                                            CGAL::to_double(old_p[2]));
         tet_vertices[c_id].pos = Point_3(tet_vertices[c_id].posf[0], tet_vertices[c_id].posf[1],
@@ -375,10 +343,10 @@ void SimpleTetrahedralization::triangulation(std::vector<TetVertex>& tet_vertice
         int tets_size = tets.size();
         bool is_rounded = true;
         for (int j = 0; j < t_cnt; j++) {
-            if (CGAL::orientation(tet_vertices[tets[tets_size - 1 - j][0]].pos,
-                                  tet_vertices[tets[tets_size - 1 - j][1]].pos,
-                                  tet_vertices[tets[tets_size - 1 - j][2]].pos,
-                                  tet_vertices[tets[tets_size - 1 - j][3]].pos) != CGAL::POSITIVE) {
+            if (orientation(tet_vertices[tets[tets_size - 1 - j][0]].pos,
+                            tet_vertices[tets[tets_size - 1 - j][1]].pos,
+                            tet_vertices[tets[tets_size - 1 - j][2]].pos,
+                            tet_vertices[tets[tets_size - 1 - j][3]].pos) != CGAL::POSITIVE) {
                 is_rounded = false;
                 break;
             }
@@ -536,7 +504,7 @@ void SimpleTetrahedralization::labelSurface(const std::vector<int>& m_f_tags, co
 //                    is_visited[opp_i][opp_j] = state.NOT_SURFACE;
                 continue;
             }
-            std::unordered_set<int> sf_faces_tmp;
+            VertexSet sf_faces_tmp;
             setIntersection(tet_vertices[tets[i][(j + 1) % 4]].on_face, tet_vertices[tets[i][(j + 2) % 4]].on_face,
                             sf_faces_tmp);
             if (sf_faces_tmp.size() == 0) {
@@ -565,7 +533,8 @@ void SimpleTetrahedralization::labelSurface(const std::vector<int>& m_f_tags, co
             is_surface_fs[i][j] = 0;
             Plane_3 pln(m_vertices[m_faces[sf_faces[0]][0]], m_vertices[m_faces[sf_faces[0]][1]],
                         m_vertices[m_faces[sf_faces[0]][2]]);
-            CGAL::Oriented_side side = pln.oriented_side(tet_vertices[tets[i][j]].pos);
+            Point_3 p_tmp;
+            CGAL::Oriented_side side = pln.oriented_side(tet_vertices[tets[i][j]].pos.get(p_tmp));
 
             if (side == CGAL::ON_ORIENTED_BOUNDARY) {
                 log_and_throw("ERROR: side == CGAL::ON_ORIENTED_BOUNDARY!!");
@@ -622,7 +591,7 @@ void SimpleTetrahedralization::labelSurface(const std::vector<int>& m_f_tags, co
 
     //tag the surface
     for(unsigned int i=0;i<tet_vertices.size();i++){
-        std::unordered_set<int> tmp;
+        VertexSet tmp;
         for(auto it=tet_vertices[i].on_face.begin();it!=tet_vertices[i].on_face.end();it++)
             tmp.insert(m_f_tags[*it]);
         tet_vertices[i].on_face=tmp;
@@ -746,6 +715,114 @@ void SimpleTetrahedralization::labelBoundary(std::vector<TetVertex>& tet_vertice
     logger().debug("{} vertices on surface", cnt_surface);
 }
 
+void SimpleTetrahedralization::projectFace(int bsp_f_id, FaceProjection& proj) {
+    const std::vector<BSPEdge> &bsp_edges = MC.bsp_edges;
+    const std::vector<Point_3> &bsp_vertices = MC.bsp_vertices;
+    const BSPFace& face = MC.bsp_faces[bsp_f_id];
+
+    constructPlane(bsp_f_id, proj.pln);
+    proj.t = MeshConformer::getT(proj.pln.orthogonal_vector());
+    proj.vs.clear();
+    for (int j = 0; j < face.vertices.size(); j++)
+        proj.vs.push_back(MeshConformer::to2d(bsp_vertices[face.vertices[j]], proj.t));
+    proj.df_vs.clear();
+    for (auto it = face.div_faces.begin(); it != face.div_faces.end(); it++) {
+        std::array<Point_2, 3> df_vs;
+        for (int j = 0; j < 3; j++)
+            df_vs[j] = MeshConformer::to2d(MC.m_vertices[MC.m_faces[*it][j]], proj.t);
+        proj.df_vs.push_back(df_vs);
+    }
+    proj.segs.clear();
+    for (int j = 0; j < face.edges.size(); j++) {
+        proj.segs.push_back(Segment_3(bsp_vertices[bsp_edges[face.edges[j]].vertices[0]],
+                                      bsp_vertices[bsp_edges[face.edges[j]].vertices[1]]));
+    }
+}
+
+void SimpleTetrahedralization::calArrangement(int bsp_f_id, const FaceProjection& proj, FaceArrangement& face_arr) {
+    const std::vector<BSPEdge> &bsp_edges = MC.bsp_edges;
+    const BSPFace& face = MC.bsp_faces[bsp_f_id];
+
+    Polygon_2 poly(proj.vs.begin(), proj.vs.end());
+    assert(poly.is_simple());
+
+    Arrangement_2 arr;
+    std::vector<Segment_arr_2> arr_segs;
+    for (int j = 0; j < poly.size(); j++)
+        arr_segs.push_back(Segment_arr_2(poly[j], poly[(j + 1) % poly.size()]));
+    for (const auto& df_vs : proj.df_vs) {
+        for (int j = 0; j < 3; j++) {
+            Line_2 l(df_vs[j], df_vs[(j + 1) % 3]);
+            int cnt_pos = 0, cnt_neg = 0;
+            for (int k = 0; k < poly.size(); k++) {
+                CGAL::Oriented_side side=l.oriented_side(poly[k]);
+                if(side==CGAL::ON_POSITIVE_SIDE)
+                    cnt_pos++;
+                if(side==CGAL::ON_NEGATIVE_SIDE)
+                    cnt_neg++;
+            }
+            if(cnt_pos>0 && cnt_neg>0)
+                arr_segs.push_back(Segment_arr_2(df_vs[j], df_vs[(j + 1) % 3]));
+        }
+    }
+    CGAL::insert(arr, arr_segs.begin(), arr_segs.end());
+
+    ///local ids: the vertices of the face first, then the new ones
+    face_arr.new_vs.clear();
+    face_arr.new_vs_on_edges.clear();
+    face_arr.inner_es.clear();
+    std::map<Point_2, int> vs_arr2local;
+    std::vector<std::vector<int>> local_on_es(face.vertices.size());//the edges each vertex lies on
+    for (int j = 0; j < face.edges.size(); j++) {
+        for (int k = 0; k < 2; k++) {
+            int n = std::find(face.vertices.begin(), face.vertices.end(), bsp_edges[face.edges[j]].vertices[k])
+                    - face.vertices.begin();
+            local_on_es[n].push_back(j);
+        }
+    }
+    for (auto it = arr.vertices_begin(); it != arr.vertices_end(); it++) {
+        if (poly.has_on_unbounded_side(it->point())) {
+            vs_arr2local[it->point()] = -1;
+            continue;
+        }
+        auto vit = std::find(poly.vertices_begin(), poly.vertices_end(), it->point());//todo
+        if (vit != poly.vertices_end()) {
+            vs_arr2local[it->point()] = vit - poly.vertices_begin();
+            continue;
+        }
+        Point_3 p = MeshConformer::to3d(it->point(), proj.pln, proj.t);
+        int on_e_local_id = -1;
+        for (int j = 0; j < face.edges.size(); j++) {
+            if (proj.segs[j].has_on(p)) {
+                on_e_local_id = j;
+                break;
+            }
+        }
+        vs_arr2local[it->point()] = local_on_es.size();
+        local_on_es.push_back(on_e_local_id >= 0 ? std::vector<int>(1, on_e_local_id) : std::vector<int>());
+        face_arr.new_vs.push_back(p);
+        face_arr.new_vs_on_edges.push_back(on_e_local_id);
+    }
+
+    ///the edges on the boundary are added when splitting the bsp_edges
+    for (auto it = arr.edges_begin(); it != arr.edges_end(); it++) {
+        int v1 = vs_arr2local[it->source()->point()];
+        int v2 = vs_arr2local[it->target()->point()];
+        if (v1 < 0 || v2 < 0)
+            continue;
+        bool is_on_boundary = false;
+        for (int e : local_on_es[v1]) {
+            if (std::find(local_on_es[v2].begin(), local_on_es[v2].end(), e) != local_on_es[v2].end()) {
+                is_on_boundary = true;
+                break;
+            }
+        }
+        if (!is_on_boundary)
+            face_arr.inner_es.push_back({{std::min(v1, v2), std::max(v1, v2)}});
+    }
+    std::sort(face_arr.inner_es.begin(), face_arr.inner_es.end());
+}
+
 void SimpleTetrahedralization::constructPlane(int bsp_f_id, Plane_3& pln) {
     pln = Plane_3(MC.bsp_vertices[MC.bsp_faces[bsp_f_id].vertices[0]],
                   MC.bsp_vertices[MC.bsp_faces[bsp_f_id].vertices[1]],
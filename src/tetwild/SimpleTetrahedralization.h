@@ -46,6 +46,37 @@ public:
                        const std::vector<std::array<int, 4>>& is_surface_fs);
 
     void constructPlane(int bsp_f_id, Plane_3& pln);
+
+    ///
+    /// @brief      { Vertices and edges added to a bsp_face by the arrangement of its div_faces. Local vertex ids are
+    ///             the indices in the vertices of the face, followed by the indices of the new vertices. }
+    ///
+    struct FaceArrangement {
+        std::vector<Point_3> new_vs;
+        std::vector<int> new_vs_on_edges; //local id of the edge of the face a new vertex lies on, or -1
+        std::vector<std::array<int, 2>> inner_es; //edges that are not on the boundary of the face
+    };
+
+    ///
+    /// @brief      { Constructions from the mesh points needed by the arrangement of a bsp_face: its plane, its
+    ///             vertices and div_faces projected on the axis plane t, and its edges in the order of its edges }
+    ///
+    struct FaceProjection {
+        Plane_3 pln;
+        int t;
+        std::vector<Point_2> vs;
+        std::vector<std::array<Point_2, 3>> df_vs;
+        std::vector<Segment_3> segs;
+    };
+
+    void projectFace(int bsp_f_id, FaceProjection& proj);
+
+    ///
+    /// @brief      { Computes the arrangement of a bsp_face with oriented vertices, without modifying the mesh. Only the
+    ///             lazy exact objects of proj are copied, so faces with their own projections can be arranged
+    ///             concurrently once the projections have been evaluated exactly. }
+    ///
+    void calArrangement(int bsp_f_id, const FaceProjection& proj, FaceArrangement& face_arr);
 };
 
 } // namespace tetwild
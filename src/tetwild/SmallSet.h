@@ -0,0 +1,200 @@
+// This file is part of TetWild, a software for generating tetrahedral meshes.
+//
+// This Source Code Form is subject to the terms of the Mozilla Public License
+// v. 2.0. If a copy of the MPL was not distributed with this file, You can
+// obtain one at http://mozilla.org/MPL/2.0/.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <utility>
+
+namespace tetwild {
+
+////////////////////////////////////////////////////////////////////////////////
+
+///
+/// @brief      { Compact set of ints stored as a sorted array. Up to N elements
+///             live inline in the object, larger sets spill to a single heap
+///             block. It is meant for the per-vertex adjacency (conn_tets,
+///             on_edge, on_face), which is small, iterated very often, and
+///             modified a few elements at a time. The interface follows the
+///             subset of std::unordered_set<int> used by the mesh code.
+///             Iteration is in increasing order and elements are immutable. }
+///
+/// @tparam     N     { Inline capacity }
+///
+template<int N>
+class SmallSet {
+public:
+    typedef int value_type;
+    typedef const int *const_iterator;
+    typedef const_iterator iterator;
+    typedef size_t size_type;
+
+    SmallSet() = default;
+
+    SmallSet(const SmallSet &other) { assign(other.begin(), other.end()); }
+
+    SmallSet(SmallSet &&other) noexcept { steal(other); }
+
+    ~SmallSet() { release(); }
+
+    SmallSet &operator=(const SmallSet &other) {
+        if (this != &other) {
+            m_size = 0;
+            assign(other.begin(), other.end());
+        }
+        return *this;
+    }
+
+    SmallSet &operator=(SmallSet &&other) noexcept {
+        if (this != &other) {
+            release();
+            steal(other);
+        }
+        return *this;
+    }
+
+    const_iterator begin() const { return data(); }
+    const_iterator end() const { return data() + m_size; }
+
+    size_type size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+    void clear() { m_size = 0; }
+
+    void reserve(size_type n) { grow((int) n); }
+
+    const_iterator find(int x) const {
+        const_iterator it = lowerBound(x);
+        return (it != end() && *it == x) ? it : end();
+    }
+
+    size_type count(int x) const { return find(x) != end() ? 1 : 0; }
+
+    std::pair<const_iterator, bool> insert(int x) {
+        int i = (int) (lowerBound(x) - begin());
+        if (i < m_size && data()[i] == x) {
+            return std::make_pair(begin() + i, false);
+        }
+        grow(m_size + 1);
+        int *d = data();
+        std::memmove(d + i + 1, d + i, (m_size - i) * sizeof(int));
+        d[i] = x;
+        m_size++;
+        return std::make_pair(begin() + i, true);
+    }
+
+    // the hint is ignored, this overload only makes std::inserter work
+    const_iterator insert(const_iterator /* hint */, int x) { return insert(x).first; }
+
+    template<typename InputIt>
+    void insert(InputIt first, InputIt last) {
+        for (; first != last; ++first) {
+            insert(*first);
+        }
+    }
+
+    size_type erase(int x) {
+        const_iterator it = find(x);
+        if (it == end()) {
+            return 0;
+        }
+        erase(it);
+        return 1;
+    }
+
+    // erasing end() is a no-op, so erase(std::find(...)) is safe on missing elements
+    const_iterator erase(const_iterator it) {
+        if (it == end()) {
+            return it;
+        }
+        int i = (int) (it - begin());
+        int *d = data();
+        std::memmove(d + i, d + i + 1, (m_size - i - 1) * sizeof(int));
+        m_size--;
+        return begin() + i;
+    }
+
+    bool operator==(const SmallSet &other) const {
+        return m_size == other.m_size && std::equal(begin(), end(), other.begin());
+    }
+    bool operator!=(const SmallSet &other) const { return !(*this == other); }
+
+private:
+    int m_size = 0;
+    int m_capacity = N;
+    union {
+        int m_inline[N];
+        int *m_heap;
+    };
+
+    bool isInline() const { return m_capacity == N; }
+    int *data() { return isInline() ? m_inline : m_heap; }
+    const int *data() const { return isInline() ? m_inline : m_heap; }
+
+    const_iterator lowerBound(int x) const {
+        const int *d = data();
+        if (m_size <= 16) {
+            int i = 0;
+            while (i < m_size && d[i] < x) {
+                i++;
+            }
+            return d + i;
+        }
+        return std::lower_bound(d, d + m_size, x);
+    }
+
+    void grow(int n) {
+        if (n <= m_capacity) {
+            return;
+        }
+        int new_capacity = std::max(n, 2 * m_capacity);
+        int *new_data = static_cast<int *>(std::malloc(new_capacity * sizeof(int)));
+        if (new_data == nullptr) {
+            throw std::bad_alloc();
+        }
+        std::memcpy(new_data, data(), m_size * sizeof(int));
+        release();
+        m_heap = new_data;
+        m_capacity = new_capacity;
+    }
+
+    void release() {
+        if (!isInline()) {
+            std::free(m_heap);
+            m_capacity = N;
+        }
+    }
+
+    void assign(const_iterator first, const_iterator last) {
+        int n = (int) (last - first);
+        grow(n);
+        std::memcpy(data(), first, n * sizeof(int));
+        m_size = n;
+    }
+
+    void steal(SmallSet &other) {
+        m_size = other.m_size;
+        m_capacity = other.m_capacity;
+        if (other.isInline()) {
+            std::memcpy(m_inline, other.m_inline, m_size * sizeof(int));
+        } else {
+            m_heap = other.m_heap;
+            other.m_capacity = N;
+        }
+        other.m_size = 0;
+    }
+};
+
+///
+/// @brief      { Set type used for the vertex adjacency of the tet mesh }
+///
+typedef SmallSet<6> VertexSet;
+
+} // namespace tetwild
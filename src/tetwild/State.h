@@ -96,6 +96,8 @@ struct MeshRecord {
     double avg_max_d_angle = -1;
     double max_energy = -1;
     double avg_energy = -1;
+    long envelope_cache_hits = -1; //envelope verdicts found in the cache during the operation
+    long envelope_cache_misses = -1;
 
     MeshRecord(int op_, double timing_, int n_v_, int n_t_, double min_min_d_angle_, double avg_min_d_angle_,
                double max_max_d_angle_, double avg_max_d_angle_, double max_energy_, double avg_energy_) {
@@ -11,16 +11,81 @@
 
 #include <tetwild/TetmeshElements.h>
 #include <tetwild/Logger.h>
+#include <tetwild/Predicates.h>
 #include <tetwild/Serialization.h>
 
 namespace tetwild {
 
+HybridPoint_3& HybridPoint_3::operator=(const Point_3& p) {
+    //an interval reduced to a point is the exact value
+    const auto& a = CGAL::approx(p);
+    if (a.x().inf() == a.x().sup() && a.y().inf() == a.y().sup() && a.z().inf() == a.z().sup()) {
+        m_xyz = {{a.x().inf(), a.y().inf(), a.z().inf()}};
+        m_exact = Point_3();
+        m_is_exact = false;
+    } else {
+        m_exact = p;
+        m_is_exact = true;
+    }
+    return *this;
+}
+
+CGAL::Orientation orientation(const HybridPoint_3& p, const HybridPoint_3& q, const HybridPoint_3& r,
+                              const HybridPoint_3& s) {
+    if (p.isDouble() && q.isDouble() && r.isDouble() && s.isDouble()) {
+        const auto& a = p.doubles();
+        const auto& b = q.doubles();
+        const auto& c = r.doubles();
+        const auto& d = s.doubles();
+        int sign = orientationFilter(a[0], a[1], a[2], b[0], b[1], b[2], c[0], c[1], c[2], d[0], d[1], d[2]);
+        if (sign != 0)
+            return sign > 0 ? CGAL::POSITIVE : CGAL::NEGATIVE;
+        return CGAL::orientation(Point_3f(a[0], a[1], a[2]), Point_3f(b[0], b[1], b[2]),
+                                 Point_3f(c[0], c[1], c[2]), Point_3f(d[0], d[1], d[2]));
+    }
+    Point_3 tmp[4];
+    return CGAL::orientation(p.get(tmp[0]), q.get(tmp[1]), r.get(tmp[2]), s.get(tmp[3]));
+}
+
+Point_3 midpoint(const HybridPoint_3& p, const HybridPoint_3& q) {
+    typedef K::Exact_kernel::Point_3 Point_3e;
+    Point_3 tmp[2];
+    const Point_3e& ep = CGAL::exact(p.get(tmp[0]));
+    const Point_3e& eq = CGAL::exact(q.get(tmp[1]));
+    Point_3e m = CGAL::midpoint(ep, eq);
+    return Point_3(CGAL_FT(m.x()), CGAL_FT(m.y()), CGAL_FT(m.z()));
+}
+
 void TetVertex::printInfo() const {
     logger().debug("is_on_surface = {}", is_on_surface);
     logger().debug("is_on_bbox = {}", is_on_bbox);
     logger().debug("conn_tets = {}", conn_tets);
 }
 
+void TetVertexSoA::build(const std::vector<TetVertex>& tet_vertices) {
+    x.resize(tet_vertices.size());
+    y.resize(tet_vertices.size());
+    z.resize(tet_vertices.size());
+    flags.resize(tet_vertices.size());
+    for (int i = 0; i < tet_vertices.size(); i++) {
+        update(i, tet_vertices[i]);
+    }
+}
+
+void TetVertexSoA::update(int v_id, const TetVertex& v) {
+    if (v_id >= size()) {
+        x.resize(v_id + 1);
+        y.resize(v_id + 1);
+        z.resize(v_id + 1);
+        flags.resize(v_id + 1);
+    }
+    x[v_id] = v.posf[0];
+    y[v_id] = v.posf[1];
+    z[v_id] = v.posf[2];
+    flags[v_id] = (v.is_rounded ? ROUNDED : 0) | (v.is_on_surface ? ON_SURFACE : 0) | (v.is_on_bbox ? ON_BBOX : 0)
+                  | (v.is_on_boundary ? ON_BOUNDARY : 0) | (v.is_locked ? LOCKED : 0) | (v.is_inside ? INSIDE : 0);
+}
+
 void Stage::serialize(std::string serialize_file) {
     igl::serialize(tet_vertices, "tet_vertices", serialize_file, true);
     igl::serialize(tets, "tets", serialize_file);
@@ -14,32 +14,97 @@
 
 #include <tetwild/State.h>
 #include <tetwild/CGALTypes.h>
-#include <unordered_set>
+#include <tetwild/SmallSet.h>
+#include <array>
+#include <cstdint>
+#include <vector>
 
 namespace tetwild {
 
+///
+/// @brief      { Exact position of a vertex. Coordinates that are exactly doubles, which is the case of all the rounded
+///             vertices, are stored as such: the exact rationals are only allocated for the other vertices. }
+///
+class HybridPoint_3 {
+public:
+    HybridPoint_3() = default;
+    HybridPoint_3(const Point_3& p) { *this = p; }
+
+    HybridPoint_3& operator=(const Point_3& p);
+
+    void setDoubles(double x, double y, double z) {
+        m_xyz = {{x, y, z}};
+        m_exact = Point_3();
+        m_is_exact = false;
+    }
+
+    bool isDouble() const { return !m_is_exact; }
+    const std::array<double, 3>& doubles() const { return m_xyz; } //only valid if isDouble()
+
+    ///
+    /// @brief      { Exact position. An exact point is returned by reference, since copying a lazy exact point updates
+    ///             the reference count of its representation, which is not thread-safe. A double point is built in tmp. }
+    ///
+    const Point_3& get(Point_3& tmp) const {
+        if (m_is_exact)
+            return m_exact;
+        tmp = Point_3(m_xyz[0], m_xyz[1], m_xyz[2]);
+        return tmp;
+    }
+    operator Point_3() const { Point_3 tmp; return get(tmp); } //copies the exact point, not for the parallel loops
+    CGAL_FT operator[](int i) const { return m_is_exact ? m_exact[i] : CGAL_FT(m_xyz[i]); }
+
+    ///
+    /// @brief      { Evaluates the exact rationals, if any, so that the point can then be read concurrently }
+    ///
+    void evaluateExact() const {
+        if (m_is_exact)
+            CGAL::exact(m_exact);
+    }
+
+private:
+    std::array<double, 3> m_xyz = {{0, 0, 0}};
+    Point_3 m_exact;
+    bool m_is_exact = false;
+};
+
+///
+/// @brief      { Orientation of four points, with the double predicates when all of them are doubles }
+///
+CGAL::Orientation orientation(const HybridPoint_3& p, const HybridPoint_3& q, const HybridPoint_3& r,
+                              const HybridPoint_3& s);
+
+///
+/// @brief      { Exact midpoint, computed on the exact values of p and q without copying their lazy exact handles, so
+///             that it can be called concurrently once they have been evaluated }
+///
+Point_3 midpoint(const HybridPoint_3& p, const HybridPoint_3& q);
+
 //const int ON_SURFACE_FALSE = 0;//delete
 //const int ON_SURFACE_TRUE_INSIDE = 1;//delete
 //const int ON_SURFACE_TRUE_OUTSIDE = 2;//delete
 class TetVertex {
 public:
-    Point_3 pos;//todo: how to remove it?
+    HybridPoint_3 pos;
 
     ///for surface conforming
     int on_fixed_vertex = -1;
-    std::unordered_set<int> on_edge;//fixed points can be on more than one edges
-    std::unordered_set<int> on_face;
+    VertexSet on_edge;//fixed points can be on more than one edges
+    VertexSet on_face;
     bool is_on_surface = false;
 
     ///for local operations
-    std::unordered_set<int> conn_tets;
+    VertexSet conn_tets;
 
     ///for hybrid rationals
     Point_3f posf;
     bool is_rounded = false;
 
     void round() {
-        posf = Point_3f(CGAL::to_double(pos[0]), CGAL::to_double(pos[1]), CGAL::to_double(pos[2]));
+        if (pos.isDouble())
+            posf = Point_3f(pos.doubles()[0], pos.doubles()[1], pos.doubles()[2]);
+        else
+            posf = Point_3f(CGAL::to_double(pos[0]), CGAL::to_double(pos[1]), CGAL::to_double(pos[2]));
     }
 
     ///for bbox
@@ -63,6 +128,34 @@ public:
     bool is_inside = false;
 };
 
+///for the optimization hot path
+///the float positions and the flags of tet_vertices, stored as structure of arrays so that the quality and
+///orientation kernels only touch the data they need; the exact coordinates stay in TetVertex::pos
+class TetVertexSoA {
+public:
+    enum Flag : uint8_t {
+        ROUNDED = 1 << 0,
+        ON_SURFACE = 1 << 1,
+        ON_BBOX = 1 << 2,
+        ON_BOUNDARY = 1 << 3,
+        LOCKED = 1 << 4,
+        INSIDE = 1 << 5
+    };
+
+    std::vector<double> x;
+    std::vector<double> y;
+    std::vector<double> z;
+    std::vector<uint8_t> flags;
+
+    void build(const std::vector<TetVertex>& tet_vertices);
+    void update(int v_id, const TetVertex& v);//grows the arrays if needed, so new vertices must be added serially
+
+    size_t size() const { return flags.size(); }
+    bool hasFlag(int v_id, Flag f) const { return (flags[v_id] & f) != 0; }
+    bool isRounded(int v_id) const { return hasFlag(v_id, ROUNDED); }
+    Point_3f posf(int v_id) const { return Point_3f(x[v_id], y[v_id], z[v_id]); }
+};
+
 class TetQuality {
 public:
     double min_d_angle = 0;
@@ -0,0 +1,235 @@
+// This file is part of TetWild, a software for generating tetrahedral meshes.
+//
+// This Source Code Form is subject to the terms of the Mozilla Public License
+// v. 2.0. If a copy of the MPL was not distributed with this file, You can
+// obtain one at http://mozilla.org/MPL/2.0/.
+//
+
+#include <tetwild/Trace.h>
+#include <tetwild/Logger.h>
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace tetwild {
+
+namespace trace {
+
+std::atomic<bool> is_enabled(false);
+
+namespace {
+
+struct Event {
+    const char* name;
+    const char* category;
+    char phase; //'X' for spans, 'C' for counters
+    double ts; //microseconds since start()
+    double dur;
+    int num_args;
+    const char* keys[Span::MAX_ARGS];
+    double values[Span::MAX_ARGS];
+};
+
+///
+/// @brief      { Events and counters of one thread. The buffers of the finished threads are reused by the next
+///             threads, so the short-lived threads of parallelFor() share a few lanes of the trace. }
+///
+struct ThreadBuffer {
+    int tid;
+    std::vector<Event> events;
+    std::array<int64_t, NUM_COUNTERS> counters;
+};
+
+std::mutex registry_mutex;
+std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+std::vector<ThreadBuffer*> free_buffers;
+std::chrono::steady_clock::time_point start_time;
+int main_tid = 0; //lane of the thread that called start()
+
+ThreadBuffer* acquireBuffer() {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    if (!free_buffers.empty()) {
+        ThreadBuffer* buffer = free_buffers.back();
+        free_buffers.pop_back();
+        return buffer;
+    }
+    buffers.emplace_back(new ThreadBuffer());
+    buffers.back()->tid = int(buffers.size()) - 1;
+    buffers.back()->counters.fill(0);
+    return buffers.back().get();
+}
+
+struct ThreadLane {
+    ThreadBuffer* buffer = nullptr;
+
+    ~ThreadLane() {
+        if (buffer != nullptr) {
+            std::lock_guard<std::mutex> lock(registry_mutex);
+            free_buffers.push_back(buffer);
+        }
+    }
+};
+
+ThreadBuffer& threadBuffer() {
+    static thread_local ThreadLane lane;
+    if (lane.buffer == nullptr)
+        lane.buffer = acquireBuffer();
+    return *lane.buffer;
+}
+
+double now() {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+void writeString(std::ofstream& out, const char* s) {
+    out << '"';
+    for (; *s != '\0'; s++) {
+        if (*s == '"' || *s == '\\')
+            out << '\\';
+        out << *s;
+    }
+    out << '"';
+}
+
+} // anonymous namespace
+
+void start() {
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        for (auto& buffer : buffers) {
+            buffer->events.clear();
+            buffer->counters.fill(0);
+        }
+        start_time = std::chrono::steady_clock::now();
+    }
+    main_tid = threadBuffer().tid;
+    is_enabled = true;
+}
+
+void stop(const std::string& path) {
+    if (!is_enabled)
+        return;
+    is_enabled = false;
+
+    std::ofstream out(path);
+    if (!out)
+        log_and_throw("cannot write the trace to " + path);
+    out.precision(15);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool is_first = true;
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    for (const auto& buffer : buffers) {
+        out << (is_first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->tid
+            << ",\"args\":{\"name\":\"" << (buffer->tid == main_tid ? "main" : "worker " + std::to_string(buffer->tid))
+            << "\"}}";
+        is_first = false;
+        for (const Event& e : buffer->events) {
+            out << ",\n{\"name\":";
+            writeString(out, e.name);
+            out << ",\"cat\":";
+            writeString(out, e.category);
+            out << ",\"ph\":\"" << e.phase << "\",\"pid\":1,\"tid\":" << buffer->tid << ",\"ts\":" << e.ts;
+            if (e.phase == 'X')
+                out << ",\"dur\":" << e.dur;
+            if (e.num_args > 0) {
+                out << ",\"args\":{";
+                for (int i = 0; i < e.num_args; i++) {
+                    out << (i == 0 ? "" : ",");
+                    writeString(out, e.keys[i]);
+                    out << ":" << e.values[i];
+                }
+                out << "}";
+            }
+            out << "}";
+        }
+    }
+    out << "\n]}\n";
+    logger().info("trace written to {}", path);
+}
+
+Recording::Recording(const std::string& path)
+    : m_path(path)
+{
+    if (!m_path.empty())
+        start();
+}
+
+Recording::~Recording() {
+    if (m_path.empty())
+        return;
+    try {
+        stop(m_path);
+    } catch (const TetWildError&) {
+        //already logged by stop(), do not throw from a destructor
+    }
+}
+
+void addToCounter(Counter counter, int64_t n) {
+    threadBuffer().counters[counter] += n;
+}
+
+int64_t total(Counter counter) {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    int64_t sum = 0;
+    for (const auto& buffer : buffers)
+        sum += buffer->counters[counter];
+    return sum;
+}
+
+void counterEvent(const char* name, const char* key, double value) {
+    if (!isEnabled())
+        return;
+    Event e;
+    e.name = name;
+    e.category = "counter";
+    e.phase = 'C';
+    e.ts = now();
+    e.dur = 0;
+    e.num_args = 1;
+    e.keys[0] = key;
+    e.values[0] = value;
+    threadBuffer().events.push_back(e);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+Span::Span(const char* name, const char* category)
+    : m_name(name)
+    , m_category(category)
+    , m_is_enabled(isEnabled())
+{
+    if (m_is_enabled)
+        m_start = now();
+}
+
+Span::~Span() {
+    if (!m_is_enabled)
+        return;
+    Event e;
+    e.name = m_name;
+    e.category = m_category;
+    e.phase = 'X';
+    e.ts = m_start;
+    e.dur = now() - m_start;
+    e.num_args = m_num_args;
+    for (int i = 0; i < m_num_args; i++) {
+        e.keys[i] = m_keys[i];
+        e.values[i] = m_values[i];
+    }
+    threadBuffer().events.push_back(e);
+}
+
+void Span::addArg(const char* key, double value) {
+    if (!m_is_enabled || m_num_args == MAX_ARGS)
+        return;
+    m_keys[m_num_args] = key;
+    m_values[m_num_args] = value;
+    m_num_args++;
+}
+
+} // namespace trace
+
+} // namespace tetwild
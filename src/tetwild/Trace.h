@@ -0,0 +1,111 @@
+// This file is part of TetWild, a software for generating tetrahedral meshes.
+//
+// This Source Code Form is subject to the terms of the Mozilla Public License
+// v. 2.0. If a copy of the MPL was not distributed with this file, You can
+// obtain one at http://mozilla.org/MPL/2.0/.
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace tetwild {
+
+namespace trace {
+
+///
+/// @brief      { Counters incremented by the local operations, summed over all the threads }
+///
+enum Counter {
+    FLIP_REJECTS = 0, //candidate configurations rejected because a tet is inverted
+    ENVELOPE_REJECTS, //candidate configurations rejected because they leave the envelope
+    NUM_COUNTERS
+};
+
+extern std::atomic<bool> is_enabled;
+
+inline bool isEnabled() { return is_enabled.load(std::memory_order_relaxed); }
+
+///
+/// @brief      { Clears the recorded events and counters and starts recording }
+///
+void start();
+
+///
+/// @brief      { Stops recording and writes the events in the Chrome trace event format (JSON, can be opened in
+///             chrome://tracing or https://ui.perfetto.dev). Nothing is written if tracing was not started. }
+///
+void stop(const std::string& path);
+
+///
+/// @brief      { Records a trace for the lifetime of the object if a path is given: start() on construction and
+///             stop() on destruction, also when an exception leaves the scope. A trace that cannot be written is
+///             reported in the log. }
+///
+class Recording {
+public:
+    explicit Recording(const std::string& path);
+    ~Recording();
+
+    Recording(const Recording&) = delete;
+    Recording& operator=(const Recording&) = delete;
+
+private:
+    std::string m_path;
+};
+
+void addToCounter(Counter counter, int64_t n);
+
+///
+/// @brief      { Increments a counter of the calling thread, no-op when tracing is disabled }
+///
+inline void count(Counter counter, int64_t n = 1) {
+    if (isEnabled())
+        addToCounter(counter, n);
+}
+
+///
+/// @brief      { Value of a counter, summed over all the threads (to be called outside of the parallel loops) }
+///
+int64_t total(Counter counter);
+
+///
+/// @brief      { Records a counter event, shown as a track of values over time }
+///
+void counterEvent(const char* name, const char* key, double value);
+
+///
+/// @brief      { Records the time spent in a scope as one event of the calling thread. The names and keys must be
+///             string literals (only the pointers are stored). Spans are only recorded if tracing was enabled when
+///             they were created. }
+///
+class Span {
+public:
+    static const int MAX_ARGS = 4;
+
+    explicit Span(const char* name, const char* category = "tetwild");
+    ~Span();
+
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+
+    ///
+    /// @brief      { Attaches a value to the event (at most MAX_ARGS) }
+    ///
+    void addArg(const char* key, double value);
+
+private:
+    const char* m_name;
+    const char* m_category;
+    bool m_is_enabled;
+    double m_start = 0;
+    int m_num_args = 0;
+    const char* m_keys[MAX_ARGS];
+    double m_values[MAX_ARGS];
+};
+
+} // namespace trace
+
+} // namespace tetwild
@@ -36,7 +36,7 @@ void extractTriangles(const std::vector<TetVertex> &verts,
         for (int j = 0; j < 4; j++) {
             if (is_surface_fs[i][j] != state.NOT_SURFACE && is_surface_fs[i][j] > 0) {//outside
                 std::array<int, 3> v_ids = {{tets[i][(j + 1) % 4], tets[i][(j + 2) % 4], tets[i][(j + 3) % 4]}};
-                if (CGAL::orientation(verts[v_ids[0]].pos, verts[v_ids[1]].pos,
+                if (orientation(verts[v_ids[0]].pos, verts[v_ids[1]].pos,
                                       verts[v_ids[2]].pos, verts[tets[i][j]].pos) != CGAL::POSITIVE) {
                     std::swap(v_ids[0], v_ids[2]);
                 }
@@ -11,12 +11,16 @@
 
 #include <tetwild/VertexSmoother.h>
 #include <tetwild/Common.h>
+#include <tetwild/Args.h>
 #include <tetwild/Logger.h>
+#include <tetwild/Parallel.h>
+#include <tetwild/AMIPSKernels.h>
 #include <pymesh/MshSaver.h>
 
 namespace tetwild {
 
 void VertexSmoother::smooth() {
+    refreshVertexSoA();
     tets_tss = std::vector<int>(tets.size(), 1);
     tet_vertices_tss = std::vector<int>(tet_vertices.size(), 0);
     ts = 1;
@@ -55,13 +59,14 @@ bool VertexSmoother::smoothSingleVertex(int v_id, bool is_cal_energy){
 
     ///try to round the vertex
     if(!tet_vertices[v_id].is_rounded) {
-        Point_3 old_p = tet_vertices[v_id].pos;
+        HybridPoint_3 old_p = tet_vertices[v_id].pos;
         tet_vertices[v_id].pos = Point_3(tet_vertices[v_id].posf[0], tet_vertices[v_id].posf[1],
                                          tet_vertices[v_id].posf[2]);
         if(isFlip(new_tets))
             tet_vertices[v_id].pos = old_p;
         else
             tet_vertices[v_id].is_rounded = true;
+        syncVertex(v_id);
     }
 
     ///check if should use exact smoothing
@@ -84,18 +89,20 @@ bool VertexSmoother::smoothSingleVertex(int v_id, bool is_cal_energy){
         }
 
         //assign new coordinate and try to round it
-        Point_3 old_p = tet_vertices[v_id].pos;
+        HybridPoint_3 old_p = tet_vertices[v_id].pos;
         Point_3f old_pf = tet_vertices[v_id].posf;
         bool old_is_rounded = tet_vertices[v_id].is_rounded;
         Point_3 p = Point_3(pf[0], pf[1], pf[2]);
         tet_vertices[v_id].pos = p;
         tet_vertices[v_id].posf = pf;
         tet_vertices[v_id].is_rounded = true;
+        syncVertex(v_id);
         if (isFlip(new_tets)) {//TODO: why it happens?
             logger().debug("flip in the end");
             tet_vertices[v_id].pos = old_p;
             tet_vertices[v_id].posf = old_pf;
             tet_vertices[v_id].is_rounded = old_is_rounded;
+            syncVertex(v_id);
         }
     }
 
@@ -115,6 +122,7 @@ void VertexSmoother::smoothSingle() {
     double old_ts = ts;
     counter = 0;
     suc_counter = 0;
+    std::vector<int> v_ids;
     for (int v_id = 0; v_id < tet_vertices.size(); v_id++) {
         if (v_is_removed[v_id])
             continue;
@@ -137,73 +145,13 @@ void VertexSmoother::smoothSingle() {
 //        if(!is_changed)
 //            continue;
 
-        counter++;
-
-#if TIMING_BREAKDOWN
-        igl_timer.start();
-#endif
-        std::vector<std::array<int, 4>> new_tets;
-        std::vector<int> t_ids;
-        for (auto it = tet_vertices[v_id].conn_tets.begin(); it != tet_vertices[v_id].conn_tets.end(); it++) {
-            new_tets.push_back(tets[*it]);
-            t_ids.push_back(*it);
-        }
-
-        ///try to round the vertex
-        if (!tet_vertices[v_id].is_rounded) {
-            Point_3 old_p = tet_vertices[v_id].pos;
-            tet_vertices[v_id].pos = Point_3(tet_vertices[v_id].posf[0], tet_vertices[v_id].posf[1],
-                                             tet_vertices[v_id].posf[2]);
-            if (isFlip(new_tets))
-                tet_vertices[v_id].pos = old_p;
-            else
-                tet_vertices[v_id].is_rounded = true;
-        }
-
-        ///check if should use exact smoothing
-        bool is_valid = true;
-        for (auto it = tet_vertices[v_id].conn_tets.begin(); it != tet_vertices[v_id].conn_tets.end(); it++) {
-            CGAL::Orientation ori = CGAL::orientation(tet_vertices[tets[*it][0]].posf, tet_vertices[tets[*it][1]].posf,
-                                                      tet_vertices[tets[*it][2]].posf, tet_vertices[tets[*it][3]].posf);
-            if (ori != CGAL::POSITIVE) {
-                is_valid = false;
-                break;
-            }
-        }
-#if TIMING_BREAKDOWN
-        breakdown_timing[id_round] += igl_timer.getElapsedTime();
-#endif
-
-        if (!is_valid) {
-            continue;
-        } else {
-            Point_3f pf;
-            if (energy_type == state.ENERGY_AMIPS) {
-                if (!NewtonsMethod(t_ids, new_tets, v_id, pf))
-                    continue;
-            }
-#if TIMING_BREAKDOWN
-            igl_timer.start();
-#endif
-            //assign new coordinate and try to round it
-            Point_3 old_p = tet_vertices[v_id].pos;
-            Point_3f old_pf = tet_vertices[v_id].posf;
-            bool old_is_rounded = tet_vertices[v_id].is_rounded;
-            Point_3 p = Point_3(pf[0], pf[1], pf[2]);
-            tet_vertices[v_id].pos = p;
-            tet_vertices[v_id].posf = pf;
-            tet_vertices[v_id].is_rounded = true;
-            if (isFlip(new_tets)) {//TODO: why it happens?
-                logger().debug("flip in the end");
-                tet_vertices[v_id].pos = old_p;
-                tet_vertices[v_id].posf = old_pf;
-                tet_vertices[v_id].is_rounded = old_is_rounded;
-            }
-#if TIMING_BREAKDOWN
-            breakdown_timing[id_round] += igl_timer.getElapsedTime();
-#endif
-        }
+        v_ids.push_back(v_id);
+    }
+    counter = v_ids.size();
 
+    std::vector<int> suc_v_ids;
+    smoothVertices(v_ids, false, suc_v_ids);
+    for (int v_id : suc_v_ids) {
         ///update timestamps
         ts++;
         for(auto it=tet_vertices[v_id].conn_tets.begin();it!=tet_vertices[v_id].conn_tets.end();it++)
@@ -241,12 +189,85 @@ void VertexSmoother::smoothSingle() {
     }
 }
 
+bool VertexSmoother::smoothInteriorVertex(int v_id) {
+#if TIMING_BREAKDOWN
+    igl_timer.start();
+#endif
+    std::vector<std::array<int, 4>> new_tets;
+    std::vector<int> t_ids;
+    for (auto it = tet_vertices[v_id].conn_tets.begin(); it != tet_vertices[v_id].conn_tets.end(); it++) {
+        new_tets.push_back(tets[*it]);
+        t_ids.push_back(*it);
+    }
+
+    ///try to round the vertex
+    if (!tet_vertices[v_id].is_rounded) {
+        HybridPoint_3 old_p = tet_vertices[v_id].pos;
+        tet_vertices[v_id].pos = Point_3(tet_vertices[v_id].posf[0], tet_vertices[v_id].posf[1],
+                                         tet_vertices[v_id].posf[2]);
+        if (isFlip(new_tets))
+            tet_vertices[v_id].pos = old_p;
+        else
+            tet_vertices[v_id].is_rounded = true;
+        syncVertex(v_id);
+    }
+
+    ///check if should use exact smoothing
+    bool is_valid = true;
+    for (auto it = tet_vertices[v_id].conn_tets.begin(); it != tet_vertices[v_id].conn_tets.end(); it++) {
+        CGAL::Orientation ori = CGAL::orientation(tet_vertices[tets[*it][0]].posf, tet_vertices[tets[*it][1]].posf,
+                                                  tet_vertices[tets[*it][2]].posf, tet_vertices[tets[*it][3]].posf);
+        if (ori != CGAL::POSITIVE) {
+            is_valid = false;
+            break;
+        }
+    }
+#if TIMING_BREAKDOWN
+    breakdown_timing[id_round] += igl_timer.getElapsedTime();
+#endif
+
+    if (!is_valid) {
+        return false;
+    } else {
+        Point_3f pf;
+        if (energy_type == state.ENERGY_AMIPS) {
+            if (!NewtonsMethod(t_ids, new_tets, v_id, pf))
+                return false;
+        }
+#if TIMING_BREAKDOWN
+        igl_timer.start();
+#endif
+        //assign new coordinate and try to round it
+        HybridPoint_3 old_p = tet_vertices[v_id].pos;
+        Point_3f old_pf = tet_vertices[v_id].posf;
+        bool old_is_rounded = tet_vertices[v_id].is_rounded;
+        Point_3 p = Point_3(pf[0], pf[1], pf[2]);
+        tet_vertices[v_id].pos = p;
+        tet_vertices[v_id].posf = pf;
+        tet_vertices[v_id].is_rounded = true;
+        syncVertex(v_id);
+        if (isFlip(new_tets)) {//TODO: why it happens?
+            logger().debug("flip in the end");
+            tet_vertices[v_id].pos = old_p;
+            tet_vertices[v_id].posf = old_pf;
+            tet_vertices[v_id].is_rounded = old_is_rounded;
+            syncVertex(v_id);
+        }
+#if TIMING_BREAKDOWN
+        breakdown_timing[id_round] += igl_timer.getElapsedTime();
+#endif
+    }
+
+    return true;
+}
+
 void VertexSmoother::smoothSurface() {//smoothing surface using two methods
 //    suc_counter = 0;
 //    counter = 0;
     int sf_suc_counter = 0;
     int sf_counter = 0;
 
+    std::vector<int> v_ids;
     for (int v_id = 0; v_id < tet_vertices.size(); v_id++) {
         if (v_is_removed[v_id])
             continue;
@@ -262,204 +283,285 @@ void VertexSmoother::smoothSurface() {//smoothing surface using two methods
             tet_vertices[v_id].on_fixed_vertex = -1;
             tet_vertices[v_id].on_face.clear();
             tet_vertices[v_id].on_edge.clear();
+            syncVertex(v_id);
             continue;
         }
         if (!isBoundaryPoint(v_id))
             tet_vertices[v_id].is_on_boundary = false;
+        syncVertex(v_id);
 
-        counter++;
-        sf_counter++;
+        v_ids.push_back(v_id);
+    }
+    counter += v_ids.size();
+    sf_counter = v_ids.size();
 
-        std::vector<std::array<int, 4>> new_tets;
-        std::vector<int> old_t_ids;
-        for (auto it = tet_vertices[v_id].conn_tets.begin(); it != tet_vertices[v_id].conn_tets.end(); it++) {
-            new_tets.push_back(tets[*it]);
-            old_t_ids.push_back(*it);
-        }
+    std::vector<int> suc_v_ids;
+    smoothVertices(v_ids, true, suc_v_ids);
+    for (int v_id : suc_v_ids) {
+        ///update timestamps
+        ts++;
+        for (auto it = tet_vertices[v_id].conn_tets.begin(); it != tet_vertices[v_id].conn_tets.end(); it++)
+            tets_tss[*it] = ts;
+        tet_vertices_tss[v_id] = ts;
 
-        if (!tet_vertices[v_id].is_rounded) {
-            Point_3 old_p = tet_vertices[v_id].pos;
-            tet_vertices[v_id].pos = Point_3(tet_vertices[v_id].posf[0], tet_vertices[v_id].posf[1],
-                                             tet_vertices[v_id].posf[2]);
-            if (isFlip(new_tets))
-                tet_vertices[v_id].pos = old_p;
-            else
-                tet_vertices[v_id].is_rounded = true;
-        }
+        suc_counter++;
+        sf_suc_counter++;
+        if (sf_suc_counter % 1000 == 0)
+            logger().debug("1000 accepted!");
+    }
+    logger().debug("Totally {}({}) vertices on surface are smoothed.", sf_suc_counter, sf_counter);
+}
 
-        bool is_valid = true;
-        for (auto it = tet_vertices[v_id].conn_tets.begin(); it != tet_vertices[v_id].conn_tets.end(); it++) {
-            CGAL::Orientation ori = CGAL::orientation(tet_vertices[tets[*it][0]].posf, tet_vertices[tets[*it][1]].posf,
-                                                      tet_vertices[tets[*it][2]].posf, tet_vertices[tets[*it][3]].posf);
-            if (ori != CGAL::POSITIVE) {
-                is_valid = false;
-                break;
-            }
+bool VertexSmoother::smoothSurfaceVertex(int v_id) {
+    std::vector<std::array<int, 4>> new_tets;
+    std::vector<int> old_t_ids;
+    for (auto it = tet_vertices[v_id].conn_tets.begin(); it != tet_vertices[v_id].conn_tets.end(); it++) {
+        new_tets.push_back(tets[*it]);
+        old_t_ids.push_back(*it);
+    }
+
+    if (!tet_vertices[v_id].is_rounded) {
+        HybridPoint_3 old_p = tet_vertices[v_id].pos;
+        tet_vertices[v_id].pos = Point_3(tet_vertices[v_id].posf[0], tet_vertices[v_id].posf[1],
+                                         tet_vertices[v_id].posf[2]);
+        if (isFlip(new_tets))
+            tet_vertices[v_id].pos = old_p;
+        else
+            tet_vertices[v_id].is_rounded = true;
+        syncVertex(v_id);
+    }
+
+    bool is_valid = true;
+    for (auto it = tet_vertices[v_id].conn_tets.begin(); it != tet_vertices[v_id].conn_tets.end(); it++) {
+        CGAL::Orientation ori = CGAL::orientation(tet_vertices[tets[*it][0]].posf, tet_vertices[tets[*it][1]].posf,
+                                                  tet_vertices[tets[*it][2]].posf, tet_vertices[tets[*it][3]].posf);
+        if (ori != CGAL::POSITIVE) {
+            is_valid = false;
+            break;
         }
+    }
 
-        Point_3 p_out;
-        Point_3f pf_out;
-        if (!is_valid) {
-            continue;
-        } else {
-            if (energy_type == state.ENERGY_AMIPS) {
-                if (!NewtonsMethod(old_t_ids, new_tets, v_id, pf_out))
-                    continue;
-            }
-            p_out = Point_3(pf_out[0], pf_out[1], pf_out[2]);
+    Point_3 p_out;
+    Point_3f pf_out;
+    if (!is_valid) {
+        return false;
+    } else {
+        if (energy_type == state.ENERGY_AMIPS) {
+            if (!NewtonsMethod(old_t_ids, new_tets, v_id, pf_out))
+                return false;
         }
+        p_out = Point_3(pf_out[0], pf_out[1], pf_out[2]);
+    }
 
-        ///find one-ring surface faces
+    ///find one-ring surface faces
 #if TIMING_BREAKDOWN
-        igl_timer.start();
+    igl_timer.start();
 #endif
-        std::vector<std::array<int, 3>> tri_ids;
-        for (auto it = tet_vertices[v_id].conn_tets.begin(); it != tet_vertices[v_id].conn_tets.end(); it++) {
-            for (int j = 0; j < 4; j++) {
-                if (tets[*it][j] != v_id && is_surface_fs[*it][j] != state.NOT_SURFACE) {
-                    std::array<int, 3> tri = {{tets[*it][(j + 1) % 4], tets[*it][(j + 2) % 4], tets[*it][(j + 3) % 4]}};
-                    std::sort(tri.begin(), tri.end());
-                    tri_ids.push_back(tri);
-                }
+    std::vector<std::array<int, 3>> tri_ids;
+    for (auto it = tet_vertices[v_id].conn_tets.begin(); it != tet_vertices[v_id].conn_tets.end(); it++) {
+        for (int j = 0; j < 4; j++) {
+            if (tets[*it][j] != v_id && is_surface_fs[*it][j] != state.NOT_SURFACE) {
+                std::array<int, 3> tri = {{tets[*it][(j + 1) % 4], tets[*it][(j + 2) % 4], tets[*it][(j + 3) % 4]}};
+                std::sort(tri.begin(), tri.end());
+                tri_ids.push_back(tri);
             }
         }
-        std::sort(tri_ids.begin(), tri_ids.end());
-        tri_ids.erase(std::unique(tri_ids.begin(), tri_ids.end()), tri_ids.end());
+    }
+    std::sort(tri_ids.begin(), tri_ids.end());
+    tri_ids.erase(std::unique(tri_ids.begin(), tri_ids.end()), tri_ids.end());
 
-        Point_3f pf;
-        Point_3 p;
-        if (state.use_onering_projection) {//we have to use exact construction here. Or the projecting points may be not exactly on the plane.
-            std::vector<Triangle_3> tris;
-            for (int i = 0; i < tri_ids.size(); i++) {
-                tris.push_back(Triangle_3(tet_vertices[tri_ids[i][0]].pos, tet_vertices[tri_ids[i][1]].pos,
-                                          tet_vertices[tri_ids[i][2]].pos));
-            }
+    Point_3f pf;
+    Point_3 p;
+    if (state.use_onering_projection) {//we have to use exact construction here. Or the projecting points may be not exactly on the plane.
+        std::vector<Triangle_3> tris;
+        for (int i = 0; i < tri_ids.size(); i++) {
+            tris.push_back(Triangle_3(Point_3(tet_vertices[tri_ids[i][0]].pos),
+                                      Point_3(tet_vertices[tri_ids[i][1]].pos),
+                                      Point_3(tet_vertices[tri_ids[i][2]].pos)));
+        }
 
-            is_valid = false;
-            for (int i = 0; i < tris.size(); i++) {
-                if (tris[i].is_degenerate())
-                    continue;
-                Plane_3 pln = tris[i].supporting_plane();
-                p = pln.projection(p_out);
-                if (tris[i].has_on(p)) {
-                    is_valid = true;
-                    break;
-                }
-            }
-            if (!is_valid)
+        is_valid = false;
+        for (int i = 0; i < tris.size(); i++) {
+            if (tris[i].is_degenerate())
                 continue;
-            pf = Point_3f(CGAL::to_double(p[0]), CGAL::to_double(p[1]), CGAL::to_double(p[2]));
-            p = Point_3(pf[0], pf[1], pf[2]);
-        } else {
-            GEO::vec3 geo_pf(pf_out[0], pf_out[1], pf_out[2]);
-            GEO::vec3 nearest_pf;
-            double _;
-            if (tet_vertices[v_id].is_on_boundary)
-                geo_b_tree.nearest_facet(geo_pf, nearest_pf, _);
-            else
-                geo_sf_tree.nearest_facet(geo_pf, nearest_pf, _);
-            pf = Point_3f(nearest_pf[0], nearest_pf[1], nearest_pf[2]);
-            p = Point_3(nearest_pf[0], nearest_pf[1], nearest_pf[2]);
+            Plane_3 pln = tris[i].supporting_plane();
+            p = pln.projection(p_out);
+            if (tris[i].has_on(p)) {
+                is_valid = true;
+                break;
+            }
         }
+        if (!is_valid)
+            return false;
+        pf = Point_3f(CGAL::to_double(p[0]), CGAL::to_double(p[1]), CGAL::to_double(p[2]));
+        p = Point_3(pf[0], pf[1], pf[2]);
+    } else {
+        GEO::vec3 geo_pf(pf_out[0], pf_out[1], pf_out[2]);
+        GEO::vec3 nearest_pf;
+        double _;
+        if (tet_vertices[v_id].is_on_boundary)
+            geo_b_tree.nearest_facet(geo_pf, nearest_pf, _);
+        else
+            geo_sf_tree.nearest_facet(geo_pf, nearest_pf, _);
+        pf = Point_3f(nearest_pf[0], nearest_pf[1], nearest_pf[2]);
+        p = Point_3(nearest_pf[0], nearest_pf[1], nearest_pf[2]);
+    }
 #if TIMING_BREAKDOWN
-        breakdown_timing[id_project] += igl_timer.getElapsedTime();
+    breakdown_timing[id_project] += igl_timer.getElapsedTime();
 #endif
 
-        Point_3 old_p = tet_vertices[v_id].pos;
-        Point_3f old_pf = tet_vertices[v_id].posf;
-        std::vector<TetQuality> tet_qs;
-        bool is_found = false;
-
-        tet_vertices[v_id].posf = pf;
-        tet_vertices[v_id].pos = p;
-        if (isFlip(new_tets)) {
-            tet_vertices[v_id].pos = old_p;
-            tet_vertices[v_id].posf = old_pf;
-            continue;
-        }
-        TetQuality old_tq, new_tq;
-        getCheckQuality(old_t_ids, old_tq);
-        calTetQualities(new_tets, tet_qs);
-        getCheckQuality(tet_qs, new_tq);
-        if (!new_tq.isBetterThan(old_tq, energy_type, state)) {
-            tet_vertices[v_id].pos = old_p;
-            tet_vertices[v_id].posf = old_pf;
-            continue;
-        }
-        is_found = true;
+    HybridPoint_3 old_p = tet_vertices[v_id].pos;
+    Point_3f old_pf = tet_vertices[v_id].posf;
+    std::vector<TetQuality> tet_qs;
+    bool is_found = false;
+
+    tet_vertices[v_id].posf = pf;
+    tet_vertices[v_id].pos = p;
+    syncVertex(v_id);
+    if (isFlip(new_tets)) {
+        tet_vertices[v_id].pos = old_p;
+        tet_vertices[v_id].posf = old_pf;
+        syncVertex(v_id);
+        return false;
+    }
+    TetQuality old_tq, new_tq;
+    getCheckQuality(old_t_ids, old_tq);
+    calTetQualities(new_tets, tet_qs);
+    getCheckQuality(tet_qs, new_tq);
+    if (!new_tq.isBetterThan(old_tq, energy_type, state)) {
+        tet_vertices[v_id].pos = old_p;
+        tet_vertices[v_id].posf = old_pf;
+        syncVertex(v_id);
+        return false;
+    }
+    is_found = true;
 
-        if (!is_found) {
-            tet_vertices[v_id].pos = old_p;
-            tet_vertices[v_id].posf = old_pf;
-            continue;
-        }
+    if (!is_found) {
+        tet_vertices[v_id].pos = old_p;
+        tet_vertices[v_id].posf = old_pf;
+        syncVertex(v_id);
+        return false;
+    }
 
 #if TIMING_BREAKDOWN
-        igl_timer.start();
+    igl_timer.start();
 #endif
-        ///check if the boundary is sliding
-        if (tet_vertices[v_id].is_on_boundary) {
-            if (isBoundarySlide(v_id, -1, old_pf)) {
-                tet_vertices[v_id].pos = old_p;
-                tet_vertices[v_id].posf = old_pf;
+    ///check if the boundary is sliding
+    if (tet_vertices[v_id].is_on_boundary) {
+        if (isBoundarySlide(v_id, -1, old_pf)) {
+            tet_vertices[v_id].pos = old_p;
+            tet_vertices[v_id].posf = old_pf;
+            syncVertex(v_id);
 #if TIMING_BREAKDOWN
-                breakdown_timing[id_aabb] += igl_timer.getElapsedTime();
+            breakdown_timing[id_aabb] += igl_timer.getElapsedTime();
 #endif
-                continue;
-            }
+            return false;
         }
+    }
 
-        ///check if tris outside the envelop
-        std::vector<Triangle_3f> trisf;
-        for (int i = 0; i < tri_ids.size(); i++) {
-            auto jt = std::find(tri_ids[i].begin(), tri_ids[i].end(), v_id);
-            int k = jt - tri_ids[i].begin();
-            Triangle_3f tri(Point_3f(CGAL::to_double(p[0]), CGAL::to_double(p[1]), CGAL::to_double(p[2])),
-                            tet_vertices[tri_ids[i][(k + 1) % 3]].posf, tet_vertices[tri_ids[i][(k + 2) % 3]].posf);
-            if (!tri.is_degenerate())
-                trisf.push_back(tri);
-        }
-
-        is_valid = true;
-        for (int i = 0; i < trisf.size(); i++) {
-            if (isFaceOutEnvelop(trisf[i])) {
-                is_valid = false;
-                break;
-            }
-        }
+    ///check if tris outside the envelop
+    std::vector<Triangle_3f> trisf;
+    for (int i = 0; i < tri_ids.size(); i++) {
+        auto jt = std::find(tri_ids[i].begin(), tri_ids[i].end(), v_id);
+        int k = jt - tri_ids[i].begin();
+        Triangle_3f tri(Point_3f(CGAL::to_double(p[0]), CGAL::to_double(p[1]), CGAL::to_double(p[2])),
+                        tet_vertices[tri_ids[i][(k + 1) % 3]].posf, tet_vertices[tri_ids[i][(k + 2) % 3]].posf);
+        if (!tri.is_degenerate())
+            trisf.push_back(tri);
+    }
+
+    is_valid = !isFacesOutEnvelop(trisf);
 #if TIMING_BREAKDOWN
-        breakdown_timing[id_aabb] += igl_timer.getElapsedTime();
+    breakdown_timing[id_aabb] += igl_timer.getElapsedTime();
 #endif
-        if (!is_valid) {
+    if (!is_valid) {
+        tet_vertices[v_id].pos = old_p;
+        tet_vertices[v_id].posf = old_pf;
+        syncVertex(v_id);
+        return false;
+    }
+
+    ///real update
+    if (!tet_vertices[v_id].is_rounded) {
+        tet_vertices[v_id].pos = Point_3(pf[0], pf[1], pf[2]);
+        if (isFlip(new_tets)) {
             tet_vertices[v_id].pos = old_p;
-            tet_vertices[v_id].posf = old_pf;
-            continue;
-        }
+            tet_vertices[v_id].is_rounded = false;
+        } else
+            tet_vertices[v_id].is_rounded = true;
+        syncVertex(v_id);
+    }
+    for (int i = 0; i < old_t_ids.size(); i++)
+        tet_qualities[old_t_ids[i]] = tet_qs[i];
 
-        ///real update
-        ///update timestamps
-        ts++;
-        for (auto it = tet_vertices[v_id].conn_tets.begin(); it != tet_vertices[v_id].conn_tets.end(); it++)
-            tets_tss[*it] = ts;
-        tet_vertices_tss[v_id] = ts;
+    return true;
+}
 
-        if (!tet_vertices[v_id].is_rounded) {
-            tet_vertices[v_id].pos = Point_3(pf[0], pf[1], pf[2]);
-            if (isFlip(new_tets)) {
-                tet_vertices[v_id].pos = old_p;
-                tet_vertices[v_id].is_rounded = false;
-            } else
-                tet_vertices[v_id].is_rounded = true;
+void VertexSmoother::smoothVertices(const std::vector<int>& v_ids, bool is_surface, std::vector<int>& suc_v_ids) {
+    suc_v_ids.clear();
+    int num_threads = getNumThreads(args.num_threads);
+    if (num_threads <= 1) {
+        for (int v_id : v_ids) {
+            if (is_surface ? smoothSurfaceVertex(v_id) : smoothInteriorVertex(v_id))
+                suc_v_ids.push_back(v_id);
+        }
+        return;
+    }
+
+    evaluateExactCoordinates();
+
+    //every thread works on its own copy to keep separate timers and counters
+    std::vector<VertexSmoother> workers(num_threads, VertexSmoother(LocalOperations(*this)));
+    std::vector<std::vector<int>> v_sets = getIndependentSets(v_ids);
+    logger().debug("{} vertices split into {} independent sets", v_ids.size(), v_sets.size());
+
+    std::vector<char> is_suc;
+    for (const auto& v_set : v_sets) {
+        is_suc.assign(v_set.size(), false);
+        parallelFor((int) v_set.size(), num_threads, [&](int i, int thread_id) {
+            VertexSmoother& worker = workers[thread_id];
+            int v_id = v_set[i];
+            is_suc[i] = is_surface ? worker.smoothSurfaceVertex(v_id) : worker.smoothInteriorVertex(v_id);
+            //no other vertex of this set shares a tet with v_id, so its coordinates are only touched here
+            for (int t_id : tet_vertices[v_id].conn_tets) {
+                if (!isTetRounded(t_id)) {
+                    tet_vertices[v_id].pos.evaluateExact();
+                    break;
+                }
+            }
+        });
+        for (int i = 0; i < v_set.size(); i++) {
+            if (is_suc[i])
+                suc_v_ids.push_back(v_set[i]);
         }
-        for (int i = 0; i < old_t_ids.size(); i++)
-            tet_qualities[old_t_ids[i]] = tet_qs[i];
+    }
 
-        suc_counter++;
-        sf_suc_counter++;
-        if (sf_suc_counter % 1000 == 0)
-            logger().debug("1000 accepted!");
+    for (const auto& worker : workers) {
+        for (int i = 0; i < breakdown_timing.size(); i++)
+            breakdown_timing[i] += worker.breakdown_timing[i];
     }
-    logger().debug("Totally {}({}) vertices on surface are smoothed.", sf_suc_counter, sf_counter);
+}
+
+std::vector<std::vector<int>> VertexSmoother::getIndependentSets(const std::vector<int>& v_ids) {
+    //greedy coloring: two vertices get different colors as soon as they share a tet
+    std::vector<int> colors(tet_vertices.size(), -1);
+    std::vector<std::vector<int>> v_sets;
+    std::vector<bool> is_used;
+    for (int v_id : v_ids) {
+        is_used.assign(v_sets.size() + 1, false);
+        for (int t_id : tet_vertices[v_id].conn_tets) {
+            for (int j = 0; j < 4; j++) {
+                if (colors[tets[t_id][j]] >= 0)
+                    is_used[colors[tets[t_id][j]]] = true;
+            }
+        }
+        int c = std::find(is_used.begin(), is_used.end(), false) - is_used.begin();
+        if (c == v_sets.size())
+            v_sets.emplace_back();
+        colors[v_id] = c;
+        v_sets[c].push_back(v_id);
+    }
+    return v_sets;
 }
 
 bool VertexSmoother::NewtonsMethod(const std::vector<int>& t_ids, const std::vector<std::array<int, 4>>& new_tets,
@@ -469,7 +571,7 @@ bool VertexSmoother::NewtonsMethod(const std::vector<int>& t_ids, const std::vec
     const int MAX_STEP = 15;
     const int MAX_IT = 20;
     Point_3f pf0 = tet_vertices[v_id].posf;
-    Point_3 p0 = tet_vertices[v_id].pos;
+    HybridPoint_3 p0 = tet_vertices[v_id].pos;
 
     double old_energy = 0;
     Eigen::Vector3d J;
@@ -479,7 +581,7 @@ bool VertexSmoother::NewtonsMethod(const std::vector<int>& t_ids, const std::vec
         if (NewtonsUpdate(t_ids, v_id, old_energy, J, H, X0) == false)
             break;
         Point_3f old_pf = tet_vertices[v_id].posf;
-        Point_3 old_p = tet_vertices[v_id].pos;
+        HybridPoint_3 old_p = tet_vertices[v_id].pos;
         double a = 1;
         bool step_taken = false;
         double new_energy = std::numeric_limits<double>::infinity();
@@ -498,12 +600,14 @@ bool VertexSmoother::NewtonsMethod(const std::vector<int>& t_ids, const std::vec
 
             tet_vertices[v_id].posf = Point_3f(X(0), X(1), X(2));
             tet_vertices[v_id].pos = Point_3(X(0), X(1), X(2));
+            syncVertex(v_id);
 //            tet_vertices[v_id].is_rounded=true;//need to remember old value?
 
             //check flipping
             if (isFlip(new_tets)) {
                 tet_vertices[v_id].posf = old_pf;
                 tet_vertices[v_id].pos = old_p;
+                syncVertex(v_id);
                 a /= 2.0;
                 continue;
             }
@@ -515,6 +619,7 @@ bool VertexSmoother::NewtonsMethod(const std::vector<int>& t_ids, const std::vec
             if (new_energy >= old_energy || std::isinf(new_energy) || std::isnan(new_energy)) {
                 tet_vertices[v_id].posf = old_pf;
                 tet_vertices[v_id].pos = old_p;
+                syncVertex(v_id);
                 a /= 2.0;
                 continue;
             }
@@ -537,6 +642,7 @@ bool VertexSmoother::NewtonsMethod(const std::vector<int>& t_ids, const std::vec
     p = tet_vertices[v_id].posf;
     tet_vertices[v_id].posf = pf0;
     tet_vertices[v_id].pos = p0;
+    syncVertex(v_id);
 
     return is_moved;
 }
@@ -604,15 +710,25 @@ double VertexSmoother::getNewEnergy(const std::vector<int>& t_ids) {
         s_energy += energy[i]; //s_energy intialized in the beginning
     }
 #else
-    for (int i = 0; i < t_ids.size(); i++) {
-        std::array<double, 12> t;
-        for (int j = 0; j < 4; j++) {
-            for (int k = 0; k < 3; k++) {
-                t[j*3 + k] = tet_vertices[tets[t_ids[i]][j]].posf[k];
+    if (energy_type == state.ENERGY_AMIPS) {
+        int n = t_ids.size();
+        static thread_local TetCoordBatch batch;
+        static thread_local std::vector<double> energy;
+        batch.resize(n);
+        energy.resize(n);
+
+        const TetVertexSoA& vs = *vertex_soa;
+        for (int i = 0; i < n; i++) {
+            for (int j = 0; j < 4; j++) {
+                int v_id = tets[t_ids[i]][j];
+                batch.set(i, j * 3, vs.x[v_id]);
+                batch.set(i, j * 3 + 1, vs.y[v_id]);
+                batch.set(i, j * 3 + 2, vs.z[v_id]);
             }
         }
-        if (energy_type == state.ENERGY_AMIPS) {
-            s_energy += comformalAMIPSEnergy_new(t.data());
+        comformalAMIPSEnergyBatch(batch, energy.data());
+        for (int i = 0; i < n; i++) {
+            s_energy += energy[i];
         }
     }
 #endif
@@ -635,8 +751,14 @@ bool VertexSmoother::NewtonsUpdate(const std::vector<int>& t_ids, int v_id,
         X0(i) = tet_vertices[v_id].posf[i];
     }
 
-    for (int i = 0; i < t_ids.size(); i++) {
-        std::array<double, 12> t;
+    //gather the one ring, rotated so that v_id is the first vertex of each tet
+    int n = t_ids.size();
+    static thread_local TetCoordBatch batch;
+    static thread_local std::vector<double> values;
+    batch.resize(n);
+    values.resize(13 * n);
+    const TetVertexSoA& vs = *vertex_soa;
+    for (int i = 0; i < n; i++) {
         int start = 0;
         for (int j = 0; j < 4; j++) {
             if (tets[t_ids[i]][j] == v_id) {
@@ -645,30 +767,42 @@ bool VertexSmoother::NewtonsUpdate(const std::vector<int>& t_ids, int v_id,
             }
         }
         for (int j = 0; j < 4; j++) {
-            for (int k = 0; k < 3; k++) {
-                t[j*3+k] = tet_vertices[tets[t_ids[i]][(start + j) % 4]].posf[k];
-            }
+            int n_v_id = tets[t_ids[i]][(start + j) % 4];
+            batch.set(i, j * 3, vs.x[n_v_id]);
+            batch.set(i, j * 3 + 1, vs.y[n_v_id]);
+            batch.set(i, j * 3 + 2, vs.z[n_v_id]);
         }
+    }
+    double *E_1 = values.data();
+    std::array<double *, 3> J_1;
+    std::array<double *, 9> H_1;
+    for (int k = 0; k < 3; k++)
+        J_1[k] = values.data() + (1 + k) * n;
+    for (int k = 0; k < 9; k++)
+        H_1[k] = values.data() + (4 + k) * n;
+
 #ifndef TETWILD_WITH_ISPC
-        igl_timer.start();
-        energy += comformalAMIPSEnergy_new(t.data());
-        breakdown_timing[id_value_e] += igl_timer.getElapsedTime();
+    igl_timer.start();
+    comformalAMIPSEnergyBatch(batch, E_1);
+    breakdown_timing[id_value_e] += igl_timer.getElapsedTime();
 #endif
+    igl_timer.start();
+    comformalAMIPSJacobianBatch(batch, J_1);
+    breakdown_timing[id_value_j] += igl_timer.getElapsedTime();
+    igl_timer.start();
+    comformalAMIPSHessianBatch(batch, H_1);
+    breakdown_timing[id_value_h] += igl_timer.getElapsedTime();
 
-        double J_1[3];
-        double H_1[9];
-        igl_timer.start();
-        comformalAMIPSJacobian_new(t.data(), J_1);
-        breakdown_timing[id_value_j] += igl_timer.getElapsedTime();
-        igl_timer.start();
-        comformalAMIPSHessian_new(t.data(), H_1);
-        breakdown_timing[id_value_h] += igl_timer.getElapsedTime();
-
+    //accumulate in the same order as the per tet evaluation did
+    for (int i = 0; i < n; i++) {
+#ifndef TETWILD_WITH_ISPC
+        energy += E_1[i];
+#endif
         for (int j = 0; j < 3; j++) {
-            J(j) += J_1[j];
-            H(j, 0) += H_1[j * 3 + 0];
-            H(j, 1) += H_1[j * 3 + 1];
-            H(j, 2) += H_1[j * 3 + 2];
+            J(j) += J_1[j][i];
+            H(j, 0) += H_1[j * 3 + 0][i];
+            H(j, 1) += H_1[j * 3 + 1][i];
+            H(j, 2) += H_1[j * 3 + 2][i];
         }
     }
 #ifdef TETWILD_WITH_ISPC
@@ -703,6 +837,7 @@ bool VertexSmoother::NewtonsUpdate(const std::vector<int>& t_ids, int v_id,
 
 int VertexSmoother::laplacianBoundary(const std::vector<int>& b_v_ids, const std::vector<bool>& tmp_is_on_surface,
                                       const std::vector<bool>& tmp_t_is_removed){
+    refreshVertexSoA();
     int cnt_suc = 0;
     double max_slim_evergy = 0;
     for(unsigned int i=0;i<tet_qualities.size();i++) {
@@ -761,7 +896,7 @@ int VertexSmoother::laplacianBoundary(const std::vector<int>& b_v_ids, const std
         }
 
         // do bisection and check flipping
-        Point_3 old_p = tet_vertices[v_id].pos;
+        HybridPoint_3 old_p = tet_vertices[v_id].pos;
         Point_3f old_pf = tet_vertices[v_id].posf;
         double a = 1;
         bool is_suc = false;
@@ -775,6 +910,7 @@ int VertexSmoother::laplacianBoundary(const std::vector<int>& b_v_ids, const std
                 break;
             tet_vertices[v_id].pos = Point_3(old_pf[0] + vec[0] * a, old_pf[1] + vec[1] * a, old_pf[2] + vec[2] * a);
             tet_vertices[v_id].posf = Point_3f(old_pf[0] + vec[0] * a, old_pf[1] + vec[1] * a, old_pf[2] + vec[2] * a);
+            syncVertex(v_id);
             if (isFlip(new_tets)) {
                 a /= 2;
                 continue;
@@ -804,6 +940,7 @@ int VertexSmoother::laplacianBoundary(const std::vector<int>& b_v_ids, const std
         if(!is_suc) {
             tet_vertices[v_id].pos = old_p;
             tet_vertices[v_id].posf = old_pf;
+            syncVertex(v_id);
             continue;
         }
 
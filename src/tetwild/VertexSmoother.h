@@ -25,6 +25,14 @@ public:
     bool smoothSingleVertex(int v_id, bool is_cal_energy);
     void smoothSurface();
 
+    // Smooth a single interior/surface vertex, returns false if the vertex has not been processed
+    bool smoothInteriorVertex(int v_id);
+    bool smoothSurfaceVertex(int v_id);
+    // Smooth the given vertices in order, or in parallel by independent sets if args.num_threads != 1
+    void smoothVertices(const std::vector<int>& v_ids, bool is_surface, std::vector<int>& suc_v_ids);
+    // Partition the given vertices into sets of vertices that do not share any tet
+    std::vector<std::vector<int>> getIndependentSets(const std::vector<int>& v_ids);
+
     bool NewtonsMethod(const std::vector<int>& t_ids, const std::vector<std::array<int, 4>>& new_tets, int v_id, Point_3f& p);
     bool NewtonsUpdate(const std::vector<int>& t_ids, int v_id, double& energy, Eigen::Vector3d& J, Eigen::Matrix3d& H, Eigen::Vector3d& X0);
     double getNewEnergy(const std::vector<int>& t_ids);
@@ -0,0 +1,194 @@
+// This file is part of TetWild, a software for generating tetrahedral meshes.
+//
+// This Source Code Form is subject to the terms of the Mozilla Public License
+// v. 2.0. If a copy of the MPL was not distributed with this file, You can
+// obtain one at http://mozilla.org/MPL/2.0/.
+//
+
+#include <tetwild/WindingNumber.h>
+#include <tetwild/Parallel.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace tetwild {
+
+namespace {
+
+typedef std::array<double, 3> Vec3;
+
+inline Vec3 sub(const Vec3& a, const Vec3& b) {
+    return {{a[0] - b[0], a[1] - b[1], a[2] - b[2]}};
+}
+
+inline double dot(const Vec3& a, const Vec3& b) {
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+inline Vec3 cross(const Vec3& a, const Vec3& b) {
+    return {{a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0]}};
+}
+
+inline double norm(const Vec3& a) {
+    return std::sqrt(dot(a, a));
+}
+
+} // anonymous namespace
+
+WindingNumber::WindingNumber(const Eigen::MatrixXd& V, const Eigen::MatrixXi& F, double beta)
+    : m_beta(beta)
+{
+    m_triangles.resize(F.rows());
+    m_f_ids.resize(F.rows());
+    for (int i = 0; i < F.rows(); i++) {
+        for (int j = 0; j < 3; j++) {
+            for (int k = 0; k < 3; k++)
+                m_triangles[i][j][k] = V(F(i, j), k);
+        }
+        m_f_ids[i] = i;
+    }
+    if (F.rows() > 0) {
+        m_nodes.reserve(2 * (F.rows() / MAX_LEAF_SIZE + 1));
+        build(0, F.rows());
+    }
+}
+
+int WindingNumber::build(int begin, int end) {
+    int n_id = m_nodes.size();
+    m_nodes.push_back(Node());
+
+    ///dipole of the triangles
+    Vec3 center = {{0, 0, 0}}, mean = {{0, 0, 0}}, area_normal = {{0, 0, 0}};
+    double area = 0;
+    Vec3 c_min, c_max;
+    c_min.fill(std::numeric_limits<double>::max());
+    c_max.fill(-std::numeric_limits<double>::max());
+    for (int i = begin; i < end; i++) {
+        const auto& tri = m_triangles[m_f_ids[i]];
+        Vec3 n = cross(sub(tri[1], tri[0]), sub(tri[2], tri[0]));
+        double a = 0.5 * norm(n);
+        for (int k = 0; k < 3; k++) {
+            double c = (tri[0][k] + tri[1][k] + tri[2][k]) / 3;
+            center[k] += a * c;
+            mean[k] += c;
+            area_normal[k] += 0.5 * n[k];
+            c_min[k] = std::min(c_min[k], c);
+            c_max[k] = std::max(c_max[k], c);
+        }
+        area += a;
+    }
+    for (int k = 0; k < 3; k++)
+        center[k] = area > 0 ? center[k] / area : mean[k] / (end - begin);
+    double radius = 0;
+    std::array<double, 9> moment;
+    moment.fill(0);
+    for (int i = begin; i < end; i++) {
+        const auto& tri = m_triangles[m_f_ids[i]];
+        for (const auto& p : tri)
+            radius = std::max(radius, norm(sub(p, center)));
+        Vec3 n = cross(sub(tri[1], tri[0]), sub(tri[2], tri[0]));
+        for (int k = 0; k < 3; k++) {
+            double d = (tri[0][k] + tri[1][k] + tri[2][k]) / 3 - center[k];
+            for (int l = 0; l < 3; l++)
+                moment[3 * k + l] += d * 0.5 * n[l];
+        }
+    }
+    m_nodes[n_id].center = center;
+    m_nodes[n_id].area_normal = area_normal;
+    m_nodes[n_id].moment = moment;
+    m_nodes[n_id].radius = radius;
+    m_nodes[n_id].area = area;
+    m_nodes[n_id].begin = begin;
+    m_nodes[n_id].end = end;
+    m_nodes[n_id].children[0] = m_nodes[n_id].children[1] = -1;
+    if (end - begin <= MAX_LEAF_SIZE)
+        return n_id;
+
+    ///split at the median centroid along the longest axis
+    int axis = 0;
+    for (int k = 1; k < 3; k++) {
+        if (c_max[k] - c_min[k] > c_max[axis] - c_min[axis])
+            axis = k;
+    }
+    int mid = (begin + end) / 2;
+    std::nth_element(m_f_ids.begin() + begin, m_f_ids.begin() + mid, m_f_ids.begin() + end, [&](int a, int b) {
+        const auto& ta = m_triangles[a];
+        const auto& tb = m_triangles[b];
+        return ta[0][axis] + ta[1][axis] + ta[2][axis] < tb[0][axis] + tb[1][axis] + tb[2][axis];
+    });
+    int left = build(begin, mid);
+    int right = build(mid, end);
+    m_nodes[n_id].children[0] = left;
+    m_nodes[n_id].children[1] = right;
+    return n_id;
+}
+
+double WindingNumber::solidAngle(int f_id, const std::array<double, 3>& q) const {
+    //van Oosterom and Strackee, as in igl::solid_angle()
+    const auto& tri = m_triangles[f_id];
+    Vec3 a = sub(tri[0], q);
+    Vec3 b = sub(tri[1], q);
+    Vec3 c = sub(tri[2], q);
+    double la = norm(a), lb = norm(b), lc = norm(c);
+    double det = dot(a, cross(b, c));
+    double denom = la * lb * lc + dot(a, b) * lc + dot(b, c) * la + dot(c, a) * lb;
+    return 2 * std::atan2(det, denom);
+}
+
+double WindingNumber::evaluate(const std::array<double, 3>& q, double max_error) const {
+    if (m_nodes.empty())
+        return 0;
+
+    //the nodes replaced by their expansions are disjoint, so their errors add up to at most max_error
+    const double total_area = m_nodes[0].area;
+    double w = 0;
+    std::vector<int> stack;
+    stack.reserve(64);
+    stack.push_back(0);
+    while (!stack.empty()) {
+        const Node& node = m_nodes[stack.back()];
+        stack.pop_back();
+        Vec3 d = sub(node.center, q);
+        double dist = norm(d);
+        double gap = dist - node.radius;
+        if (dist > m_beta * node.radius
+            && 3 * node.radius * node.radius * node.area * total_area
+               <= max_error * node.area * 4 * M_PI * gap * gap * gap * gap) {
+            //(d + x).n / |d + x|^3 expanded to the first order in x, the offset of each triangle to the center. The
+            //remainder is a third derivative of 1 / |d + x|, whose norm is at most 3! / |d + x|^4, times |x|^2 / 2
+            double dist2 = dist * dist;
+            double dist3 = dist2 * dist;
+            const auto& m = node.moment;
+            double trace = m[0] + m[4] + m[8];
+            double dmd = 0;
+            for (int k = 0; k < 3; k++)
+                dmd += d[k] * (m[3 * k] * d[0] + m[3 * k + 1] * d[1] + m[3 * k + 2] * d[2]);
+            w += dot(d, node.area_normal) / dist3 + trace / dist3 - 3 * dmd / (dist3 * dist2);
+            continue;
+        }
+        if (node.children[0] < 0) {
+            for (int i = node.begin; i < node.end; i++)
+                w += solidAngle(m_f_ids[i], q);
+            continue;
+        }
+        stack.push_back(node.children[0]);
+        stack.push_back(node.children[1]);
+    }
+    return w / (4 * M_PI);
+}
+
+void WindingNumber::evaluate(const Eigen::MatrixXd& Q, Eigen::VectorXd& W, int num_threads, double max_error) const {
+    const double MIN_ERROR = 1e-8; //below it, all the nodes are opened
+    W.resize(Q.rows());
+    parallelFor(Q.rows(), num_threads, [&](int i, int thread_id) {
+        std::array<double, 3> q = {{Q(i, 0), Q(i, 1), Q(i, 2)}};
+        double error = max_error;
+        W(i) = evaluate(q, error);
+        while (error > 0 && std::abs(W(i) - 0.5) <= error) {
+            error = error > MIN_ERROR ? error / 16 : 0;
+            W(i) = evaluate(q, error);
+        }
+    }, 64);
+}
+
+} // namespace tetwild
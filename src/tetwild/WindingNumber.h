@@ -0,0 +1,68 @@
+// This file is part of TetWild, a software for generating tetrahedral meshes.
+//
+// This Source Code Form is subject to the terms of the Mozilla Public License
+// v. 2.0. If a copy of the MPL was not distributed with this file, You can
+// obtain one at http://mozilla.org/MPL/2.0/.
+//
+
+#pragma once
+
+#include <Eigen/Dense>
+#include <array>
+#include <vector>
+
+namespace tetwild {
+
+///
+/// @brief      { Generalized winding number of a triangle mesh, evaluated with a bounding volume hierarchy. The
+///             triangles of a node far enough from the query point are replaced by the first order (dipole) expansion
+///             of their solid angles around their area-weighted centroid. Closer nodes are opened, down to the solid
+///             angles of the triangles in the leaves. A node is far enough when it is farther than beta times its
+///             radius R and when the truncation error of its expansion, at most 3 R^2 A / (4 pi (d - R)^4) for a
+///             distance d and an area A, is below its share of the error allowed to the query. }
+///
+class WindingNumber {
+public:
+    WindingNumber(const Eigen::MatrixXd& V, const Eigen::MatrixXi& F, double beta = 2.0);
+
+    ///
+    /// @brief      { Winding number at a point, up to max_error (and to the rounding errors). With a max_error of 0,
+    ///             it is the sum of the solid angles of all the triangles. }
+    ///
+    double evaluate(const std::array<double, 3>& q, double max_error) const;
+
+    ///
+    /// @brief      { Winding numbers at a set of points, in parallel. The points whose value is within the error bound
+    ///             from 0.5 are evaluated again with smaller bounds until they are not, so that inside/outside tests
+    ///             with a threshold of 0.5 give the same result as the sum over all the triangles. }
+    ///
+    /// @param[in]  Q              { #Q x 3 query points }
+    /// @param[out] W              { #Q winding numbers }
+    /// @param[in]  num_threads    { Number of threads (see getNumThreads()) }
+    /// @param[in]  max_error      { Error bound of the first evaluation of each point }
+    ///
+    void evaluate(const Eigen::MatrixXd& Q, Eigen::VectorXd& W, int num_threads, double max_error = 0.25) const;
+
+private:
+    struct Node {
+        std::array<double, 3> center;
+        std::array<double, 3> area_normal; //sum of the area vectors of the triangles
+        std::array<double, 9> moment; //sum of (centroid - center) * area vector^T, row-major
+        double radius;
+        double area; //sum of the areas of the triangles
+        int children[2]; //-1 for leaves
+        int begin, end; //range of triangles in f_ids
+    };
+
+    static const int MAX_LEAF_SIZE = 8;
+
+    int build(int begin, int end);
+    double solidAngle(int f_id, const std::array<double, 3>& q) const;
+
+    double m_beta;
+    std::vector<std::array<std::array<double, 3>, 3>> m_triangles;
+    std::vector<int> m_f_ids;
+    std::vector<Node> m_nodes;
+};
+
+} // namespace tetwild
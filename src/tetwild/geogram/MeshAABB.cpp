@@ -49,6 +49,7 @@
 #include <geogram/mesh/mesh_repair.h>
 #include <geogram/numerics/predicates.h>
 #include <geogram/basic/geometry_nd.h>
+#include <limits>
 
 namespace {
 
@@ -354,7 +355,7 @@ namespace {
 namespace GEO {
 
     MeshFacetsAABBWithEps::MeshFacetsAABBWithEps(
-        Mesh& M, bool reorder
+        Mesh& M, bool reorder, bool use_wide_bvh
     ) :
         mesh_(M) {
         if(!M.facets.are_simplices()) {
@@ -376,12 +377,19 @@ namespace GEO {
         init_bboxes_recursive(
             mesh_, bboxes_, 1, 0, mesh_.facets.nb(), get_facet_bbox
         );
+        if(use_wide_bvh) {
+            wide_bvh_.reset(new MeshFacetsWideBVH(mesh_));
+        }
     }
 
     void MeshFacetsAABBWithEps::get_nearest_facet_hint(
         const vec3& p,
         index_t& nearest_f, vec3& nearest_point, double& sq_dist
     ) const {
+        if(wide_bvh_) {
+            wide_bvh_->get_nearest_facet_hint(p, nearest_f, nearest_point, sq_dist);
+            return;
+        }
 
         // Find a good initial value for nearest_f by traversing
         // the boxes and selecting the child such that the center
@@ -547,6 +555,142 @@ namespace GEO {
         }
     }
 
+    bool MeshFacetsAABBWithEps::points_in_envelope(
+        const std::vector<vec3>& points, double sq_epsilon
+    ) const {
+        if(points.empty()) {
+            return true;
+        }
+
+        // Single query for the first point, its nearest facet is then
+        // tried on the others: samples of the same surface patch
+        // are usually all within the envelope of that facet.
+        index_t hint_f = NO_FACET;
+        vec3 nearest_point;
+        double sq_dist = std::numeric_limits<double>::max();
+        facet_in_envelope_with_hint(
+            points[0], sq_epsilon, hint_f, nearest_point, sq_dist
+        );
+        if(sq_dist > sq_epsilon) {
+            return false;
+        }
+
+        struct Entry {
+            index_t n, b, e;
+            // range of the points of the packet in packet_points
+            index_t begin, size;
+        };
+        static thread_local std::vector<Entry> stack;
+        static thread_local std::vector<index_t> packet_points;
+        static thread_local std::vector<index_t> cur_points, points_l, points_r;
+        // number of entries of the stack that hold the point, the point
+        // is outside if it drops to zero before a facet is found
+        static thread_local std::vector<index_t> nb_pending;
+        static thread_local std::vector<bool> is_inside;
+        stack.clear();
+        packet_points.clear();
+        nb_pending.assign(points.size(), 0);
+        is_inside.assign(points.size(), false);
+
+        index_t nb_facets = mesh_.facets.nb();
+        for(index_t i = 1; i < points.size(); ++i) {
+            get_point_facet_nearest_point(
+                mesh_, points[i], hint_f, nearest_point, sq_dist
+            );
+            if(sq_dist <= sq_epsilon) {
+                continue;
+            }
+            if(point_box_signed_squared_distance(points[i], bboxes_[1]) > sq_epsilon) {
+                return false;
+            }
+            packet_points.push_back(i);
+            nb_pending[i] = 1;
+        }
+        if(packet_points.empty()) {
+            return true;
+        }
+        if(wide_bvh_) {
+            return wide_bvh_->points_in_envelope(points, packet_points, sq_epsilon);
+        }
+        stack.push_back({1, 0, nb_facets, 0, index_t(packet_points.size())});
+
+        while(!stack.empty()) {
+            Entry entry = stack.back();
+            stack.pop_back();
+            // the points of the top entry are always at the end of packet_points
+            cur_points.assign(
+                packet_points.begin() + entry.begin,
+                packet_points.begin() + entry.begin + entry.size
+            );
+            packet_points.resize(entry.begin);
+
+            if(entry.b + 1 == entry.e) {
+                for(index_t i : cur_points) {
+                    if(is_inside[i]) {
+                        continue;
+                    }
+                    get_point_facet_nearest_point(
+                        mesh_, points[i], entry.b, nearest_point, sq_dist
+                    );
+                    if(sq_dist <= sq_epsilon) {
+                        is_inside[i] = true;
+                    } else if(--nb_pending[i] == 0) {
+                        return false;
+                    }
+                }
+                continue;
+            }
+
+            index_t m = entry.b + (entry.e - entry.b) / 2;
+            index_t childl = 2 * entry.n;
+            index_t childr = 2 * entry.n + 1;
+            points_l.clear();
+            points_r.clear();
+            double sum_dl = 0.0;
+            double sum_dr = 0.0;
+            for(index_t i : cur_points) {
+                if(is_inside[i]) {
+                    continue;
+                }
+                nb_pending[i]--;
+                double dl = point_box_signed_squared_distance(points[i], bboxes_[childl]);
+                double dr = point_box_signed_squared_distance(points[i], bboxes_[childr]);
+                if(dl <= sq_epsilon) {
+                    points_l.push_back(i);
+                    nb_pending[i]++;
+                    sum_dl += dl;
+                }
+                if(dr <= sq_epsilon) {
+                    points_r.push_back(i);
+                    nb_pending[i]++;
+                    sum_dr += dr;
+                }
+                if(nb_pending[i] == 0) {
+                    return false;
+                }
+            }
+
+            // Traverse the child that is the nearest to the packet (on
+            // average) first, it is pushed last.
+            bool is_l_first =
+                sum_dl * double(points_r.size()) < sum_dr * double(points_l.size());
+            for(index_t k = 0; k < 2; ++k) {
+                bool is_l = (k == 0) != is_l_first;
+                const std::vector<index_t>& child_points = is_l ? points_l : points_r;
+                if(child_points.empty()) {
+                    continue;
+                }
+                stack.push_back({
+                    is_l ? childl : childr, is_l ? entry.b : m, is_l ? m : entry.e,
+                    index_t(packet_points.size()), index_t(child_points.size())
+                });
+                packet_points.insert(
+                    packet_points.end(), child_points.begin(), child_points.end()
+                );
+            }
+        }
+        return true;
+    }
 
     bool MeshFacetsAABBWithEps::segment_intersection(const vec3& q1, const vec3& q2) const {
         return segment_intersection_recursive(q1, q2, 1, 0, mesh_.facets.nb());
@@ -53,6 +53,9 @@
 #include <geogram/basic/common.h>
 #include <geogram/mesh/mesh.h>
 #include <geogram/basic/geometry.h>
+#include <tetwild/geogram/MeshWideBVH.h>
+#include <memory>
+#include <vector>
 
 namespace GEO {
 
@@ -72,9 +75,14 @@ namespace GEO {
          * \param[in] reorder if not set, Morton re-ordering is
          *  skipped (but it means that mesh_reorder() was previously
          *  called else the algorithm will be pretty unefficient).
+         * \param[in] use_wide_bvh if set, nearest facet and envelope
+         *  queries (nearest_facet(), facet_in_envelope(),
+         *  squared_distance(), point_in_envelope() and their variants)
+         *  use a 4-wide tree with SIMD box tests (see MeshFacetsWideBVH)
+         *  instead of the binary one. Results are the same.
          * \pre M.facets.are_simplices()
          */
-        MeshFacetsAABBWithEps(Mesh& M, bool reorder = true);
+        MeshFacetsAABBWithEps(Mesh& M, bool reorder = true, bool use_wide_bvh = false);
 
         /**
          * \brief Computes all the pairs of intersecting facets.
@@ -132,6 +140,10 @@ namespace GEO {
         ) const {
             index_t nearest_facet;
             get_nearest_facet_hint(p, nearest_facet, nearest_point, sq_dist);
+            if(wide_bvh_) {
+                wide_bvh_->nearest_facet(p, nearest_facet, nearest_point, sq_dist);
+                return nearest_facet;
+            }
             nearest_facet_recursive(
                 p,
                 nearest_facet, nearest_point, sq_dist,
@@ -168,6 +180,10 @@ namespace GEO {
                     p, nearest_facet, nearest_point, sq_dist
                 );
             }
+            if(wide_bvh_) {
+                wide_bvh_->nearest_facet(p, nearest_facet, nearest_point, sq_dist);
+                return;
+            }
             nearest_facet_recursive(
                 p,
                 nearest_facet, nearest_point, sq_dist,
@@ -184,6 +200,10 @@ namespace GEO {
         ) const {
             index_t nearest_facet;
             get_nearest_facet_hint(p, nearest_facet, nearest_point, sq_dist);
+            if(wide_bvh_) {
+                wide_bvh_->facet_in_envelope(p, sq_epsilon, nearest_facet, nearest_point, sq_dist);
+                return nearest_facet;
+            }
             facet_in_envelope_recursive(
                 p, sq_epsilon,
                 nearest_facet, nearest_point, sq_dist,
@@ -205,6 +225,10 @@ namespace GEO {
                     p, nearest_facet, nearest_point, sq_dist
                 );
             }
+            if(wide_bvh_) {
+                wide_bvh_->facet_in_envelope(p, sq_epsilon, nearest_facet, nearest_point, sq_dist);
+                return;
+            }
             facet_in_envelope_recursive(
                 p, sq_epsilon,
                 nearest_facet, nearest_point, sq_dist,
@@ -212,6 +236,18 @@ namespace GEO {
             );
         }
 
+        /*
+         * Returns true if dist(p) <= eps for all the points. The points
+         * that are not close to the facet nearest to the first one are
+         * traversed as a single packet (e.g. the samples of a triangle, or
+         * of all the new faces of a local operation), and the query stops
+         * as soon as one of them is known to be outside. The packet walks
+         * the 4-wide tree when it was built.
+         */
+        bool points_in_envelope(
+            const std::vector<vec3>& points, double sq_epsilon
+        ) const;
+
         /**
          * \brief Computes the distance between an arbitrary 3d query
          *  point and the surface.
@@ -428,6 +464,8 @@ namespace GEO {
     protected:
         vector<Box> bboxes_;
         Mesh& mesh_;
+        // only used for the nearest facet queries, null unless requested at construction
+        std::unique_ptr<MeshFacetsWideBVH> wide_bvh_;
     };
 
 }
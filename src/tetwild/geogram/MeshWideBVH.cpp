@@ -0,0 +1,372 @@
+// This file is part of TetWild, a software for generating tetrahedral meshes.
+//
+// This Source Code Form is subject to the terms of the Mozilla Public License
+// v. 2.0. If a copy of the MPL was not distributed with this file, You can
+// obtain one at http://mozilla.org/MPL/2.0/.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <tetwild/geogram/MeshWideBVH.h>
+#include <geogram/mesh/mesh_geometry.h>
+#include <geogram/basic/geometry_nd.h>
+#include <algorithm>
+#include <limits>
+
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace GEO {
+
+    MeshFacetsWideBVH::MeshFacetsWideBVH(const Mesh& M) {
+        const index_t nb_facets = M.facets.nb();
+        points_.resize(3 * nb_facets);
+        for(index_t f = 0; f < nb_facets; ++f) {
+            geo_debug_assert(M.facets.nb_vertices(f) == 3);
+            index_t c = M.facets.corners_begin(f);
+            for(index_t lv = 0; lv < 3; ++lv) {
+                points_[3 * f + lv] = Geom::mesh_vertex(M, M.facet_corners.vertex(c + lv));
+            }
+        }
+        // a binary tree has nb_facets leaves, a 4-wide one about a third of that in inner nodes
+        nodes_.reserve(nb_facets / 3 + 1);
+        Box box;
+        build_recursive(0, nb_facets, box);
+    }
+
+    index_t MeshFacetsWideBVH::build_recursive(index_t b, index_t e, Box& box) {
+        // same splits as two levels of the binary tree, ranges small enough become leaves
+        index_t ranges[WIDTH][2];
+        index_t nb_ranges = 0;
+        if(e - b <= MAX_LEAF_SIZE) {
+            ranges[nb_ranges][0] = b;
+            ranges[nb_ranges][1] = e;
+            nb_ranges++;
+        } else {
+            index_t m = b + (e - b) / 2;
+            const index_t halves[2][2] = {{b, m}, {m, e}};
+            for(index_t h = 0; h < 2; ++h) {
+                index_t hb = halves[h][0];
+                index_t he = halves[h][1];
+                if(he - hb > MAX_LEAF_SIZE) {
+                    index_t hm = hb + (he - hb) / 2;
+                    ranges[nb_ranges][0] = hb;
+                    ranges[nb_ranges][1] = hm;
+                    nb_ranges++;
+                    ranges[nb_ranges][0] = hm;
+                    ranges[nb_ranges][1] = he;
+                    nb_ranges++;
+                } else {
+                    ranges[nb_ranges][0] = hb;
+                    ranges[nb_ranges][1] = he;
+                    nb_ranges++;
+                }
+            }
+        }
+
+        const index_t node_id = index_t(nodes_.size());
+        nodes_.push_back(Node());
+        for(index_t k = 0; k < WIDTH; ++k) {
+            for(coord_index_t c = 0; c < 3; ++c) {
+                nodes_[node_id].xyz_min[c][k] = std::numeric_limits<double>::max();
+                nodes_[node_id].xyz_max[c][k] = -std::numeric_limits<double>::max();
+            }
+            nodes_[node_id].child[k] = NO_CHILD;
+            nodes_[node_id].nb_facets[k] = 0;
+        }
+
+        for(index_t k = 0; k < nb_ranges; ++k) {
+            const index_t rb = ranges[k][0];
+            const index_t re = ranges[k][1];
+            Box child_box;
+            index_t child;
+            index_t nb_child_facets;
+            if(re - rb <= MAX_LEAF_SIZE) {
+                get_facets_bbox(rb, re, child_box);
+                child = rb;
+                nb_child_facets = re - rb;
+            } else {
+                child = build_recursive(rb, re, child_box);
+                nb_child_facets = 0;
+            }
+            // nodes_ may have been reallocated by the recursion
+            Node& node = nodes_[node_id];
+            for(coord_index_t c = 0; c < 3; ++c) {
+                node.xyz_min[c][k] = child_box.xyz_min[c];
+                node.xyz_max[c][k] = child_box.xyz_max[c];
+            }
+            node.child[k] = child;
+            node.nb_facets[k] = nb_child_facets;
+            if(k == 0) {
+                box = child_box;
+            } else {
+                bbox_union(box, box, child_box);
+            }
+        }
+        return node_id;
+    }
+
+    void MeshFacetsWideBVH::get_facets_bbox(index_t b, index_t e, Box& box) const {
+        for(coord_index_t c = 0; c < 3; ++c) {
+            box.xyz_min[c] = points_[3 * b][c];
+            box.xyz_max[c] = points_[3 * b][c];
+        }
+        for(index_t i = 3 * b; i < 3 * e; ++i) {
+            for(coord_index_t c = 0; c < 3; ++c) {
+                box.xyz_min[c] = std::min(box.xyz_min[c], points_[i][c]);
+                box.xyz_max[c] = std::max(box.xyz_max[c], points_[i][c]);
+            }
+        }
+    }
+
+    void MeshFacetsWideBVH::point_boxes_squared_distances(
+        const Node& node, const vec3& p, double* sq_dists
+    ) const {
+#if defined(__AVX__)
+        __m256d zero = _mm256_setzero_pd();
+        __m256d result = zero;
+        for(coord_index_t c = 0; c < 3; ++c) {
+            __m256d pc = _mm256_set1_pd(p[c]);
+            __m256d below = _mm256_sub_pd(_mm256_loadu_pd(node.xyz_min[c]), pc);
+            __m256d above = _mm256_sub_pd(pc, _mm256_loadu_pd(node.xyz_max[c]));
+            __m256d d = _mm256_max_pd(_mm256_max_pd(below, above), zero);
+            result = _mm256_add_pd(result, _mm256_mul_pd(d, d));
+        }
+        _mm256_storeu_pd(sq_dists, result);
+#elif defined(__SSE2__)
+        __m128d zero = _mm_setzero_pd();
+        __m128d result[2] = {zero, zero};
+        for(coord_index_t c = 0; c < 3; ++c) {
+            __m128d pc = _mm_set1_pd(p[c]);
+            for(index_t h = 0; h < 2; ++h) {
+                __m128d below = _mm_sub_pd(_mm_loadu_pd(node.xyz_min[c] + 2 * h), pc);
+                __m128d above = _mm_sub_pd(pc, _mm_loadu_pd(node.xyz_max[c] + 2 * h));
+                __m128d d = _mm_max_pd(_mm_max_pd(below, above), zero);
+                result[h] = _mm_add_pd(result[h], _mm_mul_pd(d, d));
+            }
+        }
+        _mm_storeu_pd(sq_dists, result[0]);
+        _mm_storeu_pd(sq_dists + 2, result[1]);
+#else
+        for(index_t k = 0; k < WIDTH; ++k) {
+            double result = 0.0;
+            for(coord_index_t c = 0; c < 3; ++c) {
+                double d = std::max(std::max(node.xyz_min[c][k] - p[c], p[c] - node.xyz_max[c][k]), 0.0);
+                result += d * d;
+            }
+            sq_dists[k] = result;
+        }
+#endif
+    }
+
+    void MeshFacetsWideBVH::get_nearest_facet_hint(
+        const vec3& p,
+        index_t& nearest_f, vec3& nearest_point, double& sq_dist
+    ) const {
+        // descend towards the child whose box center is the nearest, as the binary tree does
+        index_t n = 0;
+        while(true) {
+            const Node& node = nodes_[n];
+            index_t best = 0;
+            double best_d = std::numeric_limits<double>::max();
+            for(index_t k = 0; k < WIDTH; ++k) {
+                if(node.child[k] == NO_CHILD) {
+                    continue;
+                }
+                double d = 0.0;
+                for(coord_index_t c = 0; c < 3; ++c) {
+                    d += geo_sqr(p[c] - 0.5 * (node.xyz_min[c][k] + node.xyz_max[c][k]));
+                }
+                if(d < best_d) {
+                    best_d = d;
+                    best = k;
+                }
+            }
+            if(node.nb_facets[best] > 0) {
+                nearest_f = node.child[best];
+                break;
+            }
+            n = node.child[best];
+        }
+        nearest_point = points_[3 * nearest_f];
+        sq_dist = Geom::distance2(p, nearest_point);
+    }
+
+    void MeshFacetsWideBVH::traverse(
+        const vec3& p, double sq_epsilon, bool stop_in_envelope,
+        index_t& nearest_f, vec3& nearest_point, double& sq_dist
+    ) const {
+        struct Entry {
+            index_t node;
+            double sq_dist;
+        };
+        // each level adds at most WIDTH - 1 entries
+        Entry stack[64 * WIDTH];
+        index_t top = 0;
+        stack[top++] = {0, 0.0};
+
+        while(top > 0) {
+            if(stop_in_envelope && sq_dist <= sq_epsilon) {
+                return;
+            }
+            const Entry entry = stack[--top];
+            if(entry.sq_dist >= sq_dist) {
+                continue;
+            }
+            const Node& node = nodes_[entry.node];
+
+            double d[WIDTH];
+            point_boxes_squared_distances(node, p, d);
+            index_t order[WIDTH];
+            for(index_t k = 0; k < WIDTH; ++k) {
+                order[k] = k;
+            }
+            std::sort(order, order + WIDTH, [&d](index_t a, index_t b) { return d[a] < d[b]; });
+
+            // leaves are visited right away, nearest first, inner children are pushed so that
+            // the nearest one is popped first
+            index_t inner[WIDTH];
+            index_t nb_inner = 0;
+            for(index_t i = 0; i < WIDTH; ++i) {
+                const index_t k = order[i];
+                if(node.child[k] == NO_CHILD || d[k] >= sq_dist) {
+                    continue;
+                }
+                if(stop_in_envelope && d[k] > sq_epsilon) {
+                    continue;
+                }
+                if(node.nb_facets[k] == 0) {
+                    inner[nb_inner++] = k;
+                    continue;
+                }
+                for(index_t f = node.child[k]; f < node.child[k] + node.nb_facets[k]; ++f) {
+                    vec3 cur_nearest_point;
+                    double lambda1, lambda2, lambda3;  // barycentric coords, not used.
+                    double cur_sq_dist = Geom::point_triangle_squared_distance(
+                        p, points_[3 * f], points_[3 * f + 1], points_[3 * f + 2],
+                        cur_nearest_point, lambda1, lambda2, lambda3
+                    );
+                    if(cur_sq_dist < sq_dist) {
+                        nearest_f = f;
+                        nearest_point = cur_nearest_point;
+                        sq_dist = cur_sq_dist;
+                    }
+                }
+                if(stop_in_envelope && sq_dist <= sq_epsilon) {
+                    return;
+                }
+            }
+            for(index_t i = nb_inner; i-- > 0;) {
+                geo_debug_assert(top < 64 * WIDTH);
+                stack[top++] = {node.child[inner[i]], d[inner[i]]};
+            }
+        }
+    }
+
+    bool MeshFacetsWideBVH::points_in_envelope(
+        const std::vector<vec3>& points, const std::vector<index_t>& point_ids,
+        double sq_epsilon
+    ) const {
+        if(point_ids.empty()) {
+            return true;
+        }
+
+        struct Entry {
+            index_t node;
+            // range of the points of the packet in packet_points
+            index_t begin, size;
+        };
+        static thread_local std::vector<Entry> stack;
+        static thread_local std::vector<index_t> packet_points, cur_points;
+        static thread_local std::vector<index_t> child_points[WIDTH];
+        // same bookkeeping as the binary tree: number of entries of the
+        // stack that hold the point, outside if it drops to zero
+        static thread_local std::vector<index_t> nb_pending;
+        static thread_local std::vector<bool> is_inside;
+        stack.clear();
+        packet_points.assign(point_ids.begin(), point_ids.end());
+        nb_pending.assign(points.size(), 0);
+        is_inside.assign(points.size(), false);
+        for(index_t i : point_ids) {
+            nb_pending[i] = 1;
+        }
+        stack.push_back({0, 0, index_t(packet_points.size())});
+
+        while(!stack.empty()) {
+            Entry entry = stack.back();
+            stack.pop_back();
+            // the points of the top entry are always at the end of packet_points
+            cur_points.assign(
+                packet_points.begin() + entry.begin,
+                packet_points.begin() + entry.begin + entry.size
+            );
+            packet_points.resize(entry.begin);
+            const Node& node = nodes_[entry.node];
+
+            // the leaf children are tested right away, the inner ones get
+            // the points that are within the envelope of their boxes
+            double sum_d[WIDTH] = {0.0, 0.0, 0.0, 0.0};
+            for(index_t k = 0; k < WIDTH; ++k) {
+                child_points[k].clear();
+            }
+            for(index_t i : cur_points) {
+                if(is_inside[i]) {
+                    continue;
+                }
+                nb_pending[i]--;
+                double d[WIDTH];
+                point_boxes_squared_distances(node, points[i], d);
+                for(index_t k = 0; k < WIDTH && !is_inside[i]; ++k) {
+                    if(node.child[k] == NO_CHILD || d[k] > sq_epsilon) {
+                        continue;
+                    }
+                    if(node.nb_facets[k] == 0) {
+                        child_points[k].push_back(i);
+                        nb_pending[i]++;
+                        sum_d[k] += d[k];
+                        continue;
+                    }
+                    for(index_t f = node.child[k]; f < node.child[k] + node.nb_facets[k]; ++f) {
+                        vec3 cur_nearest_point;
+                        double lambda1, lambda2, lambda3;  // barycentric coords, not used.
+                        double cur_sq_dist = Geom::point_triangle_squared_distance(
+                            points[i], points_[3 * f], points_[3 * f + 1], points_[3 * f + 2],
+                            cur_nearest_point, lambda1, lambda2, lambda3
+                        );
+                        if(cur_sq_dist <= sq_epsilon) {
+                            is_inside[i] = true;
+                            break;
+                        }
+                    }
+                }
+                if(!is_inside[i] && nb_pending[i] == 0) {
+                    return false;
+                }
+            }
+
+            // the child that is the nearest to the packet (on average) is
+            // pushed last, so that it is traversed first
+            index_t order[WIDTH];
+            index_t nb_children = 0;
+            for(index_t k = 0; k < WIDTH; ++k) {
+                if(!child_points[k].empty()) {
+                    order[nb_children++] = k;
+                }
+            }
+            std::sort(order, order + nb_children, [&](index_t a, index_t b) {
+                return sum_d[a] * double(child_points[b].size()) > sum_d[b] * double(child_points[a].size());
+            });
+            for(index_t i = 0; i < nb_children; ++i) {
+                const index_t k = order[i];
+                stack.push_back({
+                    node.child[k], index_t(packet_points.size()), index_t(child_points[k].size())
+                });
+                packet_points.insert(
+                    packet_points.end(), child_points[k].begin(), child_points[k].end()
+                );
+            }
+        }
+        return true;
+    }
+
+}
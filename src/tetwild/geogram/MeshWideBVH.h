@@ -0,0 +1,125 @@
+// This file is part of TetWild, a software for generating tetrahedral meshes.
+//
+// This Source Code Form is subject to the terms of the Mozilla Public License
+// v. 2.0. If a copy of the MPL was not distributed with this file, You can
+// obtain one at http://mozilla.org/MPL/2.0/.
+//
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <geogram/basic/common.h>
+#include <geogram/mesh/mesh.h>
+#include <geogram/basic/geometry.h>
+#include <vector>
+
+namespace GEO {
+
+    /**
+     * \brief 4-wide bounding volume hierarchy of mesh facets.
+     * \details Alternative to the binary tree of MeshFacetsAABBWithEps for
+     *  nearest facet and envelope queries. Each node stores the bounds of
+     *  its children as structure of arrays, so that a query point is tested
+     *  against the four boxes at once (with SSE2/AVX when available), and
+     *  leaves reference short contiguous ranges of facets whose vertices
+     *  are copied in a flat array. The facet order of the mesh is kept, so
+     *  facet indices match the ones of the binary tree, and the distances
+     *  are computed with the same function: envelope verdicts are identical.
+     */
+    class MeshFacetsWideBVH {
+    public:
+        static const index_t WIDTH = 4;
+        static const index_t MAX_LEAF_SIZE = 4;
+
+        /**
+         * \brief Builds the hierarchy.
+         * \param[in] M a triangulated mesh, reordered for locality
+         *  (see MeshFacetsAABBWithEps).
+         */
+        explicit MeshFacetsWideBVH(const Mesh& M);
+
+        /**
+         * \brief Same as MeshFacetsAABBWithEps::get_nearest_facet_hint().
+         */
+        void get_nearest_facet_hint(
+            const vec3& p,
+            index_t& nearest_facet, vec3& nearest_point, double& sq_dist
+        ) const;
+
+        /**
+         * \brief Finds the nearest facet from a query point, starting from
+         *  the given (valid) hint.
+         * \param[in] p query point
+         * \param[in,out] nearest_facet the nearest facet so far
+         * \param[in,out] nearest_point a point in nearest_facet
+         * \param[in,out] sq_dist squared distance between p and nearest_point
+         */
+        void nearest_facet(
+            const vec3& p,
+            index_t& nearest_facet, vec3& nearest_point, double& sq_dist
+        ) const {
+            traverse(p, 0.0, false, nearest_facet, nearest_point, sq_dist);
+        }
+
+        /**
+         * \brief Same as nearest_facet(), but stops as soon as a facet
+         *  within squared distance \p sq_epsilon is found.
+         */
+        void facet_in_envelope(
+            const vec3& p, double sq_epsilon,
+            index_t& nearest_facet, vec3& nearest_point, double& sq_dist
+        ) const {
+            traverse(p, sq_epsilon, true, nearest_facet, nearest_point, sq_dist);
+        }
+
+        /**
+         * \brief Packet traversal of MeshFacetsAABBWithEps::points_in_envelope().
+         * \param[in] points the query points
+         * \param[in] point_ids the points that remain to be located, the
+         *  other ones are known to be within the envelope
+         * \param[in] sq_epsilon the squared envelope size
+         * \return true if all the points of \p point_ids are within the envelope
+         */
+        bool points_in_envelope(
+            const std::vector<vec3>& points, const std::vector<index_t>& point_ids,
+            double sq_epsilon
+        ) const;
+
+    protected:
+        static const index_t NO_CHILD = index_t(-1);
+
+        struct Node {
+            double xyz_min[3][WIDTH];
+            double xyz_max[3][WIDTH];
+            // index of the child node, or first facet of a leaf child
+            index_t child[WIDTH];
+            // number of facets of a leaf child, 0 for an inner child
+            index_t nb_facets[WIDTH];
+        };
+
+        /**
+         * \brief Builds the subtree of facets [b, e) and returns its root.
+         */
+        index_t build_recursive(index_t b, index_t e, Box& box);
+
+        void get_facets_bbox(index_t b, index_t e, Box& box) const;
+
+        /**
+         * \brief Squared distances between a point and the boxes of the
+         *  children of a node (0 inside a box, +inf for empty slots).
+         */
+        void point_boxes_squared_distances(
+            const Node& node, const vec3& p, double* sq_dists
+        ) const;
+
+        void traverse(
+            const vec3& p, double sq_epsilon, bool stop_in_envelope,
+            index_t& nearest_facet, vec3& nearest_point, double& sq_dist
+        ) const;
+
+    protected:
+        std::vector<Node> nodes_;
+        // the three vertices of each facet
+        std::vector<vec3> points_;
+    };
+
+}
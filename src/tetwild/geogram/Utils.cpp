@@ -11,6 +11,7 @@
 ////////////////////////////////////////////////////////////////////////////////
 #include "Utils.h"
 #include <tetwild/Logger.h>
+#include <tetwild/Parallel.h>
 #include <geogram/basic/geometry.h>
 #include <geogram/mesh/mesh_preprocessing.h>
 #include <geogram/mesh/mesh_topology.h>
@@ -18,6 +19,8 @@
 #include <geogram/mesh/mesh_io.h>
 #include <geogram/voronoi/CVT.h>
 #include <geogram/basic/progress.h>
+#include <geogram/basic/process.h>
+#include <geogram/delaunay/delaunay.h>
 ////////////////////////////////////////////////////////////////////////////////
 
 namespace tetwild {
@@ -292,12 +295,20 @@ void resample_surface(const Eigen::MatrixXd &V, const Eigen::MatrixXi &F, int nu
 
 // -----------------------------------------------------------------------------
 
-void delaunay_tetrahedralization(const Eigen::MatrixXd &V, Eigen::MatrixXi &T) {
+void delaunay_tetrahedralization(const Eigen::MatrixXd &V, Eigen::MatrixXi &T, int num_threads) {
     assert(V.cols() == 3);
     int n = (int) V.rows();
 
     // Compute tetrahedralization
-    GEO::Delaunay_var delaunay = GEO::Delaunay::create(3, "BDEL");
+    GEO::Delaunay_var delaunay;
+    num_threads = getNumThreads(num_threads);
+    if (num_threads > 1) {
+        GEO::Process::set_max_threads(num_threads);
+        delaunay = GEO::Delaunay::create(3, "PDEL");
+    }
+    if (delaunay.is_null()) {
+        delaunay = GEO::Delaunay::create(3, "BDEL");
+    }
     const Eigen::MatrixXd P = V.transpose();
     delaunay->set_vertices(n, P.data());
 
@@ -74,9 +74,11 @@ void resample_surface(const Eigen::MatrixXd &V, const Eigen::MatrixXi &F, int nu
 ///
 /// Computes a Delaunay tiangulation of a point cloud in 3d
 ///
-/// @param[in]  V     { #V x dims input point positions }
-/// @param[out] T     { #T x 4 output mesh tetrahedra }
+/// @param[in]  V            { #V x dims input point positions }
+/// @param[out] T            { #T x 4 output mesh tetrahedra }
+/// @param[in]  num_threads  { Number of threads (see getNumThreads()), geogram's parallel implementation is used
+///                          if greater than 1 }
 ///
-void delaunay_tetrahedralization(const Eigen::MatrixXd &V, Eigen::MatrixXi &T);
+void delaunay_tetrahedralization(const Eigen::MatrixXd &V, Eigen::MatrixXi &T, int num_threads = 1);
 
 } // namespace tetwild
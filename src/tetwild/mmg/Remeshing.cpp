@@ -500,7 +500,7 @@ void isosurface_remeshing(const Eigen::MatrixXd &V, const Eigen::MatrixXi &F, in
     resample_surface(V, F, V.rows(), ambient_vertices, 10, 0);
     sample_bbox(ambient_vertices, num_samples, 0.5 * igl::avg_edge_length(V, F), ambient_vertices, 10, 0);
     // sample_box_regular(V, opt.hmax, ambient_vertices);
-    delaunay_tetrahedralization(ambient_vertices, ambient_tets);
+    delaunay_tetrahedralization(ambient_vertices, ambient_tets, opt.num_threads);
     // peel_slivers(ambient_vertices, ambient_tets, ambient_vertices, ambient_tets);
 
     // Compute unsigned distance field
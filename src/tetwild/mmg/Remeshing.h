@@ -39,6 +39,8 @@ struct MmgOptions {
     bool level_set = false;
     double ls_value = 0.0;
     int verbose = 1;
+    // Number of threads of the geogram steps (see getNumThreads())
+    int num_threads = 1;
 };
 
 ///
@@ -18,8 +18,11 @@
 #include <tetwild/SimpleTetrahedralization.h>
 #include <tetwild/MeshRefinement.h>
 #include <tetwild/InoutFiltering.h>
+#include <tetwild/Parallel.h>
+#include <tetwild/Trace.h>
 #include <tetwild/Utils.h>
 #include <tetwild/Quality.h>
+#include <tetwild/WindingNumber.h>
 #include <tetwild/mmg/Remeshing.h>
 #include <igl/boundary_facets.h>
 #include <igl/bounding_box_diagonal.h>
@@ -27,20 +30,19 @@
 #include <igl/write_triangle_mesh.h>
 #include <igl/writeMESH.h>
 #include <igl/barycenter.h>
-#include <igl/winding_number.h>
 #include <pymesh/MshSaver.h>
 #include <geogram/mesh/mesh.h>
+#include <atomic>
+#include <numeric>
 
 
 namespace tetwild {
 
 ////////////////////////////////////////////////////////////////////////////////
 
-void printFinalQuality(double time, const std::vector<TetVertex>& tet_vertices,
-                       const std::vector<std::array<int, 4>>& tets,
-                       const std::vector<bool> &t_is_removed,
+void printFinalQuality(double time, const std::vector<bool> &t_is_removed,
                        const std::vector<TetQuality>& tet_qualities,
-                       const std::vector<int>& v_ids,
+                       int v_cnt, int unrounded_cnt,
                        const Args &args, const State &state)
 {
     logger().debug("final quality:");
@@ -85,18 +87,12 @@ void printFinalQuality(double time, const std::vector<TetVertex>& tet_vertices,
     logger().debug("min_d_angle: <6 {};   <12 {};  <18 {}", cmp_cnt[0] / cnt, cmp_cnt[1] / cnt, cmp_cnt[2] / cnt);
     logger().debug("max_d_angle: >174 {}; >168 {}; >162 {}", cmp_cnt[5] / cnt, cmp_cnt[4] / cnt, cmp_cnt[3] / cnt);
 
-    addRecord(MeshRecord(MeshRecord::OpType::OP_WN, time, v_ids.size(), cnt,
+    addRecord(MeshRecord(MeshRecord::OpType::OP_WN, time, v_cnt, cnt,
                          min, min_avg / cnt, max, max_avg / cnt, max_slim_energy, avg_slim_energy / cnt), args, state);
 
     // output unrounded vertices:
-    cnt = 0;
-    for (int v_id: v_ids) {
-        if (!tet_vertices[v_id].is_rounded) {
-            cnt++;
-        }
-    }
-    logger().debug("{}/{} vertices are unrounded!!!", cnt, v_ids.size());
-    addRecord(MeshRecord(MeshRecord::OpType::OP_UNROUNDED, -1, cnt, -1), args, state);
+    logger().debug("{}/{} vertices are unrounded!!!", unrounded_cnt, v_cnt);
+    addRecord(MeshRecord(MeshRecord::OpType::OP_UNROUNDED, -1, unrounded_cnt, -1), args, state);
 }
 
 // -----------------------------------------------------------------------------
@@ -111,10 +107,33 @@ void extractSurfaceMesh(const Eigen::MatrixXd &V, const Eigen::MatrixXi &T,
 
 // -----------------------------------------------------------------------------
 
+const int COMPACTION_BLOCK_SIZE = 1 << 14;
+
+///
+/// @brief      { Offsets of the kept elements of each block of COMPACTION_BLOCK_SIZE elements, counted in parallel.
+///             Element i of block b is written at offsets[b] plus the number of kept elements before it in the block,
+///             and offsets.back() is the total number of kept elements. }
+///
+template<typename IsKept>
+std::vector<int> blockOffsets(int n, int num_threads, const IsKept &is_kept) {
+    const int num_blocks = (n + COMPACTION_BLOCK_SIZE - 1) / COMPACTION_BLOCK_SIZE;
+    std::vector<int> offsets(num_blocks + 1, 0);
+    parallelFor(num_blocks, num_threads, [&](int b, int thread_id) {
+        const int end = std::min(n, (b + 1) * COMPACTION_BLOCK_SIZE);
+        for (int i = b * COMPACTION_BLOCK_SIZE; i < end; i++) {
+            if (is_kept(i))
+                offsets[b + 1]++;
+        }
+    }, 1);
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+    return offsets;
+}
+
 void extractFinalTetmesh(MeshRefinement& MR,
     Eigen::MatrixXd &V_out, Eigen::MatrixXi &T_out, Eigen::VectorXd &A_out,
     const Args &args, const State &state)
 {
+    trace::Span span("extraction", "stage");
     std::vector<TetVertex> &tet_vertices = MR.tet_vertices;
     std::vector<std::array<int, 4>> &tets = MR.tets;
     std::vector<bool> &t_is_removed = MR.t_is_removed;
@@ -125,7 +144,8 @@ void extractFinalTetmesh(MeshRefinement& MR,
     // been done previously as a post-processing step of MeshRefinement.
     // Otherwise we need to tag in-out tetrahedra here.
     if (!args.smooth_open_boundary) {
-        InoutFiltering IOF(tet_vertices, tets, MR.is_surface_fs, t_is_removed, state);
+        trace::Span inout_span("inout filtering", "stage");
+        InoutFiltering IOF(tet_vertices, tets, MR.is_surface_fs, t_is_removed, args, state);
         igl::Timer igl_timer;
         igl_timer.start();
         t_is_removed = IOF.filter();
@@ -135,47 +155,75 @@ void extractFinalTetmesh(MeshRefinement& MR,
         logger().debug("{} tets inside!", t_cnt);
     }
 
-    //output result
-    std::vector<int> v_ids;
-    for (int i = 0; i < tets.size(); i++) {
-        if (t_is_removed[i])
-            continue;
+    //output result: compact the remaining tets and the vertices they use, by blocks in parallel
+    const int num_threads = args.num_threads;
+    const int num_tets = int(tets.size());
+    const int num_vertices = int(tet_vertices.size());
+    std::vector<int> t_offsets = blockOffsets(num_tets, num_threads, [&](int t_id) {
+        return !t_is_removed[t_id];
+    });
+    t_cnt = t_offsets.back();
+
+    //old_2_new[v_id] first flags the used vertices, then holds their new index
+    std::vector<std::atomic<int>> old_2_new(num_vertices);
+    parallelFor(num_vertices, num_threads, [&](int v_id, int thread_id) {
+        old_2_new[v_id].store(0, std::memory_order_relaxed);
+    }, COMPACTION_BLOCK_SIZE);
+    parallelFor(num_tets, num_threads, [&](int t_id, int thread_id) {
+        if (t_is_removed[t_id])
+            return;
         for (int j = 0; j < 4; j++)
-            v_ids.push_back(tets[i][j]);
-    }
-    std::sort(v_ids.begin(), v_ids.end());
-    v_ids.erase(std::unique(v_ids.begin(), v_ids.end()), v_ids.end());
-    std::unordered_map<int, int> map_ids;
-    for (int i = 0; i < v_ids.size(); i++) {
-        map_ids[v_ids[i]] = i;
-    }
-
-    V_out.resize(v_ids.size(), 3);
+            old_2_new[tets[t_id][j]].store(1, std::memory_order_relaxed);
+    }, COMPACTION_BLOCK_SIZE);
+    std::vector<int> v_offsets = blockOffsets(num_vertices, num_threads, [&](int v_id) {
+        return old_2_new[v_id].load(std::memory_order_relaxed) != 0;
+    });
+
+    //the outputs are written in place, resizing them is a no-op when the caller's buffers already have the size
+    V_out.resize(v_offsets.back(), 3);
     T_out.resize(t_cnt, 4);
     A_out.resize(t_cnt);
-    for (int i = 0; i < v_ids.size(); i++) {
-        for (int j = 0; j < 3; j++) {
-            V_out(i, + j) = tet_vertices[v_ids[i]].posf[j];
-        }
-    }
-    int cnt = 0;
-    for (int i = 0; i < tets.size(); i++) {
-        if (t_is_removed[i]) {
-            continue;
+    std::vector<int> unrounded_cnts(v_offsets.size() - 1, 0);
+    parallelFor(int(v_offsets.size()) - 1, num_threads, [&](int b, int thread_id) {
+        int cnt = v_offsets[b];
+        const int end = std::min(num_vertices, (b + 1) * COMPACTION_BLOCK_SIZE);
+        for (int v_id = b * COMPACTION_BLOCK_SIZE; v_id < end; v_id++) {
+            if (old_2_new[v_id].load(std::memory_order_relaxed) == 0) {
+                old_2_new[v_id].store(-1, std::memory_order_relaxed);
+                continue;
+            }
+            old_2_new[v_id].store(cnt, std::memory_order_relaxed);
+            for (int j = 0; j < 3; j++) {
+                V_out(cnt, j) = tet_vertices[v_id].posf[j];
+            }
+            if (!tet_vertices[v_id].is_rounded) {
+                unrounded_cnts[b]++;
+            }
+            cnt++;
         }
-        for (int j = 0; j < 4; j++) {
-            T_out(cnt, j) = map_ids[tets[i][j]];
+    }, 1);
+    parallelFor(int(t_offsets.size()) - 1, num_threads, [&](int b, int thread_id) {
+        int cnt = t_offsets[b];
+        const int end = std::min(num_tets, (b + 1) * COMPACTION_BLOCK_SIZE);
+        for (int t_id = b * COMPACTION_BLOCK_SIZE; t_id < end; t_id++) {
+            if (t_is_removed[t_id]) {
+                continue;
+            }
+            for (int j = 0; j < 4; j++) {
+                T_out(cnt, j) = old_2_new[tets[t_id][j]].load(std::memory_order_relaxed);
+            }
+            A_out(cnt) = tet_qualities[t_id].min_d_angle;
+            cnt++;
         }
-        A_out(cnt) = tet_qualities[i].min_d_angle;
-        cnt++;
-    }
+    }, 1);
+    const int unrounded_cnt = std::accumulate(unrounded_cnts.begin(), unrounded_cnts.end(), 0);
     logger().debug("#v = {}", V_out.rows());
     logger().debug("#t = {}", T_out.rows());
 
     if (args.is_quiet) {
         return;
     }
-    printFinalQuality(tmp_time, tet_vertices, tets, t_is_removed, tet_qualities, v_ids, args, state);
+    printFinalQuality(tmp_time, t_is_removed, tet_qualities, int(V_out.rows()), unrounded_cnt, args, state);
 }
 
 // -----------------------------------------------------------------------------
@@ -183,7 +231,7 @@ void extractFinalTetmesh(MeshRefinement& MR,
 // Extract ambient tet-mesh with a region tag, 0 being outside, 1 being inside
 void extractRegionMesh(const MeshRefinement& MR,
     Eigen::MatrixXd &V, Eigen::MatrixXi &T, Eigen::VectorXi &R,
-    const State &state)
+    const Args &args, const State &state)
 {
     // volume mesh
     extractVolumeMesh(MR.tet_vertices, MR.tets, MR.t_is_removed, V, T);
@@ -198,7 +246,7 @@ void extractRegionMesh(const MeshRefinement& MR,
     Eigen::MatrixXd C;
     Eigen::VectorXd W;
     igl::barycenter(V, T, C);
-    igl::winding_number(VS, FS, C, W);
+    WindingNumber(VS, FS).evaluate(C, W, args.num_threads);
     R.resize(T.rows());
     for (int t = 0; t < T.rows(); ++t) {
         R(t) = (W(t) > 0.5);
@@ -213,6 +261,7 @@ void extractInsideMesh(
     const MeshRefinement& MR,
     Eigen::MatrixXd &V,
     Eigen::MatrixXi &T,
+    const Args &args,
     const State &state)
 {
     // volume mesh
@@ -227,7 +276,7 @@ void extractInsideMesh(
     Eigen::MatrixXd C;
     Eigen::VectorXd W;
     igl::barycenter(V, T, C);
-    igl::winding_number(VS, FS, C, W);
+    WindingNumber(VS, FS).evaluate(C, W, args.num_threads);
     int cnt = 0;
     for (int t = 0; t < T.rows(); ++t) {
         if ((W(t) > 0.5)) {
@@ -257,6 +306,7 @@ double tetwild_stage_one_preprocess(
     std::vector<Point_3> &m_vertices,
     std::vector<std::array<int, 3>> &m_faces)
 {
+    trace::Span span("preprocess", "stage");
     igl::Timer igl_timer;
     igl_timer.start();
     logger().info("Preprocessing...");
@@ -284,6 +334,7 @@ double tetwild_stage_one_preprocess(
         opt.hausd = state.eps_input;
         opt.angle_detection = (args.mmg_angle_thres > 0.0);
         opt.angle_value = args.mmg_angle_thres;
+        opt.num_threads = args.num_threads;
         if (logger().level() == spdlog::level::trace) {
             opt.verbose = 10;
         } else if (logger().level() == spdlog::level::debug) {
@@ -334,6 +385,7 @@ double tetwild_stage_one_delaunay(
     std::vector<int> &raw_e_tags,
     std::vector<std::vector<int>> &raw_conn_e4v)
 {
+    trace::Span span("delaunay", "stage");
     igl::Timer igl_timer;
     igl_timer.start();
     logger().info("Delaunay tetrahedralizing...");
@@ -367,6 +419,7 @@ double tetwild_stage_one_mc(
     const State &state,
     MeshConformer &MC)
 {
+    trace::Span span("mesh conforming", "stage");
     igl::Timer igl_timer;
     igl_timer.start();
     logger().info("Divfaces matching...");
@@ -387,6 +440,7 @@ double tetwild_stage_one_bsp(
     const State &state,
     MeshConformer &MC)
 {
+    trace::Span span("bsp subdivision", "stage");
     igl::Timer igl_timer;
     igl_timer.start();
     logger().info("BSP subdivision ...");
@@ -420,6 +474,7 @@ double tetwild_stage_one_tetra(
     std::vector<std::array<int, 4>> &tet_indices,
     std::vector<std::array<int, 4>> &is_surface_facet)
 {
+    trace::Span span("simple tetrahedralization", "stage");
     igl::Timer igl_timer;
     igl_timer.start();
     logger().info("Tetrehedralizing ...");
@@ -457,6 +512,7 @@ void tetwild_stage_one(
     std::vector<std::array<int, 4>> &tet_indices,
     std::vector<std::array<int, 4>> &is_surface_facet)
 {
+    trace::Span span("stage one", "stage");
     igl::Timer igl_timer;
     double tmp_time = 0;
     double sum_time = 0;
@@ -507,6 +563,7 @@ void tetwild_stage_two(
     Eigen::MatrixXi &TO,
     Eigen::VectorXd &AO)
 {
+    trace::Span span("stage two", "stage");
     //init
     logger().info("Refinement initializing...");
     if (args.user_callback) { args.user_callback(Step::Optimize, 0.0); }
@@ -527,6 +584,7 @@ void tetwild_stage_two(
         opt.hausd = state.eps_input;
         opt.angle_detection = (args.mmg_angle_thres > 0.0);
         opt.angle_value = args.mmg_angle_thres;
+        opt.num_threads = args.num_threads;
         if (logger().level() == spdlog::level::trace) {
             opt.verbose = 10;
         } else if (logger().level() == spdlog::level::debug) {
@@ -536,8 +594,8 @@ void tetwild_stage_two(
         }
         Eigen::MatrixXi FO;
         Eigen::VectorXi R;
-        // extractRegionMesh(MR, VO, TO, R, state);
-        extractInsideMesh(VI, FI, MR, VO, TO, state);
+        // extractRegionMesh(MR, VO, TO, R, args, state);
+        extractInsideMesh(VI, FI, MR, VO, TO, args, state);
         // igl::writeMESH("before_mmg.mesh", VO, TO, FO);
         logger().debug("mesh quality ok: {}", isMeshQualityOk(VO, TO));
         logger().debug("volume ok: {}", checkVolume(VO, TO));
@@ -567,22 +625,27 @@ void tetrahedralization(const Eigen::MatrixXd &VI, const Eigen::MatrixXi &FI,
     Args args = args_;
     igl::Timer igl_timer;
     igl_timer.start();
-
-    ////pipeline
-    State state(args, VI);
-    GEO::Mesh geo_sf_mesh;
-    GEO::Mesh geo_b_mesh;
-    std::vector<TetVertex> tet_vertices;
-    std::vector<std::array<int, 4>> tet_indices;
-    std::vector<std::array<int, 4>> is_surface_facet;
-
-    /// STAGE 1
-    tetwild_stage_one(VI, FI, args, state, geo_sf_mesh, geo_b_mesh,
-        tet_vertices, tet_indices, is_surface_facet);
-
-    /// STAGE 2
-    tetwild_stage_two(VI, FI, args, state, geo_sf_mesh, geo_b_mesh,
-        tet_vertices, tet_indices, is_surface_facet, VO, TO, AO);
+    trace::Recording recording(args.trace_file);
+
+    {
+        trace::Span span("tetrahedralization", "stage");
+
+        ////pipeline
+        State state(args, VI);
+        GEO::Mesh geo_sf_mesh;
+        GEO::Mesh geo_b_mesh;
+        std::vector<TetVertex> tet_vertices;
+        std::vector<std::array<int, 4>> tet_indices;
+        std::vector<std::array<int, 4>> is_surface_facet;
+
+        /// STAGE 1
+        tetwild_stage_one(VI, FI, args, state, geo_sf_mesh, geo_b_mesh,
+            tet_vertices, tet_indices, is_surface_facet);
+
+        /// STAGE 2
+        tetwild_stage_two(VI, FI, args, state, geo_sf_mesh, geo_b_mesh,
+            tet_vertices, tet_indices, is_surface_facet, VO, TO, AO);
+    }
 
     double total_time = igl_timer.getElapsedTime();
     logger().info("Total time for all stages = {}s", total_time);